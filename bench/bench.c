@@ -0,0 +1,189 @@
+/*
+ * bench -- Helpers shared by the benchmarks
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "bench.h"
+
+/* names of the counters in the JSON output, indexed by enum bench_counter */
+static const char *__bench_counter_names[BENCH_COUNTERS] = {
+	"cycles", "instructions", "cache_misses", "branch_misses", "dtlb_misses",
+};
+
+static unsigned __bench_hist_bucket(uint64_t ns)
+{
+	if (ns < BENCH_HIST_SUB)
+		return ns;
+
+	/* position of the leading bit, followed by the next three bits */
+	unsigned e   = 63 - __builtin_clzll(ns);
+	unsigned sub = (ns >> (e - 3)) & (BENCH_HIST_SUB - 1);
+	return (e - 2) * BENCH_HIST_SUB + sub;
+}
+
+static uint64_t __bench_hist_upper(unsigned bucket)
+{
+	if (bucket < BENCH_HIST_SUB)
+		return bucket;
+
+	unsigned e   = bucket / BENCH_HIST_SUB + 2;
+	uint64_t sub = bucket % BENCH_HIST_SUB;
+	return ((BENCH_HIST_SUB + sub + 1) << (e - 3)) - 1;
+}
+
+uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+void bench_hist_record(struct bench_hist *h, uint64_t ns)
+{
+	h->counts[__bench_hist_bucket(ns)]++;
+	h->n++;
+	if (ns > h->max)
+		h->max = ns;
+}
+
+uint64_t bench_hist_percentile(const struct bench_hist *h, double pct)
+{
+	if (h->n == 0)
+		return 0;
+
+	uint64_t rank = (uint64_t)(pct / 100.0 * h->n);
+	if (rank >= h->n)
+		rank = h->n - 1;
+
+	uint64_t seen = 0;
+	for (unsigned b = 0; b < BENCH_HIST_BUCKETS; b++) {
+		seen += h->counts[b];
+		if (seen > rank) {
+			uint64_t upper = __bench_hist_upper(b);
+			return upper < h->max ? upper : h->max;
+		}
+	}
+	return h->max;
+}
+
+#ifdef __linux__
+static int __bench_counter_open(enum bench_counter counter)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof attr);
+	attr.size	 = sizeof attr;
+	attr.disabled	 = 1;
+	attr.inherit	 = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv	 = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	switch (counter) {
+	case BENCH_CYCLES:
+		attr.type   = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case BENCH_INSTRUCTIONS:
+		attr.type   = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case BENCH_CACHE_MISSES:
+		attr.type   = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		break;
+	case BENCH_BRANCH_MISSES:
+		attr.type   = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	default:
+		attr.type   = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	}
+
+	/* this thread and its children, on any cpu */
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+void bench_counters_start(struct bench_counters *c)
+{
+	for (unsigned i = 0; i < BENCH_COUNTERS; i++) {
+		c->valid[i]  = false;
+		c->values[i] = 0;
+#ifdef __linux__
+		c->fd[i] = __bench_counter_open(i);
+		if (c->fd[i] >= 0 && ioctl(c->fd[i], PERF_EVENT_IOC_RESET, 0) == 0)
+			ioctl(c->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+#else
+		c->fd[i] = -1;
+#endif
+	}
+}
+
+void bench_counters_stop(struct bench_counters *c)
+{
+	for (unsigned i = 0; i < BENCH_COUNTERS; i++) {
+		if (c->fd[i] < 0)
+			continue;
+
+#ifdef __linux__
+		/* value, time enabled, time running */
+		uint64_t buf[3];
+		ioctl(c->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+		if (read(c->fd[i], buf, sizeof buf) == sizeof buf && buf[2] > 0) {
+			c->values[i] = buf[2] < buf[1] ? (uint64_t)((double)buf[0] * buf[1] / buf[2]) : buf[0];
+			c->valid[i]  = true;
+		}
+#endif
+		close(c->fd[i]);
+		c->fd[i] = -1;
+	}
+}
+
+void bench_report(FILE *out, const struct bench_result *r)
+{
+	fprintf(out, "{\"name\": \"%s\", \"ops\": %llu, \"elapsed_ns\": %llu",
+		r->name, (unsigned long long)r->ops, (unsigned long long)r->elapsed_ns);
+
+	if (r->latency) {
+		const struct bench_hist *h = r->latency;
+		fprintf(out,
+			", \"latency_ns\": {\"p50\": %llu, \"p99\": %llu, \"p99.9\": %llu, "
+			"\"p99.99\": %llu, \"max\": %llu}",
+			(unsigned long long)bench_hist_percentile(h, 50),
+			(unsigned long long)bench_hist_percentile(h, 99),
+			(unsigned long long)bench_hist_percentile(h, 99.9),
+			(unsigned long long)bench_hist_percentile(h, 99.99),
+			(unsigned long long)h->max);
+	}
+
+	if (r->counters) {
+		const struct bench_counters *c = r->counters;
+		fprintf(out, ", \"counters\": {");
+		for (unsigned i = 0; i < BENCH_COUNTERS; i++) {
+			fprintf(out, "%s\"%s\": ", i ? ", " : "", __bench_counter_names[i]);
+			if (c->valid[i])
+				fprintf(out, "%llu", (unsigned long long)c->values[i]);
+			else
+				fprintf(out, "null");
+		}
+		fprintf(out, "}");
+	}
+
+	fprintf(out, "}\n");
+	fflush(out);
+}
@@ -0,0 +1,115 @@
+/**
+ * @file
+ * Benchmark helpers
+ *
+ * Timing, latency histograms, hardware counters and reporting shared by
+ * the benchmarks. Results are written as one JSON object per line.
+ */
+
+#ifndef RAISE_BENCH_H
+#define RAISE_BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+enum bench_consts {
+	BENCH_HIST_SUB	   = 8,			 /**< Buckets per power of two. */
+	BENCH_HIST_BUCKETS = 64 * BENCH_HIST_SUB /**< Buckets in a histogram. */
+};
+
+/**
+ * A log-linear histogram of latencies in nanoseconds.
+ *
+ * Values are bucketed with a relative error of at most 1/8.
+ * Zero initialize before use.
+ */
+struct bench_hist {
+	uint64_t counts[BENCH_HIST_BUCKETS]; /**< Number of values per bucket. */
+	uint64_t n;			     /**< Number of recorded values. */
+	uint64_t max;			     /**< Largest recorded value. */
+};
+
+/**
+ * Hardware events counted during a benchmark.
+ */
+enum bench_counter {
+	BENCH_CYCLES,	     /**< CPU cycles. */
+	BENCH_INSTRUCTIONS,  /**< Retired instructions. */
+	BENCH_CACHE_MISSES,  /**< Last level cache misses. */
+	BENCH_BRANCH_MISSES, /**< Mispredicted branches. */
+	BENCH_DTLB_MISSES,   /**< Data TLB read misses. */
+	BENCH_COUNTERS	     /**< Number of counters. */
+};
+
+/**
+ * Hardware counters of the calling thread and the threads it starts.
+ *
+ * Counters are opened with @c perf_event_open(), user space only. Counters
+ * the kernel or the container does not allow are left out, and reported as
+ * @c null.
+ */
+struct bench_counters {
+	int fd[BENCH_COUNTERS];		  /**< Event descriptors, -1 if unavailable. */
+	bool valid[BENCH_COUNTERS];	  /**< @c true if the value was read. */
+	uint64_t values[BENCH_COUNTERS];  /**< Counts, scaled up if the event was multiplexed. */
+};
+
+/**
+ * The outcome of a single benchmark.
+ */
+struct bench_result {
+	const char *name;			/**< Name of the benchmark. */
+	uint64_t ops;				/**< Number of operations timed. */
+	uint64_t elapsed_ns;			/**< Wall clock time of all operations. */
+	const struct bench_hist *latency;	/**< Per operation latencies, may be @c NULL. */
+	const struct bench_counters *counters; /**< Hardware counters, may be @c NULL. */
+};
+
+/**
+ * Read a monotonic clock.
+ *
+ * @returns The current time in nanoseconds.
+ */
+uint64_t bench_now_ns(void);
+
+/**
+ * Record a latency in a histogram.
+ *
+ * @param h The histogram.
+ * @param ns The latency in nanoseconds.
+ */
+void bench_hist_record(struct bench_hist *h, uint64_t ns);
+
+/**
+ * Get a percentile of the recorded latencies.
+ *
+ * @param h The histogram.
+ * @param pct The percentile, between 0 and 100.
+ * @returns The upper bound of the bucket holding the percentile, 0 if nothing was recorded.
+ */
+uint64_t bench_hist_percentile(const struct bench_hist *h, double pct);
+
+/**
+ * Open and start the hardware counters.
+ *
+ * @param c The counters.
+ */
+void bench_counters_start(struct bench_counters *c);
+
+/**
+ * Stop the hardware counters, read them and close them.
+ *
+ * @param c The counters, started with @c bench_counters_start().
+ */
+void bench_counters_stop(struct bench_counters *c);
+
+/**
+ * Write a benchmark result as a line of JSON.
+ *
+ * @param out The stream to write to.
+ * @param r The result.
+ */
+void bench_report(FILE *out, const struct bench_result *r);
+
+#endif /* RAISE_BENCH_H */
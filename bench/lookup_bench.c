@@ -0,0 +1,146 @@
+/*
+ * lookup_bench -- Throughput of batched lookups against one at a time
+ *
+ * Usage: lookup_bench [nobj] [nlookup]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "vector.h"
+#include "mphf.h"
+
+/* lookups handed to a batched call at once */
+#define BATCH 1024
+
+typedef void (*lookup_fn)(void *, const uint64_t *, size_t, uint64_t *);
+
+struct lookup {
+	struct vector *sorted;
+	struct vector *arranged;
+	struct mphf *h;
+};
+
+static int cmp_u64(const void *key, const void *obj)
+{
+	uint64_t a = *(const uint64_t *)key, b = *(const uint64_t *)obj;
+	return (a > b) - (a < b);
+}
+
+static void lower_bound_single(void *arg, const uint64_t *keys, size_t k, uint64_t *sum)
+{
+	struct lookup *l  = arg;
+	const uint64_t *x = vector_data(l->sorted);
+	size_t n	  = vector_size(l->sorted);
+	for (size_t i = 0; i < k; i++) {
+		size_t lo = 0, hi = n;
+		while (lo < hi) {
+			size_t mid = lo + ((hi - lo) / 2);
+			if (cmp_u64(&keys[i], &x[mid]) > 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		*sum += lo;
+	}
+}
+
+static void lower_bound_batch(void *arg, const uint64_t *keys, size_t k, uint64_t *sum)
+{
+	struct lookup *l = arg;
+	size_t out[BATCH];
+	vector_lower_bound_batch(l->sorted, cmp_u64, keys, sizeof *keys, k, out);
+	for (size_t i = 0; i < k; i++)
+		*sum += out[i];
+}
+
+static void mphf_single(void *arg, const uint64_t *keys, size_t k, uint64_t *sum)
+{
+	struct lookup *l = arg;
+	for (size_t i = 0; i < k; i++) {
+		uint64_t obj;
+		if (mphf_get(l->h, l->arranged, &keys[i], &obj) == VEC_SUCCESS)
+			*sum += obj;
+	}
+}
+
+static void mphf_batch(void *arg, const uint64_t *keys, size_t k, uint64_t *sum)
+{
+	struct lookup *l = arg;
+	uint64_t objs[BATCH];
+	mphf_get_batch(l->h, l->arranged, keys, sizeof *keys, k, objs, NULL);
+	for (size_t i = 0; i < k; i++)
+		*sum += objs[i];
+}
+
+static void bench_lookup(const char *name, lookup_fn fn, struct lookup *l, const uint64_t *keys,
+			 size_t nlookup)
+{
+	struct bench_counters counters;
+	bench_counters_start(&counters);
+
+	uint64_t sum   = 0;
+	uint64_t begin = bench_now_ns();
+	for (size_t i = 0; i < nlookup; i += BATCH)
+		fn(l, keys + i, nlookup - i < BATCH ? nlookup - i : BATCH, &sum);
+	uint64_t elapsed = bench_now_ns() - begin;
+	bench_counters_stop(&counters);
+
+	/* keeps the lookups from being optimized away */
+	if (sum == 1)
+		fprintf(stderr, "%s: unlikely sum\n", name);
+
+	struct bench_result r = {
+		.name	    = name,
+		.ops	    = nlookup,
+		.elapsed_ns = elapsed,
+		.counters   = &counters,
+	};
+	bench_report(stdout, &r);
+}
+
+int main(int argc, char **argv)
+{
+	size_t nobj    = argc > 1 ? strtoull(argv[1], NULL, 10) : 1 << 25;
+	size_t nlookup = argc > 2 ? strtoull(argv[2], NULL, 10) : 1 << 23;
+
+	struct lookup l = { .sorted = vector_new(nobj ? nobj : 1, sizeof(uint64_t)) };
+	uint64_t *keys	= malloc((nlookup ? nlookup : 1) * sizeof *keys);
+	if (!l.sorted || !keys) {
+		fprintf(stderr, "lookup_bench: out of memory\n");
+		return 1;
+	}
+
+	for (uint64_t i = 0; i < nobj; i++) {
+		uint64_t x = 3 * i;
+		vector_push(l.sorted, &x);
+	}
+	vector_make_immutable(l.sorted);
+
+	if (mphf_build(&l.h, l.sorted, 0, sizeof(uint64_t), 0) != VEC_SUCCESS
+	    || mphf_arrange(l.h, l.sorted, &l.arranged) != VEC_SUCCESS) {
+		fprintf(stderr, "lookup_bench: mphf_build failed\n");
+		return 1;
+	}
+
+	uint64_t state = 0x9e3779b97f4a7c15;
+	for (size_t i = 0; i < nlookup; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		keys[i] = 3 * (state % (nobj ? nobj : 1));
+	}
+
+	bench_lookup("lower_bound_single", lower_bound_single, &l, keys, nlookup);
+	bench_lookup("lower_bound_batch", lower_bound_batch, &l, keys, nlookup);
+	bench_lookup("mphf_get_single", mphf_single, &l, keys, nlookup);
+	bench_lookup("mphf_get_batch", mphf_batch, &l, keys, nlookup);
+
+	mphf_free(&l.h);
+	vector_free(&l.arranged, NULL);
+	vector_free(&l.sorted, NULL);
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * seqvec_bench -- Scaling of reads of a published vector with the readers
+ *
+ * A writer publishes a 256 byte vector every 100us while readers copy it
+ * out, either from a seqvec or from a vector guarded by a rwlock.
+ *
+ * Usage: seqvec_bench [nread] [max_threads]
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "bench.h"
+#include "vector.h"
+#include "seqvec.h"
+
+#define NOBJ 32
+
+struct shared {
+	struct seqvec *s;
+
+	pthread_rwlock_t lock;
+	uint64_t guarded[NOBJ];
+
+	bool use_seqvec;
+	size_t nread;
+	_Atomic bool done;
+};
+
+static void *reader(void *arg)
+{
+	struct shared *sh  = arg;
+	struct vector *out = vector_new(NOBJ, sizeof(uint64_t));
+	uint64_t sum	   = 0;
+
+	/* both copy into a vector, so that only the synchronization differs */
+	for (size_t i = 0; i < sh->nread; i++) {
+		if (sh->use_seqvec) {
+			seqvec_read(sh->s, out);
+		} else {
+			pthread_rwlock_rdlock(&sh->lock);
+			vector_resize(out, NOBJ);
+			memcpy(vector_data(out), sh->guarded, sizeof sh->guarded);
+			pthread_rwlock_unlock(&sh->lock);
+		}
+		sum += *(uint64_t *)vector_data(out);
+	}
+
+	vector_free(&out, NULL);
+	return (void *)(uintptr_t)sum;
+}
+
+static void *writer(void *arg)
+{
+	struct shared *sh = arg;
+	struct vector *in = vector_new(NOBJ, sizeof(uint64_t));
+	vector_resize(in, NOBJ);
+
+	struct timespec pause = { 0, 100 * 1000 };
+	for (uint64_t k = 0; !atomic_load(&sh->done); k++) {
+		uint64_t *x = vector_data(in);
+		for (size_t i = 0; i < NOBJ; i++)
+			x[i] = k + i;
+
+		if (sh->use_seqvec) {
+			seqvec_publish(sh->s, in);
+		} else {
+			pthread_rwlock_wrlock(&sh->lock);
+			memcpy(sh->guarded, x, sizeof sh->guarded);
+			pthread_rwlock_unlock(&sh->lock);
+		}
+		nanosleep(&pause, NULL);
+	}
+
+	vector_free(&in, NULL);
+	return NULL;
+}
+
+static void bench_readers(const char *kind, struct shared *sh, size_t nthreads)
+{
+	pthread_t w, readers[nthreads];
+	atomic_store(&sh->done, false);
+	pthread_create(&w, NULL, writer, sh);
+
+	struct bench_counters counters;
+	bench_counters_start(&counters);
+
+	uint64_t begin = bench_now_ns();
+	for (size_t t = 0; t < nthreads; t++)
+		pthread_create(&readers[t], NULL, reader, sh);
+	for (size_t t = 0; t < nthreads; t++)
+		pthread_join(readers[t], NULL);
+	uint64_t elapsed = bench_now_ns() - begin;
+
+	bench_counters_stop(&counters);
+	atomic_store(&sh->done, true);
+	pthread_join(w, NULL);
+
+	char name[64];
+	snprintf(name, sizeof name, "%s_read_t%zu", kind, nthreads);
+	struct bench_result r = {
+		.name	    = name,
+		.ops	    = sh->nread * nthreads,
+		.elapsed_ns = elapsed,
+		.counters   = &counters,
+	};
+	bench_report(stdout, &r);
+}
+
+int main(int argc, char **argv)
+{
+	long online	   = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t nread	   = argc > 1 ? strtoull(argv[1], NULL, 10) : 1 << 22;
+	size_t max_threads = argc > 2 ? strtoull(argv[2], NULL, 10) : online > 0 ? online : 1;
+
+	struct shared sh = { .s = seqvec_new(NOBJ, sizeof(uint64_t)), .nread = nread };
+	if (!sh.s || pthread_rwlock_init(&sh.lock, NULL) != 0) {
+		fprintf(stderr, "seqvec_bench: initialization failed\n");
+		return 1;
+	}
+
+	for (size_t n = 1; n <= max_threads; n *= 2) {
+		sh.use_seqvec = true;
+		bench_readers("seqvec", &sh, n);
+		sh.use_seqvec = false;
+		bench_readers("rwlock", &sh, n);
+	}
+
+	pthread_rwlock_destroy(&sh.lock);
+	seqvec_free(&sh.s);
+	return 0;
+}
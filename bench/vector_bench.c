@@ -0,0 +1,72 @@
+/*
+ * vector_bench -- Latency of pushes under the different growth strategies
+ *
+ * Usage: vector_bench [npush]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "vector.h"
+
+enum growth {
+	GROWTH_SYNC,
+	GROWTH_PREGROW,
+	GROWTH_INCREMENTAL
+};
+
+static void bench_push(const char *name, enum growth growth, size_t npush)
+{
+	static struct bench_hist hist;
+	hist = (struct bench_hist){ 0 };
+
+	struct vector *v = vector_new(0, sizeof(uint64_t));
+	if (!v) {
+		fprintf(stderr, "%s: vector_new failed\n", name);
+		exit(1);
+	}
+
+	if (growth == GROWTH_PREGROW)
+		vector_pregrowth(v, 75);
+	else if (growth == GROWTH_INCREMENTAL)
+		vector_incremental_growth(v, 64 * 1024);
+
+	struct bench_counters counters;
+	bench_counters_start(&counters);
+
+	uint64_t begin = bench_now_ns();
+	for (uint64_t i = 0; i < npush; i++) {
+		uint64_t t = bench_now_ns();
+		if (vector_push(v, &i) != VEC_SUCCESS) {
+			fprintf(stderr, "%s: vector_push failed\n", name);
+			exit(1);
+		}
+		bench_hist_record(&hist, bench_now_ns() - t);
+	}
+	uint64_t elapsed = bench_now_ns() - begin;
+	bench_counters_stop(&counters);
+
+	struct bench_result r = {
+		.name	    = name,
+		.ops	    = npush,
+		.elapsed_ns = elapsed,
+		.latency    = &hist,
+		.counters   = &counters,
+	};
+	bench_report(stdout, &r);
+
+	vector_free(&v, NULL);
+}
+
+int main(int argc, char **argv)
+{
+	size_t npush = argc > 1 ? strtoull(argv[1], NULL, 10) : 1 << 24;
+
+	bench_push("push_sync", GROWTH_SYNC, npush);
+	bench_push("push_pregrow", GROWTH_PREGROW, npush);
+	bench_push("push_incremental", GROWTH_INCREMENTAL, npush);
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file
+ * The Checkpoint Interface
+ *
+ * This header defines incremental checkpoints of vectors.
+ *
+ * A checkpoint tracker watches the array of a vector for writes. The first
+ * checkpoint written is a full copy of the vector (the base), every later one
+ * only holds the pages written since the previous checkpoint (a delta). A
+ * vector is restored by applying the base and then each delta in order.
+ *
+ * Writes are tracked by write protecting the array with @c mprotect() and
+ * catching the first write to each page in a @c SIGSEGV handler. The array
+ * must only be written by user space code while tracked; a system call like
+ * @c read() writing into it fails with @c EFAULT.
+ */
+
+#ifndef ASMS_CHECKPOINT_H
+#define ASMS_CHECKPOINT_H
+
+#include <stdio.h>
+
+#include "vector.h"
+
+/**
+ * List of possible error codes for checkpoint functions
+ */
+enum ckpt_error {
+	CKPT_SUCCESS = 0,  /**< No errors. Operation successfully. */
+	CKPT_EINVAL  = -1, /**< Invalid argument. */
+	CKPT_ENOMEM  = -2, /**< Memory allocation failed. */
+	CKPT_EIO     = -3, /**< Reading or writing the checkpoint failed. */
+	CKPT_EFORMAT = -4  /**< Not a checkpoint, or does not apply to the vector. */
+};
+
+/**
+ * Start tracking writes to a vector
+ *
+ * The vector must outlive the tracker. Growing, fitting or permuting the
+ * vector replaces its array, which is unprotected before it is released;
+ * the next checkpoint is then a full one again. The tracker listens for
+ * that with @c vector_array_listener(). Indirect vectors can not be tracked.
+ *
+ * @param v The vector pointer.
+ * @returns A pointer to the tracker, which must be freed with @c ckpt_free().
+ *          @c NULL if @c v is indirect or has an array listener already, memory
+ *          allocation failed or too many vectors are tracked.
+ */
+struct ckpt *ckpt_new(struct vector *v);
+
+/**
+ * Stop tracking and free the tracker
+ *
+ * @param cp A pointer to the tracker pointer. @c *cp is @c NULL after calling this.
+ */
+void ckpt_free(struct ckpt **cp);
+
+/**
+ * Write a checkpoint of the tracked vector
+ *
+ * The first checkpoint, and the first one after the array of the vector
+ * was replaced, holds the whole vector. Others only hold the pages written
+ * since the previous checkpoint.
+ *
+ * @param c The tracker pointer.
+ * @param out The stream to write the checkpoint to.
+ * @returns @c CKPT_SUCCESS on success, otherwise an error code as in <tt>enum ckpt_error</tt>.
+ */
+int ckpt_write(struct ckpt *c, FILE *out);
+
+/**
+ * Returns @c true if the next checkpoint holds the whole vector.
+ *
+ * @param c The tracker pointer.
+ * @returns @c true if the next checkpoint is a base. Also @c true if @c c is @c NULL.
+ */
+bool ckpt_next_is_full(struct ckpt *c);
+
+/**
+ * Apply a checkpoint to a vector
+ *
+ * A full checkpoint creates the vector, which must then be freed with
+ * @c vector_free(). Following deltas must be applied in the order they
+ * were written.
+ *
+ * @param vp A pointer to the vector pointer. @c *vp must be @c NULL for a full
+ *        checkpoint, and the restored vector for a delta.
+ * @param in The stream to read the checkpoint from.
+ * @returns @c CKPT_SUCCESS on success, otherwise an error code as in <tt>enum ckpt_error</tt>.
+ */
+int ckpt_apply(struct vector **vp, FILE *in);
+
+#endif /* ASMS_CHECKPOINT_H */
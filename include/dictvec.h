@@ -0,0 +1,134 @@
+/**
+ * @file
+ * The Dictionary Encoded Vector Interface
+ *
+ * This header defines vectors of objects drawn from a small set of distinct
+ * values. Each distinct object is stored once in a dictionary, and the vector
+ * itself only holds the code of the object's dictionary entry. Codes take 1,
+ * 2 or 4 bytes, growing with the dictionary.
+ *
+ * Predicates are evaluated once per dictionary entry and then matched
+ * against the codes, without decoding any object.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>.
+ */
+
+#ifndef ASMS_DICTVEC_H
+#define ASMS_DICTVEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector.h"
+
+/**
+ * Initialize a new empty dictionary encoded vector
+ *
+ * Objects are compared and hashed bytewise.
+ *
+ * @param objsz Number of bytes occupied by each object.
+ * @returns A pointer to the vector, which must be freed with @c dictvec_free().
+ *          @c NULL when memory allocation failed.
+ */
+struct dictvec *dictvec_new(size_t objsz);
+
+/**
+ * Free the resources allocated by the vector
+ *
+ * @param dp A pointer to the vector pointer. @c *dp is @c NULL after calling this.
+ */
+void dictvec_free(struct dictvec **dp);
+
+/**
+ * Get the number of objects.
+ *
+ * @param d The vector pointer.
+ * @returns The number of objects, 0 if @c d is @c NULL.
+ */
+size_t dictvec_size(struct dictvec *d);
+
+/**
+ * Get the number of distinct objects.
+ *
+ * @param d The vector pointer.
+ * @returns The number of dictionary entries, 0 if @c d is @c NULL.
+ */
+size_t dictvec_cardinality(struct dictvec *d);
+
+/**
+ * Get the number of bytes taken by a code.
+ *
+ * @param d The vector pointer.
+ * @returns 1, 2 or 4. 0 if @c d is @c NULL.
+ */
+size_t dictvec_code_size(struct dictvec *d);
+
+/**
+ * Append an object to the end of the vector.
+ *
+ * @param d The vector pointer.
+ * @param p A pointer to the object to append.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int dictvec_push(struct dictvec *d, void *p);
+
+/**
+ * Get the object at the given index.
+ *
+ * @param d The vector pointer.
+ * @param idx Index of the object.
+ * @param p The retrieved object will be stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int dictvec_get(struct dictvec *d, size_t idx, void *p);
+
+/**
+ * Get the code of the object at the given index.
+ *
+ * @param d The vector pointer.
+ * @param idx Index of the object.
+ * @param code The code is stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int dictvec_code(struct dictvec *d, size_t idx, uint32_t *code);
+
+/**
+ * Find the code of an object.
+ *
+ * @param d The vector pointer.
+ * @param p A pointer to the object.
+ * @param code The code is stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, @c VEC_ERANGE if the object is not in the dictionary,
+ *          otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int dictvec_lookup(struct dictvec *d, void *p, uint32_t *code);
+
+/**
+ * Select the objects equal to the given one.
+ *
+ * Indices of the matching objects are appended to @c sel in increasing order.
+ * The codes are compared 32 bytes at a time with AVX2 when available.
+ *
+ * @param d The vector pointer.
+ * @param p A pointer to the object to compare with.
+ * @param sel A vector of @c size_t indices.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int dictvec_select_eq(struct dictvec *d, void *p, struct vector *sel);
+
+/**
+ * Select the objects matching a predicate.
+ *
+ * The predicate is called once per distinct object, never per object.
+ * Indices of the matching objects are appended to @c sel in increasing order.
+ *
+ * @param d The vector pointer.
+ * @param pred The predicate, given a distinct object and @c arg.
+ * @param arg Passed to @c pred as is.
+ * @param sel A vector of @c size_t indices.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int dictvec_select(struct dictvec *d, bool (*pred)(void *, void *), void *arg, struct vector *sel);
+
+#endif /* ASMS_DICTVEC_H */
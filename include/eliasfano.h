@@ -0,0 +1,102 @@
+/**
+ * @file
+ * The Elias-Fano Sequence Interface
+ *
+ * This header defines compressed, immutable monotone sequences of 64 bit
+ * integers, such as posting lists or offsets.
+ *
+ * Elias-Fano encoding splits each of the n values of a sequence bounded by
+ * u in l = log2(u / n) low bits, stored packed, and high bits, stored in
+ * unary as a bitvector of at most 3n bits. This takes about
+ * 2 + log2(u / n) bits per value, close to the log2(u choose n) minimum.
+ *
+ * Positions of every 512th set and unset bit of the high bits are sampled,
+ * adding a quarter of a bit per value, so that accessing a value by its
+ * index only scans a few words. Finding the first value not below a bound
+ * selects the values sharing its high bits the same way, and binary
+ * searches their low bits.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>.
+ */
+
+#ifndef ASMS_ELIASFANO_H
+#define ASMS_ELIASFANO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector.h"
+
+struct eliasfano;
+
+/**
+ * Encode a monotone sequence
+ *
+ * @param ep The sequence pointer is stored here. It must be freed with @c eliasfano_free().
+ * @param v A vector of @c uint64_t, in nondecreasing order. Indirect vectors are not supported.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ *          @c VEC_EINVAL if @c v is not sorted.
+ */
+int eliasfano_build(struct eliasfano **ep, struct vector *v);
+
+/**
+ * Free the resources allocated by the sequence
+ *
+ * @param ep A pointer to the sequence pointer. @c *ep is @c NULL after calling this.
+ */
+void eliasfano_free(struct eliasfano **ep);
+
+/**
+ * Get the number of values.
+ *
+ * @param e The sequence pointer.
+ * @returns The number of values, 0 if @c e is @c NULL.
+ */
+size_t eliasfano_size(struct eliasfano *e);
+
+/**
+ * Get the number of bits taken by the sequence.
+ *
+ * @param e The sequence pointer.
+ * @returns The number of bits of the encoded values and their samples, 0 if @c e is @c NULL.
+ */
+size_t eliasfano_bits(struct eliasfano *e);
+
+/**
+ * Get the value at the given index.
+ *
+ * @param e The sequence pointer.
+ * @param idx Index of the value.
+ * @param p The value is stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int eliasfano_get(struct eliasfano *e, size_t idx, uint64_t *p);
+
+/**
+ * Find the first value not below a bound.
+ *
+ * @param e The sequence pointer.
+ * @param x The bound.
+ * @param idx The index of the first value not below @c x is stored here. Must not be @c NULL.
+ * @param p The value is stored here. @c NULL if not needed.
+ * @returns @c VEC_SUCCESS on success, @c VEC_ERANGE if every value is below @c x,
+ *          otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int eliasfano_next_geq(struct eliasfano *e, uint64_t x, size_t *idx, uint64_t *p);
+
+/**
+ * Decode consecutive values.
+ *
+ * The low bits of the values are unpacked in one pass, then the high bits
+ * are merged in while walking the set bits of the high bitvector, so the
+ * cost per value is a few instructions.
+ *
+ * @param e The sequence pointer.
+ * @param begin Index of the first value.
+ * @param n Number of values.
+ * @param out An array of @c n values, filled with the values at [begin, begin + n).
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int eliasfano_decode(struct eliasfano *e, size_t begin, size_t n, uint64_t *out);
+
+#endif /* ASMS_ELIASFANO_H */
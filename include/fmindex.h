@@ -0,0 +1,107 @@
+/**
+ * @file
+ * The FM-Index Interface
+ *
+ * This header defines suffix arrays and compressed full-text indexes over
+ * vectors of bytes, finding every occurrence of a substring in time that
+ * depends on the length of the substring and the number of occurrences,
+ * but not on the length of the text.
+ *
+ * Suffix arrays are built with SA-IS, which sorts a sample of the suffixes
+ * recursively and induces the order of the others from it, in linear time.
+ *
+ * The index keeps the Burrows-Wheeler transform of the text, the last
+ * bytes of its sorted rotations, in a Huffman shaped wavelet tree: a tree
+ * of bitvectors with rank directories, taking close to the zero order
+ * entropy of the text plus an eighth. Counting the occurrences of a pattern
+ * of m bytes narrows the range of rotations starting with it one byte at a
+ * time, with m rank queries per level of the tree. Locating them walks
+ * each rotation back to one whose position was sampled, every 32 bytes of
+ * the text, at most 31 steps away.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>.
+ */
+
+#ifndef ASMS_FMINDEX_H
+#define ASMS_FMINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector.h"
+
+struct fmindex;
+
+/**
+ * Build the suffix array of a text
+ *
+ * @param text A vector of bytes, of object size 1. Indirect vectors are not supported.
+ * @param sa A vector of @c size_t, resized to the length of the text. The starts of
+ *        the suffixes of the text are stored in it, in lexicographic order.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int fmindex_suffix_array(struct vector *text, struct vector *sa);
+
+/**
+ * Index a text
+ *
+ * The text is not referred to afterwards. Building takes about 25 bytes of
+ * transient memory per byte of text.
+ *
+ * @param fp The index pointer is stored here. It must be freed with @c fmindex_free().
+ * @param text A vector of bytes, of object size 1. Indirect vectors are not supported.
+ * @param nthreads Number of threads deriving the index from the suffix array. If 0,
+ *        one per online processor. The suffix array itself is built by one thread.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int fmindex_build(struct fmindex **fp, struct vector *text, size_t nthreads);
+
+/**
+ * Free the resources allocated by the index
+ *
+ * @param fp A pointer to the index pointer. @c *fp is @c NULL after calling this.
+ */
+void fmindex_free(struct fmindex **fp);
+
+/**
+ * Get the length of the indexed text.
+ *
+ * @param f The index pointer.
+ * @returns The number of bytes of the text, 0 if @c f is @c NULL.
+ */
+size_t fmindex_size(struct fmindex *f);
+
+/**
+ * Get the number of bits taken by the index.
+ *
+ * @param f The index pointer.
+ * @returns The number of bits, 0 if @c f is @c NULL.
+ */
+size_t fmindex_bits(struct fmindex *f);
+
+/**
+ * Count the occurrences of a pattern.
+ *
+ * Occurrences may overlap.
+ *
+ * @param f The index pointer.
+ * @param pattern The bytes of the pattern.
+ * @param len Length of the pattern, at least 1.
+ * @param count The number of occurrences will be stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int fmindex_count(struct fmindex *f, const void *pattern, size_t len, size_t *count);
+
+/**
+ * Locate the occurrences of a pattern.
+ *
+ * @param f The index pointer.
+ * @param pattern The bytes of the pattern.
+ * @param len Length of the pattern, at least 1.
+ * @param out A vector of @c size_t, the positions in the text where the pattern
+ *        occurs are appended to it, in increasing order.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int fmindex_locate(struct fmindex *f, const void *pattern, size_t len, struct vector *out);
+
+#endif /* ASMS_FMINDEX_H */
@@ -0,0 +1,96 @@
+/**
+ * @file
+ * The Interval Tree Interface
+ *
+ * This header defines an index over the [start, end) ranges of the objects
+ * of a vector, answering which ranges overlap a query range.
+ *
+ * The ranges are sorted by start into a flat array that doubles as an
+ * implicit binary search tree, as in cgranges: the node at index i of
+ * level k has its children at i - 2^(k-1) and i + 2^(k-1), and every node
+ * keeps the largest end of its subtree. A query walks down the subtrees
+ * whose largest end passes its start, and stops at nodes starting past its
+ * end, in O(log n + k) for k overlapping ranges. There are no pointers, and
+ * small subtrees are scanned as a run of the array.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>.
+ */
+
+#ifndef ASMS_ITREE_H
+#define ASMS_ITREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector.h"
+#include "jagged.h"
+
+struct itree;
+
+/**
+ * A [start, end) range.
+ */
+struct itree_range {
+	int64_t start; /**< First point of the range. */
+	int64_t end;   /**< Point past the range. */
+};
+
+/**
+ * Index the ranges of the objects of a vector
+ *
+ * The ranges are copied, the vector is not referred to afterwards.
+ *
+ * @param tp The tree pointer is stored here. It must be freed with @c itree_free().
+ * @param v The vector of objects. Indirect vectors are not supported.
+ * @param startoff Offset of the @c int64_t start of the range within an object.
+ * @param endoff Offset of the @c int64_t end of the range within an object.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int itree_build(struct itree **tp, struct vector *v, size_t startoff, size_t endoff);
+
+/**
+ * Free the resources allocated by the tree
+ *
+ * @param tp A pointer to the tree pointer. @c *tp is @c NULL after calling this.
+ */
+void itree_free(struct itree **tp);
+
+/**
+ * Get the number of ranges.
+ *
+ * @param t The tree pointer.
+ * @returns The number of ranges, 0 if @c t is @c NULL.
+ */
+size_t itree_size(struct itree *t);
+
+/**
+ * Find the ranges overlapping a range.
+ *
+ * Ranges [a, b) and [c, d) overlap if a < d and c < b. Empty queries
+ * overlap nothing.
+ *
+ * @param t The tree pointer.
+ * @param start First point of the query range.
+ * @param end Point past the query range.
+ * @param out A vector of @c size_t, the indices of the objects whose ranges overlap
+ *        are appended to it, in the order of the starts of their ranges.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int itree_overlap(struct itree *t, int64_t start, int64_t end, struct vector *out);
+
+/**
+ * Find the ranges overlapping each of many ranges.
+ *
+ * The queries are run in the order of their starts, so that consecutive
+ * queries walk the same parts of the tree.
+ *
+ * @param t The tree pointer.
+ * @param q An array of @c k query ranges.
+ * @param k Number of queries.
+ * @param out A jagged array of @c size_t, a row is added per query, in the order
+ *        of @c q, holding what @c itree_overlap() would append for it.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int itree_overlap_batch(struct itree *t, const struct itree_range *q, size_t k, struct jagged *out);
+
+#endif /* ASMS_ITREE_H */
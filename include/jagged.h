@@ -0,0 +1,127 @@
+/**
+ * @file
+ * The Jagged Array Interface
+ *
+ * This header defines the interface for jagged arrays, a list of rows
+ * of varying length. All objects are stored back to back in a single
+ * vector, row after row, and a second vector holds the offset of each row
+ * (compressed sparse row layout). Compared to a vector of vectors there is
+ * no allocation per row, and walking the rows walks memory in order.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>.
+ */
+
+#ifndef ASMS_JAGGED_H
+#define ASMS_JAGGED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "vector.h"
+
+/**
+ * The objects of a row, stored back to back.
+ */
+struct jagged_span {
+	void *data;  /**< The first object of the row, @c NULL for empty rows. */
+	size_t size; /**< Number of objects in the row. */
+};
+
+/**
+ * Initialize a new empty jagged array
+ *
+ * @param objsz Number of bytes occupied by each object.
+ * @returns A pointer to the jagged array, which must be freed with @c jagged_free().
+ *          @c NULL when memory allocation failed.
+ */
+struct jagged *jagged_new(size_t objsz);
+
+/**
+ * Build a jagged array from (row, object) pairs
+ *
+ * Objects are grouped by their row with a counting sort, keeping the
+ * order of the objects within a row.
+ *
+ * @param rows A vector of @c size_t row indices, each less than @c nrows. Indirect
+ *        vectors are not supported.
+ * @param objs A vector of objects, the row of the i-th one is the i-th index of @c rows.
+ * @param nrows Number of rows of the jagged array, rows without objects are empty.
+ * @returns A pointer to the jagged array, which must be freed with @c jagged_free().
+ *          @c NULL when the vectors do not match or memory allocation failed.
+ */
+struct jagged *jagged_build(struct vector *rows, struct vector *objs, size_t nrows);
+
+/**
+ * Free the resources allocated by the jagged array
+ *
+ * @param jp A pointer to the jagged array pointer. @c *jp is @c NULL after calling this.
+ * @param elem_dtor A pointer to object deconstructor function, called on each object.
+ */
+void jagged_free(struct jagged **jp, void (*elem_dtor)(void *));
+
+/**
+ * Get the number of rows.
+ *
+ * @param j The jagged array pointer.
+ * @returns The number of rows, 0 if @c j is @c NULL.
+ */
+size_t jagged_rows(struct jagged *j);
+
+/**
+ * Get the number of objects in all rows.
+ *
+ * @param j The jagged array pointer.
+ * @returns The number of objects, 0 if @c j is @c NULL.
+ */
+size_t jagged_size(struct jagged *j);
+
+/**
+ * Get the size of an object.
+ *
+ * @param j The jagged array pointer.
+ * @returns The number of bytes occupied by each object, 0 if @c j is @c NULL.
+ */
+size_t jagged_object_size(struct jagged *j);
+
+/**
+ * Append a new empty row.
+ *
+ * @param j The jagged array pointer.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int jagged_add_row(struct jagged *j);
+
+/**
+ * Append an object to the last row.
+ *
+ * @param j The jagged array pointer.
+ * @param p A pointer to the object to append.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ *          @c VEC_ERANGE if there are no rows yet.
+ */
+int jagged_push(struct jagged *j, void *p);
+
+/**
+ * Get the objects of a row.
+ *
+ * The span stays valid until the next object is appended.
+ *
+ * @param j The jagged array pointer.
+ * @param row Index of the row.
+ * @param span The objects of the row are stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int jagged_row(struct jagged *j, size_t row, struct jagged_span *span);
+
+/**
+ * Get an object of a row.
+ *
+ * @param j The jagged array pointer.
+ * @param row Index of the row.
+ * @param idx Index of the object within the row.
+ * @param p The retrieved object will be stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int jagged_get(struct jagged *j, size_t row, size_t idx, void *p);
+
+#endif /* ASMS_JAGGED_H */
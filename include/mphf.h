@@ -0,0 +1,156 @@
+/**
+ * @file
+ * The Minimal Perfect Hash Interface
+ *
+ * This header defines minimal perfect hash functions over the keys of
+ * immutable vectors.
+ *
+ * The key of an object is a field of it, given by an offset and a length,
+ * and compared bytewise. A minimal perfect hash function maps each of the n
+ * distinct keys of a vector to its own slot in [0, n), and is stored in about
+ * 3 bits per key instead of the keys themselves.
+ *
+ * Construction follows PTHash: keys are split into partitions built in
+ * parallel, each partition hashes its keys into buckets, and buckets pick a
+ * pilot value in decreasing size order so that their keys land on free slots.
+ * Pilots are stored dictionary encoded.
+ *
+ * Once a vector is arranged by the hash function, finding the object with
+ * a given key reads a single object of the vector. Batched lookups prefetch
+ * the reads of many keys at once, so that their cache misses overlap.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>, except for reading and
+ * writing which use <tt>enum ckpt_error</tt> as the index is meant to be
+ * stored next to vector checkpoints.
+ */
+
+#ifndef ASMS_MPHF_H
+#define ASMS_MPHF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "vector.h"
+#include "checkpoint.h"
+
+struct mphf;
+
+/**
+ * Build a minimal perfect hash function over the keys of a vector
+ *
+ * @param hp The hash function pointer is stored here. It must be freed with @c mphf_free().
+ * @param v An immutable vector with distinct keys. Indirect vectors are not supported.
+ * @param keyoff Offset of the key within an object.
+ * @param keylen Number of bytes of the key, not 0.
+ * @param nthreads Number of threads building the hash function. If 0, one per online processor.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ *          @c VEC_EINVAL if @c v is mutable or has duplicate keys.
+ */
+int mphf_build(struct mphf **hp, struct vector *v, size_t keyoff, size_t keylen, size_t nthreads);
+
+/**
+ * Free the resources allocated by the hash function
+ *
+ * @param hp A pointer to the hash function pointer. @c *hp is @c NULL after calling this.
+ */
+void mphf_free(struct mphf **hp);
+
+/**
+ * Get the number of keys.
+ *
+ * @param h The hash function pointer.
+ * @returns The number of keys, 0 if @c h is @c NULL.
+ */
+size_t mphf_size(struct mphf *h);
+
+/**
+ * Get the number of bits taken by the hash function.
+ *
+ * @param h The hash function pointer.
+ * @returns The number of bits, 0 if @c h is @c NULL.
+ */
+size_t mphf_bits(struct mphf *h);
+
+/**
+ * Get the slot of a key.
+ *
+ * @param h The hash function pointer.
+ * @param key A pointer to the key bytes.
+ * @returns A distinct slot in [0, n) for each of the n keys the function was built from.
+ *          Other keys get an arbitrary slot.
+ */
+size_t mphf_index(struct mphf *h, const void *key);
+
+/**
+ * Get the slots of many keys.
+ *
+ * @param h The hash function pointer.
+ * @param keys A pointer to the first key.
+ * @param stride Bytes from a key to the next, at least the key length. Keys may be
+ *        fields of an array of objects.
+ * @param k Number of keys.
+ * @param out The slot of the i-th key, as given by @c mphf_index(), is stored at <tt>out[i]</tt>.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int mphf_index_batch(struct mphf *h, const void *keys, size_t stride, size_t k, size_t *out);
+
+/**
+ * Arrange the objects of a vector by the slots of their keys
+ *
+ * @param h The hash function pointer.
+ * @param v The vector the hash function was built from.
+ * @param out The new immutable vector is stored here, the object with key k at
+ *        index <tt>mphf_index(h, k)</tt>. It must be freed with @c vector_free().
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int mphf_arrange(struct mphf *h, struct vector *v, struct vector **out);
+
+/**
+ * Get the object with the given key from an arranged vector.
+ *
+ * @param h The hash function pointer.
+ * @param v A vector arranged with @c mphf_arrange().
+ * @param key A pointer to the key bytes.
+ * @param p The retrieved object will be stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, @c VEC_ERANGE if no object has the key,
+ *          otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int mphf_get(struct mphf *h, struct vector *v, const void *key, void *p);
+
+/**
+ * Get the objects with many keys from an arranged vector.
+ *
+ * @param h The hash function pointer.
+ * @param v A vector arranged with @c mphf_arrange().
+ * @param keys A pointer to the first key.
+ * @param stride Bytes from a key to the next, at least the key length.
+ * @param k Number of keys.
+ * @param p An array of @c k objects, the object with the i-th key is stored at its
+ *        i-th entry, zeroed if no object has the key.
+ * @param found Whether an object has the i-th key is stored at <tt>found[i]</tt>.
+ *        @c NULL if not needed.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int mphf_get_batch(struct mphf *h, struct vector *v, const void *keys, size_t stride, size_t k,
+		   void *p, bool *found);
+
+/**
+ * Write the hash function to a stream
+ *
+ * @param h The hash function pointer.
+ * @param out The stream to write to.
+ * @returns @c CKPT_SUCCESS on success, otherwise an error code as in <tt>enum ckpt_error</tt>.
+ */
+int mphf_write(struct mphf *h, FILE *out);
+
+/**
+ * Read a hash function written by @c mphf_write()
+ *
+ * @param hp The hash function pointer is stored here. It must be freed with @c mphf_free().
+ * @param in The stream to read from.
+ * @returns @c CKPT_SUCCESS on success, otherwise an error code as in <tt>enum ckpt_error</tt>.
+ */
+int mphf_read(struct mphf **hp, FILE *in);
+
+#endif /* ASMS_MPHF_H */
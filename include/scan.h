@@ -0,0 +1,146 @@
+/**
+ * @file
+ * The Scan Interface
+ *
+ * This header defines predicate scans over vectors of numbers.
+ *
+ * A scan compares every number of a vector with a predicate like
+ * <tt>x > c</tt> or <tt>a <= x < b</tt> and records the matching ones,
+ * either as a selection vector (the @c size_t indices of the matches, in
+ * increasing order) or as a bitmap (one bit per number, in @c uint64_t words).
+ * Numbers are compared straight from the array of the vector, 64 at a time
+ * with AVX2 when available.
+ *
+ * Selection vectors chain: they can restrict a further scan, and pick the
+ * numbers to gather or aggregate.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>.
+ */
+
+#ifndef ASMS_SCAN_H
+#define ASMS_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector.h"
+
+/**
+ * Type of the numbers of a vector. The object size of the vector must match.
+ */
+enum scan_type {
+	SCAN_I8,  /**< @c int8_t */
+	SCAN_U8,  /**< @c uint8_t */
+	SCAN_I16, /**< @c int16_t */
+	SCAN_U16, /**< @c uint16_t */
+	SCAN_I32, /**< @c int32_t */
+	SCAN_U32, /**< @c uint32_t */
+	SCAN_I64, /**< @c int64_t */
+	SCAN_U64, /**< @c uint64_t */
+	SCAN_F32, /**< @c float */
+	SCAN_F64  /**< @c double */
+};
+
+/**
+ * Comparison of a predicate.
+ */
+enum scan_op {
+	SCAN_LT,     /**< <tt>x < a</tt> */
+	SCAN_LE,     /**< <tt>x <= a</tt> */
+	SCAN_GT,     /**< <tt>x > a</tt> */
+	SCAN_GE,     /**< <tt>x >= a</tt> */
+	SCAN_EQ,     /**< <tt>x == a</tt> */
+	SCAN_NE,     /**< <tt>x != a</tt> */
+	SCAN_BETWEEN /**< <tt>a <= x < b</tt> */
+};
+
+/**
+ * A constant of a predicate, or the result of an aggregate.
+ *
+ * @c i is used for signed types, @c u for unsigned types and @c f for floating point types.
+ */
+union scan_value {
+	int64_t i;  /**< Signed integers. */
+	uint64_t u; /**< Unsigned integers. */
+	double f;   /**< Floating point numbers. */
+};
+
+/**
+ * A predicate on a number @c x.
+ */
+struct scan_pred {
+	enum scan_op op;    /**< The comparison. */
+	union scan_value a; /**< The constant, or the lower bound of @c SCAN_BETWEEN. */
+	union scan_value b; /**< The upper bound of @c SCAN_BETWEEN, unused otherwise. */
+};
+
+/**
+ * Aggregates of the numbers of a vector.
+ */
+struct scan_agg {
+	size_t count;	      /**< Number of numbers. */
+	union scan_value sum; /**< Sum, wrapping around for integers. */
+	union scan_value min; /**< Smallest number, undefined if @c count is 0. */
+	union scan_value max; /**< Largest number, undefined if @c count is 0. */
+};
+
+/**
+ * Select the numbers matching a predicate.
+ *
+ * @param v The vector of numbers.
+ * @param type Type of the numbers.
+ * @param pred The predicate.
+ * @param in A selection vector restricting the numbers looked at, @c NULL to scan all of them.
+ * @param sel A vector of @c size_t, the indices of the matches are appended to it.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int scan_select(struct vector *v, enum scan_type type, struct scan_pred *pred,
+		struct vector *in, struct vector *sel);
+
+/**
+ * Mark the numbers matching a predicate in a bitmap.
+ *
+ * Bit <tt>i % 64</tt> of word <tt>i / 64</tt> is set if the i-th number matches.
+ *
+ * @param v The vector of numbers.
+ * @param type Type of the numbers.
+ * @param pred The predicate.
+ * @param bitmap A vector of @c uint64_t, resized to hold one bit per number.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int scan_bitmap(struct vector *v, enum scan_type type, struct scan_pred *pred, struct vector *bitmap);
+
+/**
+ * Turn a bitmap into a selection vector.
+ *
+ * @param bitmap A vector of @c uint64_t words.
+ * @param sel A vector of @c size_t, the indices of the set bits are appended to it.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int scan_bitmap_select(struct vector *bitmap, struct vector *sel);
+
+/**
+ * Gather the selected objects of a vector.
+ *
+ * Works on objects of any size.
+ *
+ * @param v The vector of objects.
+ * @param sel A selection vector of @c size_t indices into @c v.
+ * @param out A vector of the same object size, the selected objects are appended to it.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int scan_gather(struct vector *v, struct vector *sel, struct vector *out);
+
+/**
+ * Aggregate the selected numbers of a vector.
+ *
+ * @param v The vector of numbers.
+ * @param type Type of the numbers.
+ * @param sel A selection vector of @c size_t indices into @c v, @c NULL for all numbers.
+ * @param agg The aggregates are stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int scan_aggregate(struct vector *v, enum scan_type type, struct vector *sel, struct scan_agg *agg);
+
+#endif /* ASMS_SCAN_H */
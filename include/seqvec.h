@@ -0,0 +1,90 @@
+/**
+ * @file
+ * The Published Vector Interface
+ *
+ * This header defines small vectors published by writers and read by many
+ * threads, such as statistics or configuration read on every request.
+ *
+ * Publication is guarded by a sequence lock. A writer makes the sequence
+ * number odd, copies the objects in, and makes it even again. A reader
+ * copies the objects out between two reads of the sequence number, and
+ * retries if a write was in progress or happened meanwhile. Readers never
+ * write to shared memory, so they do not contend for cache lines with each
+ * other and scale with the number of threads, while writers never wait for
+ * readers. Each read copies the whole vector, which suits vectors of a few
+ * cache lines.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>.
+ */
+
+#ifndef ASMS_SEQVEC_H
+#define ASMS_SEQVEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector.h"
+
+struct seqvec;
+
+/**
+ * Initialize a new empty published vector
+ *
+ * @param nobj Most objects the vector can hold.
+ * @param objsz Number of bytes occupied by each object.
+ * @returns A pointer to the vector, which must be freed with @c seqvec_free().
+ *          @c NULL when memory allocation failed.
+ */
+struct seqvec *seqvec_new(size_t nobj, size_t objsz);
+
+/**
+ * Free the resources allocated by the vector
+ *
+ * No thread may be reading or writing the vector.
+ *
+ * @param sp A pointer to the vector pointer. @c *sp is @c NULL after calling this.
+ */
+void seqvec_free(struct seqvec **sp);
+
+/**
+ * Get the number of publications so far.
+ *
+ * @param s The vector pointer.
+ * @returns The number of completed calls to @c seqvec_publish(), 0 if @c s is @c NULL.
+ */
+uint64_t seqvec_version(struct seqvec *s);
+
+/**
+ * Publish the objects of a vector.
+ *
+ * Concurrent writers are serialized with each other, never with readers.
+ *
+ * @param s The vector pointer.
+ * @param v A vector of objects of the published vector's size, holding at most
+ *        its capacity. Indirect vectors are not supported.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int seqvec_publish(struct seqvec *s, struct vector *v);
+
+/**
+ * Copy a consistent snapshot of the published objects.
+ *
+ * @param s The vector pointer.
+ * @param out A vector of objects of the published vector's size, resized to
+ *        the number of published objects. Indirect vectors are not supported.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int seqvec_read(struct seqvec *s, struct vector *out);
+
+/**
+ * Get a published object.
+ *
+ * @param s The vector pointer.
+ * @param idx Index of the object.
+ * @param p The object, as of a single publication, will be stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, @c VEC_ERANGE if fewer objects are published,
+ *          otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int seqvec_get(struct seqvec *s, size_t idx, void *p);
+
+#endif /* ASMS_SEQVEC_H */
@@ -0,0 +1,103 @@
+/**
+ * @file
+ * The Space Filling Curve Interface
+ *
+ * This header defines Morton (Z-order) and Hilbert keys of 2D and 3D points,
+ * and the reordering of vectors of points along these curves.
+ *
+ * Points close along a curve are close in space, so a vector of points sorted
+ * by their keys keeps neighbourhoods together in memory. Hilbert curves never
+ * jump, while Morton keys are cheaper to compute.
+ *
+ * Coordinates are unsigned integers on a grid, 32 bits per axis in 2D and
+ * 21 bits per axis in 3D. @c sfc_quantize() maps real coordinates to the grid.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>.
+ */
+
+#ifndef ASMS_SFC_H
+#define ASMS_SFC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector.h"
+
+/**
+ * Space filling curves
+ */
+enum sfc_curve {
+	SFC_MORTON, /**< Z-order, interleaving the bits of the coordinates. */
+	SFC_HILBERT /**< Hilbert curve. */
+};
+
+/**
+ * Get the Morton key of a 2D point.
+ *
+ * @param x The first coordinate.
+ * @param y The second coordinate.
+ * @returns The key, bit @c 2i holding bit @c i of @c x, and bit <tt>2i + 1</tt> bit @c i of @c y.
+ */
+uint64_t sfc_morton2(uint32_t x, uint32_t y);
+
+/**
+ * Get the Morton key of a 3D point.
+ *
+ * @param x The first coordinate, only its low 21 bits are used.
+ * @param y The second coordinate, only its low 21 bits are used.
+ * @param z The third coordinate, only its low 21 bits are used.
+ * @returns The key, bits <tt>3i</tt>, <tt>3i + 1</tt> and <tt>3i + 2</tt> holding bit @c i of @c x, @c y and @c z.
+ */
+uint64_t sfc_morton3(uint32_t x, uint32_t y, uint32_t z);
+
+/**
+ * Get the Hilbert key of a 2D point.
+ *
+ * @param x The first coordinate.
+ * @param y The second coordinate.
+ * @returns The position of the point along the Hilbert curve filling the 32 bit grid.
+ */
+uint64_t sfc_hilbert2(uint32_t x, uint32_t y);
+
+/**
+ * Get the Hilbert key of a 3D point.
+ *
+ * @param x The first coordinate, only its low 21 bits are used.
+ * @param y The second coordinate, only its low 21 bits are used.
+ * @param z The third coordinate, only its low 21 bits are used.
+ * @returns The position of the point along the Hilbert curve filling the 21 bit grid.
+ */
+uint64_t sfc_hilbert3(uint32_t x, uint32_t y, uint32_t z);
+
+/**
+ * Map a real coordinate to the grid.
+ *
+ * @param x The coordinate, clamped to [lo, hi].
+ * @param lo Smallest coordinate of the points.
+ * @param hi Largest coordinate of the points.
+ * @param dims 2 or 3, the grid has 32 bits per axis in 2D and 21 bits in 3D.
+ * @returns The grid coordinate, @c lo mapping to 0 and @c hi to the last one.
+ */
+uint32_t sfc_quantize(double x, double lo, double hi, unsigned dims);
+
+/**
+ * Sort a vector of points along a space filling curve
+ *
+ * Keys are sorted with @c vector_radix_sort(), which keeps points with
+ * equal keys in their order.
+ *
+ * @param v The vector of points.
+ * @param curve The curve to sort along.
+ * @param dims 2 or 3.
+ * @param coords Stores the @c dims grid coordinates of a point, given a pointer to
+ *        the point, @c arg and room for the coordinates.
+ * @param arg Passed to @c coords as is.
+ * @param perm A vector of @c size_t, resized to the size of @c v so that its i-th
+ *        index is the former index of the point now at i. Companion vectors can be
+ *        reordered with it. @c NULL if not needed.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int sfc_reorder(struct vector *v, enum sfc_curve curve, unsigned dims,
+		void (*coords)(void *, void *, uint32_t *), void *arg, struct vector *perm);
+
+#endif /* ASMS_SFC_H */
@@ -0,0 +1,54 @@
+/**
+ * @file
+ * The String Sort Interface
+ *
+ * This header defines sorting of string columns, either a vector of
+ * pointers to NUL terminated strings, or the rows of a jagged array of bytes
+ * (an offsets + bytes layout).
+ *
+ * Strings are ordered bytewise as unsigned chars, a string sorting before
+ * every longer string it is a prefix of. They are sorted with a multikey
+ * quicksort working on 8 bytes at a time: each string caches the 8 bytes at
+ * the current depth next to its pointer, so partitioning only touches the
+ * cache and never the strings themselves. Large columns are first split by
+ * their leading two bytes (an MSD radix step over 65536 buckets); this
+ * partitioning is sequential, and only the sorts of the buckets run in
+ * parallel.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>.
+ */
+
+#ifndef ASMS_STRSORT_H
+#define ASMS_STRSORT_H
+
+#include <stddef.h>
+
+#include "vector.h"
+#include "jagged.h"
+
+/**
+ * Sort a vector of string pointers
+ *
+ * @c NULL pointers sort as empty strings.
+ *
+ * @param v A vector of <tt>char *</tt>, pointing to NUL terminated strings.
+ * @param nthreads Number of threads sorting the buckets of large vectors. If 0, one per online processor.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int strsort_ptrs(struct vector *v, size_t nthreads);
+
+/**
+ * Sort the rows of a jagged array as strings
+ *
+ * The rows are compared as the bytes of their objects and left in place,
+ * their sorted order is returned instead.
+ *
+ * @param j The jagged array pointer.
+ * @param perm A vector of @c size_t, resized to the number of rows so that its
+ *        i-th index is the row sorting at i.
+ * @param nthreads Number of threads sorting the buckets of large arrays. If 0, one per online processor.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int strsort_jagged(struct jagged *j, struct vector *perm, size_t nthreads);
+
+#endif /* ASMS_STRSORT_H */
@@ -0,0 +1,131 @@
+/**
+ * @file
+ * The Time Series Interface
+ *
+ * This header defines compressed time series of (timestamp, value) points.
+ *
+ * Points are appended in timestamp order and encoded into blocks of up to
+ * 1024 points, as in Facebook's Gorilla: timestamps are stored as deltas of
+ * deltas, and values as the XOR with the previous value, keeping only the
+ * meaningful bits. Regular timestamps and slowly changing values take a few
+ * bits per point instead of 16 bytes.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>.
+ */
+
+#ifndef ASMS_TSERIES_H
+#define ASMS_TSERIES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector.h"
+
+/**
+ * Most points in a block.
+ */
+#define TSERIES_BLOCK_POINTS 1024
+
+/**
+ * Initialize a new empty time series
+ *
+ * @returns A pointer to the time series, which must be freed with @c tseries_free().
+ *          @c NULL when memory allocation failed.
+ */
+struct tseries *tseries_new(void);
+
+/**
+ * Free the resources allocated by the time series
+ *
+ * @param tp A pointer to the time series pointer. @c *tp is @c NULL after calling this.
+ */
+void tseries_free(struct tseries **tp);
+
+/**
+ * Get the number of points.
+ *
+ * @param ts The time series pointer.
+ * @returns The number of points, 0 if @c ts is @c NULL.
+ */
+size_t tseries_size(struct tseries *ts);
+
+/**
+ * Get the number of bytes used by the encoded points.
+ *
+ * @param ts The time series pointer.
+ * @returns The number of bytes, 0 if @c ts is @c NULL.
+ */
+size_t tseries_bytes(struct tseries *ts);
+
+/**
+ * Append a point.
+ *
+ * @param ts The time series pointer.
+ * @param t The timestamp, not less than the one of the last point.
+ * @param v The value.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ *          @c VEC_EINVAL if @c t is out of order.
+ */
+int tseries_append(struct tseries *ts, int64_t t, double v);
+
+/**
+ * Get the number of blocks.
+ *
+ * @param ts The time series pointer.
+ * @returns The number of blocks, 0 if @c ts is @c NULL.
+ */
+size_t tseries_blocks(struct tseries *ts);
+
+/**
+ * Decode all points of a block.
+ *
+ * @param ts The time series pointer.
+ * @param block Index of the block.
+ * @param t Room for @c TSERIES_BLOCK_POINTS timestamps.
+ * @param v Room for @c TSERIES_BLOCK_POINTS values.
+ * @param n The number of decoded points is stored here.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int tseries_decode_block(struct tseries *ts, size_t block, int64_t *t, double *v, size_t *n);
+
+/**
+ * Create a new iterator over a time range.
+ *
+ * Blocks ending before @c begin are skipped without decoding them.
+ * Appending to the time series invalidates its iterators.
+ *
+ * @param ts The time series pointer.
+ * @param begin Beginning timestamp (inclusive).
+ * @param end Ending timestamp (exclusive).
+ * @returns A pointer to the iterator, which must be freed with @c tseries_free_iterator().
+ *          @c NULL if memory allocation fails.
+ */
+struct tseries_iter *tseries_get_iterator(struct tseries *ts, int64_t begin, int64_t end);
+
+/**
+ * Returns @c true if the iterator has more points.
+ *
+ * @param it The iterator pointer.
+ * @returns @c true if the next call to @c tseries_get_next() will be successful.
+ */
+bool tseries_has_next(struct tseries_iter *it);
+
+/**
+ * Retrieve the next point of the iterator.
+ *
+ * @param it The iterator pointer.
+ * @param t The timestamp is stored here. Must not be @c NULL.
+ * @param v The value is stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int tseries_get_next(struct tseries_iter *it, int64_t *t, double *v);
+
+/**
+ * Free the allocated resources for the iterator
+ *
+ * @param it The iterator pointer.
+ */
+void tseries_free_iterator(struct tseries_iter *it);
+
+#endif /* ASMS_TSERIES_H */
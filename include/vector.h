@@ -10,6 +10,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * List of possible error codes for several vector functions
@@ -29,6 +30,11 @@ enum vec_error {
  */
 typedef void *(*allocator_fn)(size_t);
 
+/**
+ * Type of a zeroing allocator function. Same as `calloc`
+ */
+typedef void *(*callocator_fn)(size_t, size_t);
+
 /**
  * Type of a deallocator function. Same as `free`
  */
@@ -50,6 +56,20 @@ typedef size_t (*growby_fn)(size_t);
 // void *(*vector_allocator(void *(*alloc)(size_t)))(size_t);
 allocator_fn vector_allocator(allocator_fn alloc);
 
+/**
+ * Set or get the zeroing allocator used for object arrays
+ *
+ * Object arrays are handed out zero filled. With a @c calloc like function
+ * large arrays come straight from fresh zero pages of the kernel, so their
+ * pages are only faulted in when an object is actually written. Setting a
+ * new allocator with @c vector_allocator() drops this back to the allocator
+ * followed by a @c memset, until a matching one is set here again.
+ *
+ * @param zalloc A @c calloc like function. If @c NULL nothing is changed.
+ * @returns The existing zeroing allocator, @c NULL if none is set.
+ */
+callocator_fn vector_callocator(callocator_fn zalloc);
+
 /**
  * Set or get the deallocator used for internal deallocations
  *
@@ -86,6 +106,54 @@ growby_fn vector_growby(growby_fn growby);
  */
 struct vector *vector_new(size_t nobj, size_t objsz);
 
+/**
+ * Initialize a new indirect vector
+ *
+ * An indirect vector keeps its objects in separately pooled bodies and only
+ * pointers to them in its array. Growing and reordering the vector moves the
+ * pointers, never the objects, which pays off for objects of several KB.
+ * The interface is the same as for other vectors, and @c vector_at() gives
+ * access to an object without copying it.
+ *
+ * @param nobj Number of objects to allocate at the initialization
+ *        (could be 0 for empty vectors).
+ * @param objsz Number of bytes occupied by each object.
+ * @returns A pointer to the vector object, which must be freed with @c vector_free().
+ *          @c NULL when memory allocation failed.
+ */
+struct vector *vector_new_indirect(size_t nobj, size_t objsz);
+
+/**
+ * Initialize a new vector created at a tagged site
+ *
+ * Same as @c vector_new(), but the final size of the vector is learned
+ * under @c tag when it is freed. Vectors created later with the same tag
+ * start with enough capacity for the learned percentile of those sizes
+ * (see @c vector_tag_percentile()), rounded up to a power of two, instead
+ * of growing their way there. @c nobj is used when it is larger or nothing
+ * was learned yet.
+ *
+ * Tags are compared as strings. Up to 256 distinct tags are learned,
+ * later ones behave like @c vector_new().
+ *
+ * @param tag A string naming the creation site.
+ * @param nobj Minimum number of objects to allocate at the initialization.
+ * @param objsz Number of bytes occupied by each object.
+ * @returns A pointer to the vector object, which must be freed with @c vector_free().
+ *          @c NULL when memory allocation failed.
+ */
+struct vector *vector_new_tagged(const char *tag, size_t nobj, size_t objsz);
+
+/**
+ * Set or get the percentile of learned sizes reserved by @c vector_new_tagged().
+ *
+ * The default is 90, so 9 out of 10 vectors of a tag never grow.
+ *
+ * @param pct The percentile (1 - 100). If out of range nothing is changed.
+ * @returns The existing percentile.
+ */
+unsigned vector_tag_percentile(unsigned pct);
+
 /**
  * Free the resources allocated by the vector
  *
@@ -98,6 +166,41 @@ struct vector *vector_new(size_t nobj, size_t objsz);
  */
 void vector_free(struct vector **vp, void (*elem_dtor)(void *));
 
+/**
+ * Free the resources allocated by the vector on a background thread
+ *
+ * Same as @c vector_free(), but the vector is handed over to a reclaimer
+ * thread which calls @c elem_dtor on the objects and releases the arrays.
+ * The caller returns without touching the objects. Vectors are reclaimed
+ * in the order they were handed over. If the reclaimer cannot be started
+ * the vector is freed right away on the calling thread.
+ *
+ * @c elem_dtor must be safe to call from another thread, and the vector
+ * must not be referenced anywhere else.
+ *
+ * @param vp A pointer to the vector pointer. @c *vp is @c NULL after calling this.
+ * @param elem_dtor A pointer to object deconstructor function.
+ * @see vector_reclaimer_threads()
+ */
+void vector_free_async(struct vector **vp, void (*elem_dtor)(void *));
+
+/**
+ * Wait until all vectors handed to @c vector_free_async() are released.
+ */
+void vector_free_async_wait(void);
+
+/**
+ * Set or get the number of threads used by the reclaimer for destructor calls.
+ *
+ * Destructor passes of large vectors are split across this many threads
+ * by the reclaimer. Small vectors are always destructed by the reclaimer
+ * thread alone. The default is 1, no parallel destruction.
+ *
+ * @param nthreads Number of threads. If 0 nothing is changed.
+ * @returns The existing number of threads.
+ */
+size_t vector_reclaimer_threads(size_t nthreads);
+
 /**
  * Get the size of the vector.
  *
@@ -114,6 +217,53 @@ size_t vector_size(struct vector *v);
  */
 size_t vector_capacity(struct vector *v);
 
+/**
+ * Get the size of an object of the vector.
+ *
+ * @param v The vector pointer.
+ * @returns The number of bytes occupied by each object. 0 if @c v is @c NULL.
+ */
+size_t vector_object_size(struct vector *v);
+
+/**
+ * Get the array holding the objects of the vector.
+ *
+ * Objects are laid out back to back, @c vector_object_size() bytes each.
+ * For indirect vectors the array holds pointers to the objects instead,
+ * @c NULL for objects never written.
+ * The array is only valid until the next call growing or fitting the vector.
+ * A pending incremental growth is finished first.
+ *
+ * @param v The vector pointer.
+ * @returns The beginning of the array. @c NULL if the vector has no array.
+ */
+void *vector_data(struct vector *v);
+
+/**
+ * Be told when the array of the vector goes away.
+ *
+ * @c moved is called with @c arg right before the array is released or
+ * replaced by another one: by growth, fitting, permuting or freeing the
+ * vector. A vector has one listener at most.
+ *
+ * @param v The vector pointer.
+ * @param moved The function to call, @c NULL to remove the listener.
+ * @param arg Passed to @c moved as is.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ *          @c VEC_EINVAL if the vector has a listener already.
+ * @see enum vec_error
+ */
+int vector_array_listener(struct vector *v, void (*moved)(void *), void *arg);
+
+/**
+ * Returns @c true if the vector is indirect.
+ *
+ * @param v The vector pointer.
+ * @returns @c true if the vector was created with @c vector_new_indirect().
+ * @see vector_new_indirect()
+ */
+bool vector_is_indirect(struct vector *v);
+
 /**
  * Returns @c true if the vector is empty.
  *
@@ -147,6 +297,122 @@ bool vector_is_mutable(struct vector *v);
  */
 int vector_reserve(struct vector *v, size_t size);
 
+/**
+ * Grow the vector incrementally.
+ *
+ * By default a growing vector copies all of its objects into the new array
+ * at once, so a single push may copy the whole vector. With incremental
+ * growth the new array is allocated and the objects are moved over a bounded
+ * chunk at a time, by the pushes, inserts and gets following the growth.
+ * Until then objects are read from whichever array holds them. A push,
+ * insert, get or @c vector_at() copies at most @c max_bytes bytes (at
+ * least one object) unless it grows the vector again. Growing again, as
+ * does @c vector_reserve() or @c vector_resize() past the capacity, and
+ * @c vector_data(), @c vector_fit(), @c vector_insert_batch(), the sorts,
+ * @c vector_permute(), @c vector_lower_bound_batch() and
+ * @c vector_compress_cold() finish the pending move at once.
+ *
+ * @param v The vector pointer.
+ * @param max_bytes Most bytes moved by one operation. If 0 incremental growth is
+ *        disabled and a pending move is finished right away.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ * @see enum vec_error
+ */
+int vector_incremental_growth(struct vector *v, size_t max_bytes);
+
+/**
+ * Prepare the next array of the vector in the background.
+ *
+ * Once the size of the vector passes @c high_water percent of its capacity,
+ * a helper thread allocates the array the next growth would need and copies
+ * the objects into it. When the vector runs out of capacity the prepared array
+ * is swapped in, copying only the objects pushed or written since. If the
+ * helper is still copying at that point the growth waits for it, and so
+ * does the first write to an object it copies; if it has not started yet,
+ * that write drops the prepared array instead.
+ *
+ * @param v The vector pointer.
+ * @param high_water Percent of the capacity (1 - 100). If 0 pre-growth is disabled.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ * @see enum vec_error
+ */
+int vector_pregrowth(struct vector *v, unsigned high_water);
+
+/**
+ * Memory taken by the cold blocks of a vector
+ */
+struct vector_cold_stats {
+	size_t block_size; /**< Bytes of a block. */
+	size_t released;   /**< Blocks held only compressed, their pages given back. */
+	size_t cached;	   /**< Blocks decompressed for reading, keeping their compressed copy. */
+	size_t zbytes;	   /**< Bytes taken by the compressed copies. */
+};
+
+/**
+ * Keep the cold blocks of the vector compressed in memory.
+ *
+ * The array is split into blocks of 64 KiB starting at a page boundary.
+ * Every call of @c vector_compress_cold() compresses the blocks not read or
+ * written since the previous call with a fast LZ codec, and gives their
+ * pages back to the system. Reading an object of such a block decompresses
+ * the block in place, and the last @c cache_blocks blocks decompressed this
+ * way keep their compressed copy, so that the oldest one can be given back
+ * again without compressing it. Writing to a block drops its copy, as does
+ * anything needing the whole array at once, such as @c vector_data(),
+ * growth or sorting, which decompresses every block first.
+ *
+ * Pointers returned by @c vector_at() are valid until the next call of
+ * @c vector_compress_cold().
+ *
+ * @param v The vector pointer. Indirect vectors are not supported.
+ * @param cache_blocks Most blocks kept decompressed after a read, though every block
+ *        of an object read is kept until the next sweep. If 0 compression
+ *        is disabled and every block is decompressed.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ * @see enum vec_error
+ */
+int vector_cold_compression(struct vector *v, size_t cache_blocks);
+
+/**
+ * Compress the blocks of the vector that went cold.
+ *
+ * Blocks not read or written since the previous call, or since compression
+ * was enabled or the array was last decompressed as a whole, are compressed.
+ * Blocks that do not compress to 3/4 of their size are left as they are
+ * until written. Meant to be called periodically.
+ *
+ * @param v The vector pointer, with cold compression enabled.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ * @see enum vec_error
+ */
+int vector_compress_cold(struct vector *v);
+
+/**
+ * Get the memory taken by the cold blocks of the vector.
+ *
+ * @param v The vector pointer, with cold compression enabled.
+ * @param st The statistics are stored here.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ * @see enum vec_error
+ */
+int vector_cold_stats(struct vector *v, struct vector_cold_stats *st);
+
+/**
+ * Change the number of objects in the vector.
+ *
+ * Growing the vector takes in the objects already in the array past its
+ * size. Those are zeros, unless written through @c vector_at() or
+ * @c vector_data() beforehand, which allows filling a reserved array
+ * in place and then taking the objects in at once. Shrinking the vector
+ * erases the objects past the new size.
+ *
+ * @param v The vector pointer.
+ * @param size The new number of objects.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ * @see enum vec_error
+ */
+int vector_resize(struct vector *v, size_t size);
+
 /**
  * Make the vector immutable.
  *
@@ -187,6 +453,19 @@ int vector_fit(struct vector *v, bool immutable);
  */
 int vector_get(struct vector *v, size_t idx, void *p);
 
+/**
+ * Get a pointer to the object at the given index.
+ *
+ * The object can be read and written in place, without copying it.
+ * The pointer stays valid until the vector grows or is fitted, or, for
+ * indirect vectors, until the object is erased.
+ *
+ * @param v The vector pointer.
+ * @param idx Index of the object.
+ * @return A pointer to the object. @c NULL if @c idx is out of range or memory allocation failed.
+ */
+void *vector_at(struct vector *v, size_t idx);
+
 /**
  * Insert an object at the given index.
  *
@@ -232,6 +511,136 @@ int vector_push(struct vector *v, void *p);
  */
 int vector_pop(struct vector *v, void *p);
 
+/**
+ * Insert objects at many positions at once.
+ *
+ * Unlike @c vector_insert(), the objects are inserted between the existing
+ * ones, which shift towards the end. Positions are indices of the vector
+ * before the call: an object is inserted before the object at its position,
+ * or appended if the position is the size of the vector. Objects sharing a
+ * position keep their order in @c elems.
+ *
+ * The positions are sorted and the vector is rebuilt in a single backward
+ * pass within its own array, moving each existing object at most once,
+ * so the cost is O(n + k) rather than O(n * k) for k single insertions.
+ *
+ * @param v The vector pointer.
+ * @param positions The @c k positions, each at most the size of the vector.
+ * @param elems An array of @c k objects, the i-th one inserted at <tt>positions[i]</tt>.
+ * @param k Number of objects to insert.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int vector_insert_batch(struct vector *v, const size_t *positions, const void *elems, size_t k);
+
+/**
+ * Sort the vector by 64 bit keys.
+ *
+ * The key of each object is computed once, and the keys are sorted with a
+ * stable LSD radix sort, a byte per pass, skipping the bytes shared by all
+ * keys. The objects are then moved to their sorted positions at once.
+ *
+ * @param v The vector pointer.
+ * @param key Returns the key of an object, given a pointer to the object and @c arg.
+ * @param arg Passed to @c key as is.
+ * @param perm A vector of @c size_t, resized to the size of @c v so that its i-th
+ *        index is the former index of the object now at i. @c NULL if not needed.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int vector_radix_sort(struct vector *v, uint64_t (*key)(void *, void *), void *arg, struct vector *perm);
+
+/**
+ * Sort the vector, keeping the order of objects comparing equal.
+ *
+ * The sort adapts to order already present. It finds the runs of the
+ * vector, ascending or strictly descending, extends short ones by binary
+ * insertion, and merges them as powersort does, by the depth their
+ * boundaries would have in a balanced merge tree. Merges skip the objects
+ * already in place and gallop over long stretches taken from one run.
+ * A sorted vector takes n - 1 comparisons, one made of a few runs about
+ * n log r, and the worst case is O(n log n).
+ *
+ * Extra memory is at most half the array, allocated when runs first need
+ * merging. Indirect vectors move their pointers, not the objects.
+ *
+ * @param v The vector pointer.
+ * @param cmp Compares two objects, returning less than, equal to, or greater than zero.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int vector_stable_sort(struct vector *v, int (*cmp)(const void *, const void *));
+
+/**
+ * Comparators of vectors holding numbers, for @c vector_argsort().
+ *
+ * Floating point numbers are ordered totally: -0 before +0, and NaNs
+ * beyond the infinities of their sign.
+ */
+int vector_cmp_i32(const void *a, const void *b);
+int vector_cmp_u32(const void *a, const void *b);
+int vector_cmp_i64(const void *a, const void *b);
+int vector_cmp_u64(const void *a, const void *b);
+int vector_cmp_float(const void *a, const void *b);
+int vector_cmp_double(const void *a, const void *b);
+
+/**
+ * Find the order that sorts the vector, leaving the vector as is.
+ *
+ * Objects comparing equal keep their order. Given one of the
+ * <tt>vector_cmp_*</tt> comparators above, the objects are ranked by the
+ * radix sort of @c vector_radix_sort() without calling @c cmp. Any other
+ * comparator is called by a merge sort, taking O(n log n) comparisons.
+ *
+ * Several vectors indexed alike can be sorted by one of them, passing the
+ * order to @c vector_permute() for each.
+ *
+ * @param v The vector pointer.
+ * @param cmp Compares two objects, returning less than, equal to, or greater than zero.
+ *        The numeric comparators require objects of the size of their type.
+ * @param perm A vector of @c size_t, resized to the size of @c v so that its i-th
+ *        index is the index of the i-th smallest object.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int vector_argsort(struct vector *v, int (*cmp)(const void *, const void *), struct vector *perm);
+
+/**
+ * Reorder the vector by a permutation.
+ *
+ * The i-th object afterwards is the former <tt>perm[i]</tt>-th, as ordered
+ * by @c vector_argsort() or @c vector_radix_sort().
+ *
+ * With one thread the objects are moved in place, along the cycles of the
+ * permutation, taking a bit of memory per object. With more, the objects
+ * are gathered into a new array in slices, one per thread, and the old
+ * array is released. Vectors too small to be split are moved in place.
+ *
+ * @param v The vector pointer.
+ * @param perm A vector of @c size_t holding each index of @c v once.
+ * @param nthreads Number of threads gathering the objects. If 0, one per online processor.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int vector_permute(struct vector *v, struct vector *perm, size_t nthreads);
+
+/**
+ * Find the lower bounds of many keys in a sorted vector.
+ *
+ * The searches are run in groups, in lockstep: each step prefetches the
+ * objects probed by every search of the group before comparing any of
+ * them, so their cache misses overlap. On 16M objects, well past the
+ * caches, this measured about 1.8x faster than searching for the keys one
+ * by one.
+ *
+ * @param v The vector pointer, sorted by @c cmp. Indirect vectors are not supported.
+ * @param cmp Compares a key with an object, returning a negative value, zero or a
+ *        positive value if the key sorts before, with or after the object.
+ * @param keys An array of @c k keys.
+ * @param keysz Size of a key.
+ * @param k Number of keys.
+ * @param out The index of the first object not sorting before the i-th key is
+ *        stored at <tt>out[i]</tt>, the size of the vector if there is none.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int vector_lower_bound_batch(struct vector *v, int (*cmp)(const void *, const void *),
+			     const void *keys, size_t keysz, size_t k, size_t *out);
+
 /**
  * Create a new iterator.
  *
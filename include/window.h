@@ -0,0 +1,186 @@
+/**
+ * @file
+ * The Sliding Window Interface
+ *
+ * This header defines aggregates over sliding windows of streamed values,
+ * updated in constant amortized time per value instead of rescanning the
+ * window.
+ *
+ * A time window holds the (timestamp, value) points of the last span time
+ * units, and keeps their count, sum, minimum and maximum. The points are
+ * kept in a ring buffer, the sum is updated as points enter and leave, and
+ * the minimum and maximum are the fronts of two monotonic deques, each a
+ * ring buffer as well.
+ *
+ * An aggregation window holds the last objects pushed to it and combines
+ * them with any associative operator, not necessarily invertible, using
+ * two stacks: objects are pushed to the back stack, whose aggregate is kept,
+ * and popped from the front stack, which stores the aggregate of each
+ * object with all the objects pushed after it. When the front stack runs
+ * out, the back stack is flipped over into it.
+ *
+ * Error codes are the ones of <tt>enum vec_error</tt>.
+ */
+
+#ifndef ASMS_WINDOW_H
+#define ASMS_WINDOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector.h"
+
+/**
+ * A point of a time window.
+ */
+struct window_point {
+	int64_t t; /**< Timestamp. */
+	double v;  /**< Value. */
+};
+
+/**
+ * Aggregates of the points of a time window.
+ */
+struct window_stats {
+	size_t count; /**< Number of points. */
+	double sum;   /**< Sum of the values. */
+	double min;   /**< Smallest value, 0 if there are no points. */
+	double max;   /**< Largest value, 0 if there are no points. */
+};
+
+/**
+ * Initialize a new empty time window
+ *
+ * @param span Length of the window, points older than the newest timestamp
+ *        minus @c span leave the window. Must be positive.
+ * @returns A pointer to the window, which must be freed with @c window_free().
+ *          @c NULL when memory allocation failed or @c span is not positive.
+ */
+struct window *window_new(int64_t span);
+
+/**
+ * Free the resources allocated by the window
+ *
+ * @param wp A pointer to the window pointer. @c *wp is @c NULL after calling this.
+ */
+void window_free(struct window **wp);
+
+/**
+ * Get the number of points in the window.
+ *
+ * @param w The window pointer.
+ * @returns The number of points, 0 if @c w is @c NULL.
+ */
+size_t window_size(struct window *w);
+
+/**
+ * Add a point, and move the window up to its timestamp.
+ *
+ * @param w The window pointer.
+ * @param t The timestamp, not before the timestamp of the window.
+ * @param v The value.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int window_push(struct window *w, int64_t t, double v);
+
+/**
+ * Add a span of points at once.
+ *
+ * Points of the span leaving the window before its end are skipped without
+ * entering the window.
+ *
+ * @param w The window pointer.
+ * @param points A vector of <tt>struct window_point</tt>, in timestamp order.
+ *        Indirect vectors are not supported.
+ * @param begin Index of the first point to add.
+ * @param end Index past the last point to add.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int window_push_span(struct window *w, struct vector *points, size_t begin, size_t end);
+
+/**
+ * Move the window up to a timestamp without adding a point.
+ *
+ * @param w The window pointer.
+ * @param t The timestamp, not before the timestamp of the window.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int window_advance(struct window *w, int64_t t);
+
+/**
+ * Get the aggregates of the points in the window.
+ *
+ * @param w The window pointer.
+ * @param s The aggregates are stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int window_stats(struct window *w, struct window_stats *s);
+
+/**
+ * Initialize a new empty aggregation window
+ *
+ * @param objsz Number of bytes occupied by each object.
+ * @param combine Stores the aggregate of @c a followed by @c b at @c out, given
+ *        @c arg. Must be associative. @c out never overlaps @c a or @c b.
+ * @param arg Passed to @c combine as is.
+ * @returns A pointer to the window, which must be freed with @c window_agg_free().
+ *          @c NULL when memory allocation failed.
+ */
+struct window_agg *window_agg_new(size_t objsz, void (*combine)(void *, const void *, const void *, void *),
+				  void *arg);
+
+/**
+ * Free the resources allocated by the aggregation window
+ *
+ * @param ap A pointer to the window pointer. @c *ap is @c NULL after calling this.
+ */
+void window_agg_free(struct window_agg **ap);
+
+/**
+ * Get the number of objects in the aggregation window.
+ *
+ * @param a The window pointer.
+ * @returns The number of objects, 0 if @c a is @c NULL.
+ */
+size_t window_agg_size(struct window_agg *a);
+
+/**
+ * Add an object to the back of the aggregation window.
+ *
+ * @param a The window pointer.
+ * @param p A pointer to the object.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int window_agg_push(struct window_agg *a, const void *p);
+
+/**
+ * Add a span of objects to the back of the aggregation window.
+ *
+ * @param a The window pointer.
+ * @param v A vector of objects of the size of the window's. Indirect vectors are not supported.
+ * @param begin Index of the first object to add.
+ * @param end Index past the last object to add.
+ * @returns @c VEC_SUCCESS on success, otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int window_agg_push_span(struct window_agg *a, struct vector *v, size_t begin, size_t end);
+
+/**
+ * Remove the oldest object of the aggregation window.
+ *
+ * @param a The window pointer.
+ * @returns @c VEC_SUCCESS on success, @c VEC_ERANGE if the window is empty,
+ *          otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int window_agg_pop(struct window_agg *a);
+
+/**
+ * Get the aggregate of the objects in the aggregation window, oldest first.
+ *
+ * @param a The window pointer.
+ * @param out The aggregate is stored here. Must not be @c NULL.
+ * @returns @c VEC_SUCCESS on success, @c VEC_ERANGE if the window is empty,
+ *          otherwise an error code as in <tt>enum vec_error</tt>.
+ */
+int window_agg_query(struct window_agg *a, void *out);
+
+#endif /* ASMS_WINDOW_H */
@@ -0,0 +1,392 @@
+/*
+ * checkpoint -- Incremental checkpoints of vectors with write protected pages
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "checkpoint.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum ckpt_consts {
+	/* "RCKP" */
+	CKPT_MAGIC = 0x504b4352,
+
+	CKPT_VERSION = 1,
+
+	/* most vectors tracked at once */
+	CKPT_MAX_TRACKERS = 64,
+
+	CKPT_WORD_BITS = sizeof(unsigned long) * CHAR_BIT
+};
+
+/* layout of a checkpoint, followed by nranges ranges */
+struct ckpt_header {
+	uint32_t magic;
+	uint32_t version;
+
+	/* 1 for a full checkpoint, 0 for a delta */
+	uint32_t full;
+	uint32_t reserved;
+
+	uint64_t objsz;
+	uint64_t size;
+	uint64_t nranges;
+};
+
+/* a run of bytes of the array, followed by the bytes themselves */
+struct ckpt_range {
+	uint64_t offset;
+	uint64_t length;
+};
+
+struct ckpt {
+	/* the tracked vector */
+	struct vector *v;
+
+	/* array and its capacity in bytes as of the last checkpoint, NULL before the first */
+	char *data;
+	size_t bytes;
+
+	/* pages lying entirely inside the array, write protected between checkpoints */
+	char *lo;
+	size_t npages;
+
+	/* one bit per page of lo, set when the page is written */
+	_Atomic unsigned long *dirty;
+
+	/* index in __ckpt_trackers */
+	size_t slot;
+};
+
+static struct ckpt *_Atomic __ckpt_trackers[CKPT_MAX_TRACKERS];
+
+static pthread_once_t __ckpt_once = PTHREAD_ONCE_INIT;
+static struct sigaction __ckpt_old_action;
+static bool __ckpt_installed;
+static size_t __ckpt_pagesz;
+
+/* mark the page of a tracked array and let the write through */
+static void __ckpt_on_fault(int sig, siginfo_t *si, void *ctx)
+{
+	char *addr = si->si_addr;
+
+	for (size_t i = 0; i < CKPT_MAX_TRACKERS; i++) {
+		struct ckpt *c = atomic_load(&__ckpt_trackers[i]);
+		if (!c || addr < c->lo || addr >= c->lo + (c->npages * __ckpt_pagesz))
+			continue;
+
+		size_t page = (addr - c->lo) / __ckpt_pagesz;
+		atomic_fetch_or(&c->dirty[page / CKPT_WORD_BITS], 1UL << (page % CKPT_WORD_BITS));
+		mprotect(c->lo + (page * __ckpt_pagesz), __ckpt_pagesz, PROT_READ | PROT_WRITE);
+		return;
+	}
+
+	/* not ours, hand it to whoever was there before */
+	if ((__ckpt_old_action.sa_flags & SA_SIGINFO) && __ckpt_old_action.sa_sigaction) {
+		__ckpt_old_action.sa_sigaction(sig, si, ctx);
+	} else if (__ckpt_old_action.sa_handler == SIG_DFL
+		   || __ckpt_old_action.sa_handler == SIG_IGN) {
+		/* the faulting instruction runs again and takes the default action */
+		signal(sig, SIG_DFL);
+	} else {
+		__ckpt_old_action.sa_handler(sig);
+	}
+}
+
+static void __ckpt_install(void)
+{
+	__ckpt_pagesz = sysconf(_SC_PAGESIZE);
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof sa);
+	sa.sa_sigaction = __ckpt_on_fault;
+	sa.sa_flags	= SA_SIGINFO | SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+
+	__ckpt_installed = sigaction(SIGSEGV, &sa, &__ckpt_old_action) == 0;
+}
+
+/* stop protecting the array of c, all its pages are writable afterwards */
+static void __ckpt_disarm(struct ckpt *c)
+{
+	if (c->npages)
+		mprotect(c->lo, c->npages * __ckpt_pagesz, PROT_READ | PROT_WRITE);
+
+	/* an empty range first, the fault handler no longer matches it */
+	c->npages = 0;
+	c->lo	  = NULL;
+
+	free((void *)c->dirty);
+	c->dirty = NULL;
+	c->data	 = NULL;
+	c->bytes = 0;
+}
+
+/* start tracking a new array of bytes bytes */
+static int __ckpt_arm(struct ckpt *c, char *data, size_t bytes)
+{
+	uintptr_t lo = ((uintptr_t)data + __ckpt_pagesz - 1) & ~(uintptr_t)(__ckpt_pagesz - 1);
+	uintptr_t hi = ((uintptr_t)data + bytes) & ~(uintptr_t)(__ckpt_pagesz - 1);
+	size_t npages = hi > lo ? (hi - lo) / __ckpt_pagesz : 0;
+
+	size_t nwords = (npages + CKPT_WORD_BITS - 1) / CKPT_WORD_BITS;
+	c->dirty      = calloc(nwords ? nwords : 1, sizeof *c->dirty);
+	if (!c->dirty)
+		return CKPT_ENOMEM;
+
+	c->data	  = data;
+	c->bytes  = bytes;
+	c->lo	  = (char *)lo;
+	c->npages = npages;
+
+	if (npages && mprotect(c->lo, npages * __ckpt_pagesz, PROT_READ) != 0) {
+		/* not protected, so every page must be treated as dirty */
+		__ckpt_disarm(c);
+		return CKPT_EINVAL;
+	}
+
+	return CKPT_SUCCESS;
+}
+
+/* the array of the tracked vector is going away, unprotect it before it is freed */
+static void __ckpt_on_move(void *arg)
+{
+	__ckpt_disarm(arg);
+}
+
+static bool __ckpt_page_is_dirty(struct ckpt *c, size_t page)
+{
+	return atomic_load(&c->dirty[page / CKPT_WORD_BITS]) & (1UL << (page % CKPT_WORD_BITS));
+}
+
+/*
+ * Collect the byte ranges [0, used) changed since the last checkpoint into
+ * ranges. The partial pages around the protected ones are always included.
+ * Returns the number of ranges.
+ */
+static size_t __ckpt_collect(struct ckpt *c, size_t used, struct ckpt_range *ranges)
+{
+	size_t n     = 0;
+	size_t first = c->lo - c->data;
+	size_t last  = first + (c->npages * __ckpt_pagesz);
+
+	/* extend the previous range when contiguous */
+#define CKPT_ADD_RANGE(off, len)                                                  \
+	do {                                                                      \
+		size_t o_ = (off), l_ = (len);                                    \
+		if (o_ >= used || l_ == 0)                                        \
+			break;                                                    \
+		if (o_ + l_ > used)                                               \
+			l_ = used - o_;                                           \
+		if (n && ranges[n - 1].offset + ranges[n - 1].length == o_)       \
+			ranges[n - 1].length += l_;                               \
+		else                                                              \
+			ranges[n++] = (struct ckpt_range){ o_, l_ };              \
+	} while (0)
+
+	CKPT_ADD_RANGE(0, c->npages ? first : c->bytes);
+	for (size_t page = 0; page < c->npages; page++) {
+		if (__ckpt_page_is_dirty(c, page))
+			CKPT_ADD_RANGE(first + (page * __ckpt_pagesz), __ckpt_pagesz);
+	}
+	if (c->npages)
+		CKPT_ADD_RANGE(last, c->bytes - last);
+
+#undef CKPT_ADD_RANGE
+
+	return n;
+}
+
+struct ckpt *ckpt_new(struct vector *v)
+{
+	ASSERT_PRECONDITION(v != NULL && !vector_is_indirect(v), return NULL);
+
+	pthread_once(&__ckpt_once, __ckpt_install);
+	if (!__ckpt_installed)
+		return NULL;
+
+	struct ckpt *c = calloc(1, sizeof *c);
+	if (!c)
+		return NULL;
+	c->v = v;
+
+	if (vector_array_listener(v, __ckpt_on_move, c) != VEC_SUCCESS) {
+		free(c);
+		return NULL;
+	}
+
+	for (c->slot = 0; c->slot < CKPT_MAX_TRACKERS; c->slot++) {
+		struct ckpt *expected = NULL;
+
+		/* an unarmed tracker covers no address, claiming the slot is harmless */
+		if (atomic_compare_exchange_strong(&__ckpt_trackers[c->slot], &expected, c))
+			return c;
+	}
+
+	vector_array_listener(v, NULL, NULL);
+	free(c);
+	return NULL;
+}
+
+void ckpt_free(struct ckpt **cp)
+{
+	ASSERT_PRECONDITION(cp && *cp, return );
+
+	__ckpt_disarm(*cp);
+	vector_array_listener((*cp)->v, NULL, NULL);
+	atomic_store(&__ckpt_trackers[(*cp)->slot], NULL);
+	free(*cp);
+	*cp = NULL;
+}
+
+bool ckpt_next_is_full(struct ckpt *c)
+{
+	ASSERT_PRECONDITION(c != NULL, return true);
+
+	return !c->data || c->data != (char *)vector_data(c->v)
+	       || c->bytes != vector_capacity(c->v) * vector_object_size(c->v);
+}
+
+int ckpt_write(struct ckpt *c, FILE *out)
+{
+	ASSERT_PRECONDITION(c != NULL && out != NULL, return CKPT_EINVAL);
+
+	bool full   = ckpt_next_is_full(c);
+	char *data  = vector_data(c->v);
+	size_t used = vector_size(c->v) * vector_object_size(c->v);
+
+	size_t nranges		  = 0;
+	struct ckpt_range *ranges = malloc((c->npages + 2) * sizeof *ranges);
+	if (!ranges)
+		return CKPT_ENOMEM;
+
+	if (full && used > 0)
+		ranges[nranges++] = (struct ckpt_range){ 0, used };
+	else if (!full)
+		nranges = __ckpt_collect(c, used, ranges);
+
+	struct ckpt_header h = {
+		.magic	 = CKPT_MAGIC,
+		.version = CKPT_VERSION,
+		.full	 = full,
+		.objsz	 = vector_object_size(c->v),
+		.size	 = vector_size(c->v),
+		.nranges = nranges,
+	};
+
+	int res = CKPT_SUCCESS;
+	if (fwrite(&h, sizeof h, 1, out) != 1)
+		res = CKPT_EIO;
+	for (size_t i = 0; i < nranges && res == CKPT_SUCCESS; i++) {
+		if (fwrite(&ranges[i], sizeof ranges[i], 1, out) != 1
+		    || fwrite(data + ranges[i].offset, 1, ranges[i].length, out) != ranges[i].length)
+			res = CKPT_EIO;
+	}
+	free(ranges);
+
+	if (res == CKPT_SUCCESS)
+		res = fflush(out) == 0 ? CKPT_SUCCESS : CKPT_EIO;
+	if (res != CKPT_SUCCESS)
+		return res;
+
+	/* start over from this checkpoint */
+	if (full) {
+		__ckpt_disarm(c);
+		return data ? __ckpt_arm(c, data, vector_capacity(c->v) * vector_object_size(c->v))
+			    : CKPT_SUCCESS;
+	}
+
+	size_t nwords = (c->npages + CKPT_WORD_BITS - 1) / CKPT_WORD_BITS;
+	for (size_t i = 0; i < nwords; i++)
+		atomic_store(&c->dirty[i], 0);
+	if (c->npages && mprotect(c->lo, c->npages * __ckpt_pagesz, PROT_READ) != 0) {
+		__ckpt_disarm(c);
+		return CKPT_EINVAL;
+	}
+
+	return CKPT_SUCCESS;
+}
+
+/* make the vector hold exactly size objects */
+static int __ckpt_resize(struct vector *v, size_t size)
+{
+	while (vector_size(v) > size) {
+		if (vector_erase(v, vector_size(v) - 1) != VEC_SUCCESS)
+			return CKPT_EINVAL;
+	}
+
+	if (vector_size(v) < size) {
+		if (vector_reserve(v, size) != VEC_SUCCESS)
+			return CKPT_ENOMEM;
+
+		/* inserting the last object in place advances the size */
+		size_t objsz = vector_object_size(v);
+		char *last   = malloc(objsz ? objsz : 1);
+		if (!last)
+			return CKPT_ENOMEM;
+
+		memcpy(last, (char *)vector_data(v) + ((size - 1) * objsz), objsz);
+		int res = vector_insert(v, size - 1, last);
+		free(last);
+		if (res != VEC_SUCCESS)
+			return CKPT_ENOMEM;
+	}
+
+	return CKPT_SUCCESS;
+}
+
+int ckpt_apply(struct vector **vp, FILE *in)
+{
+	ASSERT_PRECONDITION(vp != NULL && in != NULL, return CKPT_EINVAL);
+
+	struct ckpt_header h;
+	if (fread(&h, sizeof h, 1, in) != 1)
+		return CKPT_EIO;
+	if (h.magic != CKPT_MAGIC || h.version != CKPT_VERSION)
+		return CKPT_EFORMAT;
+	if (h.full != (*vp == NULL))
+		return CKPT_EFORMAT;
+	if (*vp && vector_object_size(*vp) != h.objsz)
+		return CKPT_EFORMAT;
+
+	/* ranges are checked against the bytes of the array */
+	if (h.objsz && h.size > SIZE_MAX / h.objsz)
+		return CKPT_EFORMAT;
+	size_t bytes = h.size * h.objsz;
+
+	struct vector *v = *vp ? *vp : vector_new(h.size, h.objsz);
+	if (!v)
+		return CKPT_ENOMEM;
+
+	int res = __ckpt_resize(v, h.size);
+	for (uint64_t i = 0; i < h.nranges && res == CKPT_SUCCESS; i++) {
+		struct ckpt_range r;
+		if (fread(&r, sizeof r, 1, in) != 1) {
+			res = CKPT_EIO;
+		} else if (r.offset > bytes || r.length > bytes - r.offset) {
+			res = CKPT_EFORMAT;
+		} else if (fread((char *)vector_data(v) + r.offset, 1, r.length, in) != r.length) {
+			res = CKPT_EIO;
+		}
+	}
+
+	if (res != CKPT_SUCCESS && !*vp)
+		vector_free(&v, NULL);
+	else
+		*vp = v;
+
+	return res;
+}
@@ -0,0 +1,427 @@
+/*
+ * dictvec -- Dictionary encoded vectors
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DICT_HAVE_AVX2 1
+#endif
+
+#include "dictvec.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum dict_consts {
+	/* codes matched at once by a scan */
+	DICT_SCAN_BLOCK = 32,
+
+	/* indices collected before they are appended to a selection */
+	DICT_SEL_BUFFER = 1024
+};
+
+struct dictvec {
+	/* distinct objects, indexed by their code */
+	struct vector *dict;
+
+	/* code of each object, 1, 2 or 4 bytes wide */
+	struct vector *codes;
+
+	/* open addressing hash table of code + 1, 0 for empty slots */
+	uint32_t *table;
+
+	/* number of slots of the table, a power of two */
+	size_t tablesz;
+
+	/* size of an object */
+	size_t objsz;
+};
+
+/* matching indices waiting to be appended to a selection */
+struct dict_sel {
+	struct vector *out;
+	size_t n;
+	size_t idx[DICT_SEL_BUFFER];
+};
+
+static uint64_t __dict_hash(const char *p, size_t n)
+{
+	uint64_t h = UINT64_C(0x9e3779b97f4a7c15) ^ n;
+	for (; n >= 8; p += 8, n -= 8) {
+		uint64_t w;
+		memcpy(&w, p, 8);
+		h = (h ^ w) * UINT64_C(0xff51afd7ed558ccd);
+		h ^= h >> 32;
+	}
+	if (n) {
+		uint64_t w = 0;
+		memcpy(&w, p, n);
+		h = (h ^ w) * UINT64_C(0xc4ceb9fe1a85ec53);
+	}
+	return h ^ (h >> 29);
+}
+
+static inline uint32_t __dict_code_at(const void *codes, size_t width, size_t idx)
+{
+	switch (width) {
+	case 1:
+		return ((const uint8_t *)codes)[idx];
+	case 2:
+		return ((const uint16_t *)codes)[idx];
+	default:
+		return ((const uint32_t *)codes)[idx];
+	}
+}
+
+/* slot holding p, or the empty slot where it belongs */
+static size_t __dict_slot(struct dictvec *d, const void *p)
+{
+	size_t mask = d->tablesz - 1;
+	size_t i    = __dict_hash(p, d->objsz) & mask;
+
+	const char *dict = vector_data(d->dict);
+	while (d->table[i] && memcmp(dict + ((d->table[i] - 1) * d->objsz), p, d->objsz) != 0)
+		i = (i + 1) & mask;
+	return i;
+}
+
+static int __dict_rehash(struct dictvec *d, size_t tablesz)
+{
+	uint32_t *old  = d->table;
+	size_t oldsz   = d->tablesz;
+	d->table       = calloc(tablesz, sizeof *d->table);
+	if (!d->table) {
+		d->table = old;
+		return VEC_ENOMEM;
+	}
+	d->tablesz = tablesz;
+
+	for (size_t i = 0; i < oldsz; i++) {
+		if (old[i])
+			d->table[__dict_slot(d, vector_at(d->dict, old[i] - 1))] = old[i];
+	}
+	free(old);
+	return VEC_SUCCESS;
+}
+
+/* make codes at least width bytes wide */
+static int __dict_widen(struct dictvec *d, size_t width)
+{
+	size_t n	   = vector_size(d->codes);
+	size_t oldw	   = vector_object_size(d->codes);
+	struct vector *new = vector_new(n ? n : 1, width);
+	if (!new)
+		return VEC_ENOMEM;
+
+	int res = vector_resize(new, n);
+	if (res != VEC_SUCCESS) {
+		vector_free(&new, NULL);
+		return res;
+	}
+
+	const void *src = vector_data(d->codes);
+	char *dst	= vector_data(new);
+	for (size_t i = 0; i < n; i++) {
+		uint32_t code = __dict_code_at(src, oldw, i);
+		if (width == 2)
+			((uint16_t *)dst)[i] = code;
+		else
+			((uint32_t *)dst)[i] = code;
+	}
+
+	vector_free(&d->codes, NULL);
+	d->codes = new;
+	return VEC_SUCCESS;
+}
+
+static int __dict_sel_flush(struct dict_sel *s)
+{
+	if (s->n == 0)
+		return VEC_SUCCESS;
+
+	size_t base = vector_size(s->out);
+	int res	    = vector_resize(s->out, base + s->n);
+	if (res == VEC_SUCCESS)
+		memcpy((size_t *)vector_data(s->out) + base, s->idx, s->n * sizeof(size_t));
+	s->n = 0;
+	return res;
+}
+
+/* append the indices base + i of the bits i set in mask */
+static int __dict_sel_mask(struct dict_sel *s, size_t base, uint32_t mask)
+{
+	while (mask) {
+		if (s->n == DICT_SEL_BUFFER) {
+			int res = __dict_sel_flush(s);
+			if (res != VEC_SUCCESS)
+				return res;
+		}
+		s->idx[s->n++] = base + __builtin_ctz(mask);
+		mask &= mask - 1;
+	}
+	return VEC_SUCCESS;
+}
+
+static uint32_t __dict_match_block(const void *codes, size_t width, size_t base, uint32_t code)
+{
+	uint32_t mask = 0;
+	for (size_t i = 0; i < DICT_SCAN_BLOCK; i++)
+		mask |= (uint32_t)(__dict_code_at(codes, width, base + i) == code) << i;
+	return mask;
+}
+
+#ifdef DICT_HAVE_AVX2
+/* bit i set if code base + i equals code, 32 codes at a time */
+__attribute__((target("avx2")))
+static uint32_t __dict_match_block_avx2(const void *codes, size_t width, size_t base, uint32_t code)
+{
+	const __m256i *p = (const __m256i *)((const char *)codes + (base * width));
+
+	if (width == 1) {
+		__m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(p), _mm256_set1_epi8(code));
+		return _mm256_movemask_epi8(eq);
+	}
+
+	if (width == 2) {
+		__m256i c  = _mm256_set1_epi16(code);
+		__m256i lo = _mm256_cmpeq_epi16(_mm256_loadu_si256(p), c);
+		__m256i hi = _mm256_cmpeq_epi16(_mm256_loadu_si256(p + 1), c);
+
+		/* packing works within 128 bit lanes, put the quarters back in order */
+		__m256i eq = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xd8);
+		return _mm256_movemask_epi8(eq);
+	}
+
+	__m256i c  = _mm256_set1_epi32(code);
+	__m256i e0 = _mm256_cmpeq_epi32(_mm256_loadu_si256(p), c);
+	__m256i e1 = _mm256_cmpeq_epi32(_mm256_loadu_si256(p + 1), c);
+	__m256i e2 = _mm256_cmpeq_epi32(_mm256_loadu_si256(p + 2), c);
+	__m256i e3 = _mm256_cmpeq_epi32(_mm256_loadu_si256(p + 3), c);
+
+	__m256i eq = _mm256_packs_epi16(_mm256_packs_epi32(e0, e1), _mm256_packs_epi32(e2, e3));
+	eq	   = _mm256_permutevar8x32_epi32(eq, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+	return _mm256_movemask_epi8(eq);
+}
+#endif
+
+static int __dict_scan_eq(struct dictvec *d, uint32_t code, struct vector *sel)
+{
+	uint32_t (*match)(const void *, size_t, size_t, uint32_t) = __dict_match_block;
+#ifdef DICT_HAVE_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		match = __dict_match_block_avx2;
+#endif
+
+	struct dict_sel *s = malloc(sizeof *s);
+	if (!s)
+		return VEC_ENOMEM;
+	s->out = sel;
+	s->n   = 0;
+
+	const void *codes = vector_data(d->codes);
+	size_t width	  = vector_object_size(d->codes);
+	size_t n	  = vector_size(d->codes);
+
+	int res = VEC_SUCCESS;
+	size_t i;
+	for (i = 0; i + DICT_SCAN_BLOCK <= n && res == VEC_SUCCESS; i += DICT_SCAN_BLOCK)
+		res = __dict_sel_mask(s, i, match(codes, width, i, code));
+	for (; i < n && res == VEC_SUCCESS; i++) {
+		if (__dict_code_at(codes, width, i) == code)
+			res = __dict_sel_mask(s, i, 1);
+	}
+
+	if (res == VEC_SUCCESS)
+		res = __dict_sel_flush(s);
+	free(s);
+	return res;
+}
+
+struct dictvec *dictvec_new(size_t objsz)
+{
+	struct dictvec *d = calloc(1, sizeof *d);
+	if (!d)
+		return NULL;
+
+	d->objsz   = objsz;
+	d->tablesz = 16;
+	d->dict	   = vector_new(0, objsz);
+	d->codes   = vector_new(0, sizeof(uint8_t));
+	d->table   = calloc(d->tablesz, sizeof *d->table);
+	if (!d->dict || !d->codes || !d->table) {
+		dictvec_free(&d);
+		return NULL;
+	}
+
+	return d;
+}
+
+void dictvec_free(struct dictvec **dp)
+{
+	ASSERT_PRECONDITION(dp && *dp, return );
+
+	struct dictvec *d = *dp;
+	if (d->dict)
+		vector_free(&d->dict, NULL);
+	if (d->codes)
+		vector_free(&d->codes, NULL);
+	free(d->table);
+	free(d);
+
+	*dp = NULL;
+}
+
+size_t dictvec_size(struct dictvec *d)
+{
+	ASSERT_PRECONDITION(d != NULL, return 0);
+	return vector_size(d->codes);
+}
+
+size_t dictvec_cardinality(struct dictvec *d)
+{
+	ASSERT_PRECONDITION(d != NULL, return 0);
+	return vector_size(d->dict);
+}
+
+size_t dictvec_code_size(struct dictvec *d)
+{
+	ASSERT_PRECONDITION(d != NULL, return 0);
+	return vector_object_size(d->codes);
+}
+
+int dictvec_push(struct dictvec *d, void *p)
+{
+	ASSERT_PRECONDITION(d != NULL && p != NULL, return VEC_EINVAL);
+
+	int res;
+	size_t slot = __dict_slot(d, p);
+	if (!d->table[slot]) {
+		size_t card = vector_size(d->dict);
+		ASSERT_PRECONDITION(card < UINT32_MAX - 1, return VEC_EMAXED);
+
+		/* make room for the new code and entry before the value is added, so a failure leaves d as is */
+		size_t width = card < 1 << 8 ? 1 : card < 1 << 16 ? 2 : 4;
+		if (width > vector_object_size(d->codes) && (res = __dict_widen(d, width)) != VEC_SUCCESS)
+			return res;
+		if ((res = vector_reserve(d->codes, vector_size(d->codes) + 1)) != VEC_SUCCESS)
+			return res;
+
+		/* keep the table at most half full */
+		if ((card + 1) * 2 > d->tablesz) {
+			if ((res = __dict_rehash(d, d->tablesz * 2)) != VEC_SUCCESS)
+				return res;
+			slot = __dict_slot(d, p);
+		}
+
+		if ((res = vector_push(d->dict, p)) != VEC_SUCCESS)
+			return res;
+		d->table[slot] = card + 1;
+	}
+
+	uint32_t code = d->table[slot] - 1;
+	switch (vector_object_size(d->codes)) {
+	case 1:
+		return vector_push(d->codes, &(uint8_t){ code });
+	case 2:
+		return vector_push(d->codes, &(uint16_t){ code });
+	default:
+		return vector_push(d->codes, &code);
+	}
+}
+
+int dictvec_code(struct dictvec *d, size_t idx, uint32_t *code)
+{
+	ASSERT_PRECONDITION(d != NULL && code != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(idx < vector_size(d->codes), return VEC_ERANGE);
+
+	*code = __dict_code_at(vector_data(d->codes), vector_object_size(d->codes), idx);
+	return VEC_SUCCESS;
+}
+
+int dictvec_get(struct dictvec *d, size_t idx, void *p)
+{
+	ASSERT_PRECONDITION(d != NULL && p != NULL, return VEC_EINVAL);
+
+	uint32_t code;
+	int res = dictvec_code(d, idx, &code);
+	return res == VEC_SUCCESS ? vector_get(d->dict, code, p) : res;
+}
+
+int dictvec_lookup(struct dictvec *d, void *p, uint32_t *code)
+{
+	ASSERT_PRECONDITION(d != NULL && p != NULL && code != NULL, return VEC_EINVAL);
+
+	size_t slot = __dict_slot(d, p);
+	ASSERT_PRECONDITION(d->table[slot], return VEC_ERANGE);
+
+	*code = d->table[slot] - 1;
+	return VEC_SUCCESS;
+}
+
+int dictvec_select_eq(struct dictvec *d, void *p, struct vector *sel)
+{
+	ASSERT_PRECONDITION(d != NULL && p != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(sel) == sizeof(size_t), return VEC_EINVAL);
+
+	uint32_t code;
+	if (dictvec_lookup(d, p, &code) != VEC_SUCCESS)
+		return VEC_SUCCESS;
+
+	return __dict_scan_eq(d, code, sel);
+}
+
+int dictvec_select(struct dictvec *d, bool (*pred)(void *, void *), void *arg, struct vector *sel)
+{
+	ASSERT_PRECONDITION(d != NULL && pred != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(sel) == sizeof(size_t), return VEC_EINVAL);
+
+	size_t card  = vector_size(d->dict);
+	bool *match  = malloc((card ? card : 1) * sizeof *match);
+	size_t nmatch = 0, last = 0;
+	if (!match)
+		return VEC_ENOMEM;
+
+	for (size_t code = 0; code < card; code++) {
+		match[code] = pred(vector_at(d->dict, code), arg);
+		if (match[code]) {
+			nmatch++;
+			last = code;
+		}
+	}
+
+	/* a single matching entry is an equality scan */
+	int res = VEC_SUCCESS;
+	if (nmatch == 1) {
+		res = __dict_scan_eq(d, last, sel);
+	} else if (nmatch > 0) {
+		struct dict_sel *s = malloc(sizeof *s);
+		if (!s) {
+			free(match);
+			return VEC_ENOMEM;
+		}
+		s->out = sel;
+		s->n   = 0;
+
+		const void *codes = vector_data(d->codes);
+		size_t width	  = vector_object_size(d->codes);
+		size_t n	  = vector_size(d->codes);
+		for (size_t i = 0; i < n && res == VEC_SUCCESS; i++) {
+			if (match[__dict_code_at(codes, width, i)])
+				res = __dict_sel_mask(s, i, 1);
+		}
+
+		if (res == VEC_SUCCESS)
+			res = __dict_sel_flush(s);
+		free(s);
+	}
+
+	free(match);
+	return res;
+}
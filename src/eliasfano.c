@@ -0,0 +1,252 @@
+/*
+ * eliasfano -- Elias-Fano encoded monotone sequences
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "eliasfano.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum ef_consts {
+	/* set and unset bits of the high bits between two samples */
+	EF_SAMPLE = 512
+};
+
+struct eliasfano {
+	/* number of values */
+	size_t n;
+
+	/* last value, the largest one */
+	uint64_t last;
+
+	/* low bits of each value, l bits each, packed */
+	uint64_t *lower;
+	unsigned l;
+
+	/* bit (v >> l) + i is set for the i-th value v */
+	uint64_t *upper;
+	size_t nupper;
+
+	/* positions of every EF_SAMPLE-th set and unset bit of upper */
+	size_t *ones;
+	size_t nones;
+	size_t *zeros;
+	size_t nzeros;
+};
+
+static inline size_t __ef_words(size_t bits)
+{
+	/* one spare word, fields straddling a word read the next one */
+	return (bits + 63) / 64 + 1;
+}
+
+static inline uint64_t __ef_low(const struct eliasfano *e, size_t i)
+{
+	if (e->l == 0)
+		return 0;
+
+	size_t bit = i * e->l, w = bit / 64, off = bit % 64;
+	uint64_t x = e->lower[w] >> off;
+	if (off + e->l > 64)
+		x |= e->lower[w + 1] << (64 - off);
+	return x & ((UINT64_C(1) << e->l) - 1);
+}
+
+/* position of the k-th set bit of w, counting from 0 */
+static inline unsigned __ef_select64(uint64_t w, unsigned k)
+{
+	unsigned off = 0;
+	for (unsigned c; k >= (c = __builtin_popcountll(w & 0xff)); w >>= 8, off += 8)
+		k -= c;
+	for (; k > 0; k--)
+		w &= w - 1;
+	return off + __builtin_ctzll(w);
+}
+
+/*
+ * Position of the k-th set bit of upper, or of the k-th unset one if zeros.
+ * The scan starts from the closest sample below.
+ */
+static size_t __ef_select(const struct eliasfano *e, size_t k, bool zeros)
+{
+	const size_t *samples = zeros ? e->zeros : e->ones;
+	uint64_t flip	      = zeros ? UINT64_MAX : 0;
+
+	size_t pos = samples[k / EF_SAMPLE];
+	size_t w   = pos / 64;
+	size_t r   = k % EF_SAMPLE;
+
+	uint64_t word = (e->upper[w] ^ flip) & (UINT64_MAX << (pos % 64));
+	for (size_t c; r >= (c = __builtin_popcountll(word)); word = e->upper[++w] ^ flip)
+		r -= c;
+	return (w * 64) + __ef_select64(word, r);
+}
+
+static int __ef_sample(struct eliasfano *e)
+{
+	e->nones  = (e->n + EF_SAMPLE - 1) / EF_SAMPLE;
+	e->nzeros = (e->nupper - e->n + EF_SAMPLE - 1) / EF_SAMPLE;
+	e->ones	  = malloc((e->nones ? e->nones : 1) * sizeof *e->ones);
+	e->zeros  = malloc((e->nzeros ? e->nzeros : 1) * sizeof *e->zeros);
+	if (!e->ones || !e->zeros)
+		return VEC_ENOMEM;
+
+	size_t ones = 0, zeros = 0;
+	for (size_t pos = 0; pos < e->nupper; pos++) {
+		if ((e->upper[pos / 64] >> (pos % 64)) & 1) {
+			if (ones % EF_SAMPLE == 0)
+				e->ones[ones / EF_SAMPLE] = pos;
+			ones++;
+		} else {
+			if (zeros % EF_SAMPLE == 0)
+				e->zeros[zeros / EF_SAMPLE] = pos;
+			zeros++;
+		}
+	}
+	return VEC_SUCCESS;
+}
+
+int eliasfano_build(struct eliasfano **ep, struct vector *v)
+{
+	ASSERT_PRECONDITION(ep != NULL && v != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(v) == sizeof(uint64_t) && !vector_is_indirect(v),
+			    return VEC_EINVAL);
+
+	size_t n	  = vector_size(v);
+	const uint64_t *x = vector_data(v);
+	for (size_t i = 1; i < n; i++)
+		ASSERT_PRECONDITION(x[i - 1] <= x[i], return VEC_EINVAL);
+
+	struct eliasfano *e = calloc(1, sizeof *e);
+	if (!e)
+		return VEC_ENOMEM;
+
+	e->n	= n;
+	e->last = n ? x[n - 1] : 0;
+	e->l	= n && e->last / n ? 63 - __builtin_clzll(e->last / n) : 0;
+
+	/* a set bit per value, and an unset bit closing each high part up to the last */
+	e->nupper = n + (size_t)(e->last >> e->l) + 1;
+	e->lower  = calloc(__ef_words(n * e->l), sizeof *e->lower);
+	e->upper  = calloc(__ef_words(e->nupper), sizeof *e->upper);
+	int res	  = e->lower && e->upper ? VEC_SUCCESS : VEC_ENOMEM;
+
+	for (size_t i = 0; i < n && res == VEC_SUCCESS; i++) {
+		uint64_t low = x[i] & ((UINT64_C(1) << e->l) - 1);
+		size_t bit   = i * e->l, w = bit / 64, off = bit % 64;
+		if (e->l) {
+			e->lower[w] |= low << off;
+			if (off + e->l > 64)
+				e->lower[w + 1] |= low >> (64 - off);
+		}
+
+		size_t pos = (size_t)(x[i] >> e->l) + i;
+		e->upper[pos / 64] |= UINT64_C(1) << (pos % 64);
+	}
+
+	if (res == VEC_SUCCESS)
+		res = __ef_sample(e);
+	if (res != VEC_SUCCESS) {
+		eliasfano_free(&e);
+		return res;
+	}
+
+	*ep = e;
+	return VEC_SUCCESS;
+}
+
+void eliasfano_free(struct eliasfano **ep)
+{
+	ASSERT_PRECONDITION(ep && *ep, return );
+
+	struct eliasfano *e = *ep;
+	free(e->lower);
+	free(e->upper);
+	free(e->ones);
+	free(e->zeros);
+	free(e);
+
+	*ep = NULL;
+}
+
+size_t eliasfano_size(struct eliasfano *e)
+{
+	ASSERT_PRECONDITION(e != NULL, return 0);
+	return e->n;
+}
+
+size_t eliasfano_bits(struct eliasfano *e)
+{
+	ASSERT_PRECONDITION(e != NULL, return 0);
+	return (e->n * e->l) + e->nupper + ((e->nones + e->nzeros) * sizeof(size_t) * 8);
+}
+
+int eliasfano_get(struct eliasfano *e, size_t idx, uint64_t *p)
+{
+	ASSERT_PRECONDITION(e != NULL && p != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(idx < e->n, return VEC_ERANGE);
+
+	uint64_t high = __ef_select(e, idx, false) - idx;
+	*p	      = (high << e->l) | __ef_low(e, idx);
+	return VEC_SUCCESS;
+}
+
+int eliasfano_next_geq(struct eliasfano *e, uint64_t x, size_t *idx, uint64_t *p)
+{
+	ASSERT_PRECONDITION(e != NULL && idx != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(e->n > 0 && x <= e->last, return VEC_ERANGE);
+
+	/*
+	 * The values sharing the high part of x lie between the unset bits
+	 * closing the previous part and this one, and are sorted by their low
+	 * bits. Past them, the next value is the answer.
+	 */
+	uint64_t high = x >> e->l;
+	size_t lo     = high ? __ef_select(e, high - 1, true) + 1 - high : 0;
+	size_t hi     = __ef_select(e, high, true) - high;
+
+	uint64_t low = x & ((UINT64_C(1) << e->l) - 1);
+	while (lo < hi) {
+		size_t mid = lo + ((hi - lo) / 2);
+		if (__ef_low(e, mid) < low)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*idx = lo;
+	return p ? eliasfano_get(e, lo, p) : VEC_SUCCESS;
+}
+
+int eliasfano_decode(struct eliasfano *e, size_t begin, size_t n, uint64_t *out)
+{
+	ASSERT_PRECONDITION(e != NULL && (n == 0 || out != NULL), return VEC_EINVAL);
+	ASSERT_PRECONDITION(begin <= e->n && n <= e->n - begin, return VEC_ERANGE);
+	if (n == 0)
+		return VEC_SUCCESS;
+
+	/* low bits first, in a loop of their own the compiler can unroll */
+	if (e->l == 0) {
+		memset(out, 0, n * sizeof *out);
+	} else {
+		for (size_t i = 0; i < n; i++)
+			out[i] = __ef_low(e, begin + i);
+	}
+
+	size_t pos    = __ef_select(e, begin, false);
+	size_t w      = pos / 64;
+	uint64_t word = e->upper[w] & (UINT64_MAX << (pos % 64));
+	for (size_t i = 0; i < n; i++, word &= word - 1) {
+		while (!word)
+			word = e->upper[++w];
+		out[i] |= (((w * 64) + __builtin_ctzll(word)) - (begin + i)) << e->l;
+	}
+	return VEC_SUCCESS;
+}
@@ -0,0 +1,767 @@
+/*
+ * fmindex -- Suffix arrays and FM-indexes over bytes
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "fmindex.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum fm_consts {
+	/* number of byte values */
+	FM_SIGMA = 256,
+
+	/* text positions between two sampled ones */
+	FM_SAMPLE = 32,
+
+	/* bits of a bitvector per entry of its rank directory */
+	FM_BLOCK = 512,
+
+	/* rotations handled at once by a build thread, a multiple of 64 */
+	FM_CHUNK = 1 << 16,
+
+	/* longest code of the wavelet tree, a word */
+	FM_MAX_DEPTH = 64,
+
+	FM_MAX_THREADS = 64
+};
+
+/* an unfilled slot of a suffix array */
+static const size_t FM_NONE = SIZE_MAX;
+
+/* a bitvector, and the number of set bits before each of its blocks */
+struct fm_bitvec {
+	uint64_t *bits;
+	uint64_t *dir;
+	size_t len;
+};
+
+/* an inner node of the wavelet tree, children below 0 are the leaves ~c */
+struct fm_node {
+	struct fm_bitvec b;
+	int child[2];
+};
+
+struct fmindex {
+	/* length of the text */
+	size_t n;
+
+	/* the rotation starting at the start of the text, left out of the tree */
+	size_t dollar;
+
+	/* rotations starting below byte c, the first one starting at the end */
+	size_t C[FM_SIGMA + 1];
+
+	/* wavelet tree of the transform, children are made before their parents */
+	struct fm_node nodes[FM_SIGMA - 1];
+	size_t nnodes;
+	int root;
+
+	/* path of each byte from the root, bit d the child taken at depth d */
+	uint64_t code[FM_SIGMA];
+	uint8_t depth[FM_SIGMA];
+
+	/* storage of the bitvectors of the tree */
+	uint64_t *bits;
+	size_t nbits;
+	uint64_t *dir;
+	size_t ndir;
+
+	/* rotations starting at sampled positions, and these positions, packed */
+	struct fm_bitvec marked;
+	uint64_t *samples;
+	size_t nsamples;
+	unsigned width;
+};
+
+/* a text of bytes, or of names of substrings when recursing */
+struct fm_text {
+	const uint8_t *bytes;
+	const size_t *names;
+};
+
+/* state of a level of SA-IS */
+struct fm_sais {
+	struct fm_text s;
+	size_t n;
+	size_t upper;
+
+	/* whether each suffix is smaller than the next one, S type, or larger, L type */
+	bool *ls;
+
+	/* starts of the S and L parts of the bucket of each character */
+	size_t *sum_s;
+	size_t *sum_l;
+	size_t *buf;
+
+	size_t *sa;
+};
+
+/* bits appended from pos on, whole words are ORed in as other threads may share the ends */
+struct fm_writer {
+	uint64_t *bits;
+	size_t pos;
+	uint64_t word;
+};
+
+struct fm_build {
+	struct fmindex *f;
+	const uint8_t *text;
+
+	/* suffix array of the text with its end, which comes first */
+	const size_t *sa;
+	size_t rows;
+
+	/* the transform, read in order once gathered from the text */
+	uint8_t *bwt;
+	size_t nchunks;
+
+	/* bytes and sampled positions of each chunk, then of the chunks before it */
+	size_t (*counts)[FM_SIGMA];
+	size_t *marked;
+
+	_Atomic size_t next;
+};
+
+static inline size_t __fm_chr(struct fm_text s, size_t i)
+{
+	return s.bytes ? s.bytes[i] : s.names[i];
+}
+
+static inline size_t __fm_words(size_t bits)
+{
+	/* one spare word, fields straddling a word read the next one */
+	return (bits + 63) / 64 + 1;
+}
+
+/* sort all suffixes from the LMS ones, L type ones forward, then S type ones backward */
+static void __fm_induce(struct fm_sais *z, const size_t *lms, size_t m)
+{
+	struct fm_text s = z->s;
+	size_t *sa	 = z->sa;
+	size_t n	 = z->n;
+
+	for (size_t i = 0; i < n; i++)
+		sa[i] = FM_NONE;
+
+	memcpy(z->buf, z->sum_s, (z->upper + 1) * sizeof *z->buf);
+	for (size_t k = 0; k < m; k++)
+		sa[z->buf[__fm_chr(s, lms[k])]++] = lms[k];
+
+	memcpy(z->buf, z->sum_l, (z->upper + 1) * sizeof *z->buf);
+	sa[z->buf[__fm_chr(s, n - 1)]++] = n - 1;
+	for (size_t i = 0; i < n; i++) {
+		size_t v = sa[i];
+		if (v != FM_NONE && v > 0 && !z->ls[v - 1])
+			sa[z->buf[__fm_chr(s, v - 1)]++] = v - 1;
+	}
+
+	memcpy(z->buf, z->sum_l, (z->upper + 1) * sizeof *z->buf);
+	for (size_t i = n; i-- > 0;) {
+		size_t v = sa[i];
+		if (v != FM_NONE && v > 0 && z->ls[v - 1])
+			sa[--z->buf[__fm_chr(s, v - 1) + 1]] = v - 1;
+	}
+}
+
+/* whether the LMS substrings starting at l and r, up to the next LMS positions, are equal */
+static bool __fm_same(struct fm_text s, size_t n, const size_t *lms, size_t m, const size_t *lms_map, size_t l,
+		      size_t r)
+{
+	size_t end_l = lms_map[l] + 1 < m ? lms[lms_map[l] + 1] : n;
+	size_t end_r = lms_map[r] + 1 < m ? lms[lms_map[r] + 1] : n;
+	if (end_l - l != end_r - r)
+		return false;
+
+	for (; l < end_l; l++, r++) {
+		if (__fm_chr(s, l) != __fm_chr(s, r))
+			return false;
+	}
+	return l < n && r < n && __fm_chr(s, l) == __fm_chr(s, r);
+}
+
+/*
+ * Store the suffix array of the n characters of s, each at most upper, in
+ * sa. The LMS suffixes, S type ones following L type ones, are sorted by
+ * their substrings up to the next LMS suffix with an induced sort. Unless
+ * the substrings are all distinct, the LMS suffixes are then sorted
+ * recursively, with the substrings renamed by their order. A second induced
+ * sort orders all suffixes from them.
+ */
+static int __fm_sais(struct fm_text s, size_t n, size_t upper, size_t *sa)
+{
+	if (n <= 2) {
+		bool swap = n == 2 && __fm_chr(s, 0) >= __fm_chr(s, 1);
+		for (size_t i = 0; i < n; i++)
+			sa[i] = i ^ swap;
+		return VEC_SUCCESS;
+	}
+
+	struct fm_sais z = {
+		.s     = s,
+		.n     = n,
+		.upper = upper,
+		.ls    = calloc(n, sizeof *z.ls),
+		.sum_s = calloc(upper + 1, sizeof *z.sum_s),
+		.sum_l = calloc(upper + 1, sizeof *z.sum_l),
+		.buf   = malloc((upper + 1) * sizeof *z.buf),
+		.sa    = sa,
+	};
+	size_t *lms_map = malloc(n * sizeof *lms_map);
+	size_t *lms	= malloc((n / 2 + 1) * sizeof *lms);
+	size_t *names	= NULL;
+	int res		= z.ls && z.sum_s && z.sum_l && z.buf && lms_map && lms ? VEC_SUCCESS : VEC_ENOMEM;
+
+	size_t m = 0;
+	if (res == VEC_SUCCESS) {
+		for (size_t i = n - 1; i-- > 0;) {
+			size_t a = __fm_chr(s, i), b = __fm_chr(s, i + 1);
+			z.ls[i]	 = a == b ? z.ls[i + 1] : a < b;
+		}
+		for (size_t i = 0; i < n; i++) {
+			if (!z.ls[i])
+				z.sum_s[__fm_chr(s, i)]++;
+			else
+				z.sum_l[__fm_chr(s, i) + 1]++;
+		}
+		for (size_t c = 0; c <= upper; c++) {
+			z.sum_s[c] += z.sum_l[c];
+			if (c < upper)
+				z.sum_l[c + 1] += z.sum_s[c];
+		}
+
+		lms_map[0] = FM_NONE;
+		for (size_t i = 1; i < n; i++) {
+			lms_map[i] = FM_NONE;
+			if (!z.ls[i - 1] && z.ls[i]) {
+				lms_map[i] = m;
+				lms[m++]   = i;
+			}
+		}
+		__fm_induce(&z, lms, m);
+	}
+
+	if (res == VEC_SUCCESS && m > 0) {
+		/* the LMS suffixes, sorted by their substrings, go to the front of sa */
+		size_t k = 0;
+		for (size_t i = 0; i < n; i++) {
+			if (lms_map[sa[i]] != FM_NONE)
+				sa[k++] = sa[i];
+		}
+
+		names = malloc(m * sizeof *names);
+		res   = names ? VEC_SUCCESS : VEC_ENOMEM;
+	}
+
+	if (res == VEC_SUCCESS && m > 0) {
+		size_t name		= 0;
+		names[lms_map[sa[0]]] = 0;
+		for (size_t i = 1; i < m; i++) {
+			if (!__fm_same(s, n, lms, m, lms_map, sa[i - 1], sa[i]))
+				name++;
+			names[lms_map[sa[i]]] = name;
+		}
+
+		/* not needed below, while the recursion needs memory */
+		free(lms_map);
+		lms_map = NULL;
+
+		if (name + 1 < m) {
+			res = __fm_sais((struct fm_text){ NULL, names }, m, name, sa);
+		} else {
+			/* all distinct, the names are the order */
+			for (size_t i = 0; i < m; i++)
+				sa[names[i]] = i;
+		}
+		if (res == VEC_SUCCESS) {
+			for (size_t i = 0; i < m; i++)
+				sa[i] = lms[sa[i]];
+			memcpy(lms, sa, m * sizeof *lms);
+			__fm_induce(&z, lms, m);
+		}
+	}
+
+	free(names);
+	free(lms);
+	free(lms_map);
+	free(z.buf);
+	free(z.sum_l);
+	free(z.sum_s);
+	free(z.ls);
+	return res;
+}
+
+static inline void __fm_put(struct fm_writer *wr, uint64_t x, unsigned w)
+{
+	unsigned off = wr->pos % 64;
+	wr->word |= x << off;
+	if (off + w >= 64) {
+		__atomic_fetch_or(&wr->bits[wr->pos / 64], wr->word, __ATOMIC_RELAXED);
+		wr->word = off ? x >> (64 - off) : 0;
+	}
+	wr->pos += w;
+}
+
+static inline void __fm_flush(struct fm_writer *wr)
+{
+	if (wr->pos % 64)
+		__atomic_fetch_or(&wr->bits[wr->pos / 64], wr->word, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t __fm_get(const uint64_t *a, size_t pos, unsigned w)
+{
+	size_t i     = pos / 64;
+	unsigned off = pos % 64;
+	uint64_t x   = a[i] >> off;
+	if (off + w > 64)
+		x |= a[i + 1] << (64 - off);
+	return w < 64 ? x & ((UINT64_C(1) << w) - 1) : x;
+}
+
+static inline bool __fm_bit(const struct fm_bitvec *b, size_t i)
+{
+	return (b->bits[i / 64] >> (i % 64)) & 1;
+}
+
+/* set bits of b before i */
+static inline size_t __fm_rank1(const struct fm_bitvec *b, size_t i)
+{
+	size_t w = (i / FM_BLOCK) * (FM_BLOCK / 64), end = i / 64;
+	size_t r = b->dir[i / FM_BLOCK];
+	for (; w < end; w++)
+		r += __builtin_popcountll(b->bits[w]);
+	if (i % 64)
+		r += __builtin_popcountll(b->bits[end] << (64 - (i % 64)));
+	return r;
+}
+
+static void __fm_index_bits(struct fm_bitvec *b)
+{
+	uint64_t r   = 0;
+	size_t words = (b->len + 63) / 64;
+	for (size_t w = 0; w < words; w++) {
+		if (w % (FM_BLOCK / 64) == 0)
+			b->dir[w / (FM_BLOCK / 64)] = r;
+		r += __builtin_popcountll(b->bits[w]);
+	}
+	if (b->len % FM_BLOCK == 0)
+		b->dir[b->len / FM_BLOCK] = r;
+}
+
+/* occurrences of byte c in the transform before rotation i */
+static size_t __fm_rank(const struct fmindex *f, uint8_t c, size_t i)
+{
+	i -= f->dollar < i;
+
+	int v	      = f->root;
+	uint64_t code = f->code[c];
+	for (unsigned d = 0; d < f->depth[c]; d++, code >>= 1) {
+		const struct fm_node *x = &f->nodes[v];
+		size_t ones		= __fm_rank1(&x->b, i);
+		i			= code & 1 ? ones : i - ones;
+		v			= x->child[code & 1];
+	}
+	return i;
+}
+
+/* the rotation starting one byte before rotation r, which must not start at the start */
+static size_t __fm_lf(const struct fmindex *f, size_t r)
+{
+	size_t i = r - (f->dollar < r);
+	int v	 = f->root;
+	while (v >= 0) {
+		const struct fm_node *x = &f->nodes[v];
+		bool bit		= __fm_bit(&x->b, i);
+		size_t ones		= __fm_rank1(&x->b, i);
+		i			= bit ? ones : i - ones;
+		v			= x->child[bit];
+	}
+	return f->C[~v] + i;
+}
+
+/* the rotations starting with the pattern are [*sp, *ep) */
+static void __fm_range(const struct fmindex *f, const uint8_t *pattern, size_t len, size_t *sp, size_t *ep)
+{
+	size_t s = 0, e = f->n + 1;
+	for (size_t i = len; i-- > 0 && s < e;) {
+		uint8_t c = pattern[i];
+		if (f->C[c] == f->C[c + 1]) {
+			e = s;
+			break;
+		}
+		s = f->C[c] + __fm_rank(f, c, s);
+		e = f->C[c] + __fm_rank(f, c, e);
+	}
+	*sp = s;
+	*ep = e;
+}
+
+/* the position of rotation r, walking back to a sampled one */
+static size_t __fm_position(const struct fmindex *f, size_t r)
+{
+	size_t steps = 0;
+	for (; !__fm_bit(&f->marked, r); steps++)
+		r = __fm_lf(f, r);
+	return __fm_get(f->samples, __fm_rank1(&f->marked, r) * f->width, f->width) + steps;
+}
+
+/* assign the codes below x, returning the depth of the deepest leaf */
+static unsigned __fm_code(struct fmindex *f, int x, uint64_t code, unsigned d)
+{
+	if (x < 0) {
+		f->code[~x]  = code;
+		f->depth[~x] = d;
+		return d;
+	}
+	if (d >= FM_MAX_DEPTH)
+		return d + 1;
+
+	unsigned l = __fm_code(f, f->nodes[x].child[0], code, d + 1);
+	unsigned r = __fm_code(f, f->nodes[x].child[1], code | (UINT64_C(1) << d), d + 1);
+	return l > r ? l : r;
+}
+
+/*
+ * Shape the wavelet tree as the Huffman tree of the weights of the bytes,
+ * merging the two lightest subtrees until one is left. Returns the depth
+ * of the tree.
+ */
+static unsigned __fm_shape(struct fmindex *f, const size_t *weight)
+{
+	int id[FM_SIGMA];
+	size_t w[FM_SIGMA];
+	size_t k = 0;
+	for (int c = 0; c < FM_SIGMA; c++) {
+		if (weight[c]) {
+			id[k]  = ~c;
+			w[k++] = weight[c];
+		}
+	}
+
+	f->nnodes = 0;
+	while (k > 1) {
+		size_t a = w[0] <= w[1] ? 0 : 1, b = 1 - a;
+		for (size_t i = 2; i < k; i++) {
+			if (w[i] < w[a]) {
+				b = a;
+				a = i;
+			} else if (w[i] < w[b]) {
+				b = i;
+			}
+		}
+
+		struct fm_node *x = &f->nodes[f->nnodes];
+		x->child[0]	  = id[a];
+		x->child[1]	  = id[b];
+		id[a]		  = f->nnodes++;
+		w[a] += w[b];
+		id[b] = id[--k];
+		w[b]  = w[k];
+	}
+	f->root = k ? id[0] : ~0;
+	return k ? __fm_code(f, f->root, 0, 0) : 0;
+}
+
+static void *__fm_count_worker(void *arg)
+{
+	struct fm_build *b = arg;
+
+	size_t chunk;
+	while ((chunk = atomic_fetch_add(&b->next, 1)) < b->nchunks) {
+		size_t end = (chunk + 1) * FM_CHUNK < b->rows ? (chunk + 1) * FM_CHUNK : b->rows;
+		for (size_t r = chunk * FM_CHUNK; r < end; r++) {
+			size_t p = b->sa[r];
+			b->marked[chunk] += p % FM_SAMPLE == 0;
+			if (p > 0) {
+				b->bwt[r] = b->text[p - 1];
+				b->counts[chunk][b->bwt[r]]++;
+			} else {
+				b->f->dollar = r;
+			}
+		}
+	}
+	return NULL;
+}
+
+static void *__fm_fill_worker(void *arg)
+{
+	struct fm_build *b = arg;
+	struct fmindex *f  = b->f;
+
+	struct fm_writer tree[FM_SIGMA - 1];
+	size_t chunk;
+	while ((chunk = atomic_fetch_add(&b->next, 1)) < b->nchunks) {
+		/* bytes before the chunk below each node are where its bits go */
+		const size_t *before = b->counts[chunk];
+		size_t below[FM_SIGMA - 1];
+		for (size_t v = 0; v < f->nnodes; v++) {
+			const int *child = f->nodes[v].child;
+			below[v]	 = 0;
+			for (int k = 0; k < 2; k++)
+				below[v] += child[k] < 0 ? before[~child[k]] : below[child[k]];
+			tree[v] = (struct fm_writer){ f->nodes[v].b.bits, below[v], 0 };
+		}
+		struct fm_writer marked	 = { f->marked.bits, chunk * FM_CHUNK, 0 };
+		struct fm_writer samples = { f->samples, b->marked[chunk] * f->width, 0 };
+
+		size_t end = (chunk + 1) * FM_CHUNK < b->rows ? (chunk + 1) * FM_CHUNK : b->rows;
+		for (size_t r = chunk * FM_CHUNK; r < end; r++) {
+			size_t p     = b->sa[r];
+			bool sampled = p % FM_SAMPLE == 0;
+			__fm_put(&marked, sampled, 1);
+			if (sampled)
+				__fm_put(&samples, p, f->width);
+			if (p == 0)
+				continue;
+
+			uint8_t c     = b->bwt[r];
+			uint64_t code = f->code[c];
+			int v	      = f->root;
+			for (unsigned d = 0; d < f->depth[c]; d++, code >>= 1) {
+				__fm_put(&tree[v], code & 1, 1);
+				v = f->nodes[v].child[code & 1];
+			}
+		}
+
+		for (size_t v = 0; v < f->nnodes; v++)
+			__fm_flush(&tree[v]);
+		__fm_flush(&marked);
+		__fm_flush(&samples);
+	}
+	return NULL;
+}
+
+/* run fn on nthreads threads, the calling thread being one of them */
+static void __fm_parallel(size_t nthreads, void *(*fn)(void *), struct fm_build *b)
+{
+	pthread_t threads[nthreads];
+	bool spawned[nthreads];
+
+	atomic_store(&b->next, 0);
+	for (size_t t = 0; t + 1 < nthreads; t++)
+		spawned[t] = pthread_create(&threads[t], NULL, fn, b) == 0;
+	fn(b);
+	for (size_t t = 0; t + 1 < nthreads; t++) {
+		if (spawned[t])
+			pthread_join(threads[t], NULL);
+	}
+}
+
+/* lay the bitvectors out, once the bytes of the transform are counted */
+static int __fm_alloc(struct fmindex *f, const size_t *freq, size_t nmarked)
+{
+	size_t weight[FM_SIGMA];
+	memcpy(weight, freq, sizeof weight);
+	while (__fm_shape(f, weight) > FM_MAX_DEPTH) {
+		/* flatter weights, for a shallower tree */
+		for (int c = 0; c < FM_SIGMA; c++)
+			weight[c] = (weight[c] + 1) / 2;
+	}
+
+	size_t len[FM_SIGMA - 1];
+	f->nbits = f->ndir = 0;
+	for (size_t v = 0; v < f->nnodes; v++) {
+		const int *child = f->nodes[v].child;
+		len[v]		 = 0;
+		for (int k = 0; k < 2; k++)
+			len[v] += child[k] < 0 ? freq[~child[k]] : len[child[k]];
+		f->nbits += __fm_words(len[v]);
+		f->ndir += (len[v] / FM_BLOCK) + 1;
+	}
+
+	f->bits = calloc(f->nbits ? f->nbits : 1, sizeof *f->bits);
+	f->dir	= malloc((f->ndir ? f->ndir : 1) * sizeof *f->dir);
+
+	f->marked.len  = f->n + 1;
+	f->marked.bits = calloc(__fm_words(f->marked.len), sizeof *f->marked.bits);
+	f->marked.dir  = malloc(((f->marked.len / FM_BLOCK) + 1) * sizeof *f->marked.dir);
+
+	f->width    = 64 - __builtin_clzll((uint64_t)f->n | 1);
+	f->nsamples = nmarked;
+	f->samples  = calloc(__fm_words(nmarked * f->width), sizeof *f->samples);
+	if (!f->bits || !f->dir || !f->marked.bits || !f->marked.dir || !f->samples)
+		return VEC_ENOMEM;
+
+	size_t bits = 0, dir = 0;
+	for (size_t v = 0; v < f->nnodes; v++) {
+		f->nodes[v].b = (struct fm_bitvec){ f->bits + bits, f->dir + dir, len[v] };
+		bits += __fm_words(len[v]);
+		dir += (len[v] / FM_BLOCK) + 1;
+	}
+	return VEC_SUCCESS;
+}
+
+static int __fm_index(struct fm_build *b, size_t nthreads)
+{
+	struct fmindex *f = b->f;
+
+	__fm_parallel(nthreads, __fm_count_worker, b);
+
+	size_t freq[FM_SIGMA] = { 0 }, nmarked = 0;
+	for (size_t chunk = 0; chunk < b->nchunks; chunk++) {
+		for (int c = 0; c < FM_SIGMA; c++) {
+			size_t x	       = b->counts[chunk][c];
+			b->counts[chunk][c] = freq[c];
+			freq[c] += x;
+		}
+		size_t x	 = b->marked[chunk];
+		b->marked[chunk] = nmarked;
+		nmarked += x;
+	}
+
+	f->C[0] = 1;
+	for (int c = 0; c < FM_SIGMA; c++)
+		f->C[c + 1] = f->C[c] + freq[c];
+
+	int res = __fm_alloc(f, freq, nmarked);
+	if (res != VEC_SUCCESS)
+		return res;
+
+	__fm_parallel(nthreads, __fm_fill_worker, b);
+
+	for (size_t v = 0; v < f->nnodes; v++)
+		__fm_index_bits(&f->nodes[v].b);
+	__fm_index_bits(&f->marked);
+	return VEC_SUCCESS;
+}
+
+static int __fm_cmp_pos(const void *a, const void *b)
+{
+	size_t x = *(const size_t *)a, y = *(const size_t *)b;
+	return (x > y) - (x < y);
+}
+
+int fmindex_suffix_array(struct vector *text, struct vector *sa)
+{
+	ASSERT_PRECONDITION(text != NULL && sa != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(text) == 1 && !vector_is_indirect(text), return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(sa) == sizeof(size_t) && !vector_is_indirect(sa), return VEC_EINVAL);
+
+	size_t n = vector_size(text);
+	int res	 = vector_resize(sa, n);
+	if (res != VEC_SUCCESS || n == 0)
+		return res;
+
+	return __fm_sais((struct fm_text){ vector_data(text), NULL }, n, FM_SIGMA - 1, vector_data(sa));
+}
+
+int fmindex_build(struct fmindex **fp, struct vector *text, size_t nthreads)
+{
+	ASSERT_PRECONDITION(fp != NULL && text != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(text) == 1 && !vector_is_indirect(text), return VEC_EINVAL);
+
+	if (nthreads == 0) {
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads    = online > 0 ? online : 1;
+	}
+	nthreads = nthreads < FM_MAX_THREADS ? nthreads : FM_MAX_THREADS;
+
+	struct fmindex *f = calloc(1, sizeof *f);
+	if (!f)
+		return VEC_ENOMEM;
+	f->n = vector_size(text);
+
+	/* the end of the text is the smallest suffix */
+	size_t *sa = malloc((f->n + 1) * sizeof *sa);
+	int res	   = sa ? VEC_SUCCESS : VEC_ENOMEM;
+	if (res == VEC_SUCCESS) {
+		sa[0] = f->n;
+		res   = __fm_sais((struct fm_text){ vector_data(text), NULL }, f->n, FM_SIGMA - 1, sa + 1);
+	}
+
+	struct fm_build b = {
+		.f	 = f,
+		.text	 = vector_data(text),
+		.sa	 = sa,
+		.rows	 = f->n + 1,
+		.nchunks = (f->n + FM_CHUNK) / FM_CHUNK,
+	};
+	if (res == VEC_SUCCESS) {
+		b.bwt	 = malloc(b.rows);
+		b.counts = calloc(b.nchunks, sizeof *b.counts);
+		b.marked = calloc(b.nchunks, sizeof *b.marked);
+		res	 = b.bwt && b.counts && b.marked ? __fm_index(&b, nthreads) : VEC_ENOMEM;
+	}
+
+	free(b.bwt);
+	free(b.marked);
+	free(b.counts);
+	free(sa);
+	if (res != VEC_SUCCESS) {
+		fmindex_free(&f);
+		return res;
+	}
+
+	*fp = f;
+	return VEC_SUCCESS;
+}
+
+void fmindex_free(struct fmindex **fp)
+{
+	ASSERT_PRECONDITION(fp && *fp, return );
+
+	struct fmindex *f = *fp;
+	free(f->bits);
+	free(f->dir);
+	free(f->marked.bits);
+	free(f->marked.dir);
+	free(f->samples);
+	free(f);
+
+	*fp = NULL;
+}
+
+size_t fmindex_size(struct fmindex *f)
+{
+	ASSERT_PRECONDITION(f != NULL, return 0);
+	return f->n;
+}
+
+size_t fmindex_bits(struct fmindex *f)
+{
+	ASSERT_PRECONDITION(f != NULL, return 0);
+
+	size_t words = f->nbits + f->ndir + __fm_words(f->marked.len) + (f->marked.len / FM_BLOCK) + 1 +
+		       __fm_words(f->nsamples * f->width);
+	return (8 * sizeof *f) + (64 * words);
+}
+
+int fmindex_count(struct fmindex *f, const void *pattern, size_t len, size_t *count)
+{
+	ASSERT_PRECONDITION(f != NULL && pattern != NULL && len > 0 && count != NULL, return VEC_EINVAL);
+
+	size_t s, e;
+	__fm_range(f, pattern, len, &s, &e);
+	*count = e - s;
+	return VEC_SUCCESS;
+}
+
+int fmindex_locate(struct fmindex *f, const void *pattern, size_t len, struct vector *out)
+{
+	ASSERT_PRECONDITION(f != NULL && pattern != NULL && len > 0 && out != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(out) == sizeof(size_t) && !vector_is_indirect(out), return VEC_EINVAL);
+
+	size_t s, e;
+	__fm_range(f, pattern, len, &s, &e);
+
+	size_t first = vector_size(out);
+	for (size_t r = s; r < e; r++) {
+		size_t p = __fm_position(f, r);
+		int res	 = vector_push(out, &p);
+		if (res != VEC_SUCCESS)
+			return res;
+	}
+
+	qsort((size_t *)vector_data(out) + first, e - s, sizeof(size_t), __fm_cmp_pos);
+	return VEC_SUCCESS;
+}
@@ -0,0 +1,281 @@
+/*
+ * itree -- Implicit interval trees, cgranges style
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "itree.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum it_consts {
+	/* subtrees up to this level are scanned rather than walked */
+	IT_SCAN_LEVEL = 3,
+
+	/* deepest walk, trees have fewer than 2^63 nodes */
+	IT_STACK = 64
+};
+
+/* a range, sorted by start, and the largest end of its subtree */
+struct it_node {
+	int64_t start;
+	int64_t end;
+	int64_t max;
+	size_t idx;
+};
+
+struct itree {
+	struct it_node *nodes;
+	size_t n;
+
+	/* level of the root, at index 2^root - 1 */
+	unsigned root;
+};
+
+/* a subtree left to walk, whose left child was walked if w */
+struct it_frame {
+	size_t x;
+	unsigned k;
+	bool w;
+};
+
+/* a query of a batch, and where it was in the batch */
+struct it_query {
+	int64_t start;
+	size_t q;
+};
+
+/* hits of a batch, collected in the order the queries run */
+struct it_hits {
+	size_t *q;
+	size_t *idx;
+	size_t n;
+	size_t capacity;
+};
+
+static int __it_cmp_node(const void *a, const void *b)
+{
+	const struct it_node *x = a, *y = b;
+	if (x->start != y->start)
+		return x->start < y->start ? -1 : 1;
+	return (x->idx > y->idx) - (x->idx < y->idx);
+}
+
+static int __it_cmp_query(const void *a, const void *b)
+{
+	const struct it_query *x = a, *y = b;
+	if (x->start != y->start)
+		return x->start < y->start ? -1 : 1;
+	return (x->q > y->q) - (x->q < y->q);
+}
+
+/*
+ * Compute the largest end of each subtree, level by level. Nodes past the
+ * array on the right edge of the tree take the largest end of the last
+ * node present below them.
+ */
+static unsigned __it_index(struct it_node *a, size_t n)
+{
+	size_t last_i = 0;
+	int64_t last  = 0;
+	for (size_t i = 0; i < n; i += 2) {
+		last_i = i;
+		last = a[i].max = a[i].end;
+	}
+
+	unsigned k = 1;
+	for (; (UINT64_C(1) << k) <= n; k++) {
+		size_t x = (size_t)1 << (k - 1), i0 = (x << 1) - 1, step = x << 2;
+		for (size_t i = i0; i < n; i += step) {
+			int64_t el = a[i - x].max;
+			int64_t er = i + x < n ? a[i + x].max : last;
+			int64_t e  = a[i].end;
+			e	   = e > el ? e : el;
+			a[i].max   = e > er ? e : er;
+		}
+
+		last_i = (last_i >> k) & 1 ? last_i - x : last_i + x;
+		if (last_i < n && a[last_i].max > last)
+			last = a[last_i].max;
+	}
+	return k - 1;
+}
+
+/* call emit with the index of each range overlapping [st, en), in start order */
+static int __it_query(const struct itree *t, int64_t st, int64_t en, int (*emit)(void *, size_t), void *arg)
+{
+	const struct it_node *a = t->nodes;
+	struct it_frame stack[IT_STACK];
+	size_t top = 0;
+	if (t->n == 0 || st >= en)
+		return VEC_SUCCESS;
+
+	stack[top++] = (struct it_frame){ ((size_t)1 << t->root) - 1, t->root, false };
+	while (top) {
+		struct it_frame z = stack[--top];
+		if (z.k <= IT_SCAN_LEVEL) {
+			/* a small subtree is a run of the array */
+			size_t i0 = z.x >> z.k << z.k, i1 = i0 + ((size_t)1 << (z.k + 1)) - 1;
+			i1	  = i1 < t->n ? i1 : t->n;
+			for (size_t i = i0; i < i1 && a[i].start < en; i++) {
+				int res;
+				if (st < a[i].end && (res = emit(arg, a[i].idx)) != VEC_SUCCESS)
+					return res;
+			}
+		} else if (!z.w) {
+			/* come back for the node and its right child after the left child */
+			size_t y     = z.x - ((size_t)1 << (z.k - 1));
+			stack[top++] = (struct it_frame){ z.x, z.k, true };
+			if (y >= t->n || a[y].max > st)
+				stack[top++] = (struct it_frame){ y, z.k - 1, false };
+		} else if (z.x < t->n && a[z.x].start < en) {
+			int res;
+			if (st < a[z.x].end && (res = emit(arg, a[z.x].idx)) != VEC_SUCCESS)
+				return res;
+			stack[top++] = (struct it_frame){ z.x + ((size_t)1 << (z.k - 1)), z.k - 1, false };
+		}
+	}
+	return VEC_SUCCESS;
+}
+
+static int __it_emit_vector(void *arg, size_t idx)
+{
+	return vector_push(arg, &idx);
+}
+
+static int __it_emit_hit(void *arg, size_t idx)
+{
+	struct it_hits *h = arg;
+	if (h->n == h->capacity) {
+		size_t capacity = h->capacity ? 2 * h->capacity : 64;
+		size_t *q	= realloc(h->q, capacity * sizeof *q);
+		if (!q)
+			return VEC_ENOMEM;
+		h->q = q;
+
+		size_t *ix = realloc(h->idx, capacity * sizeof *ix);
+		if (!ix)
+			return VEC_ENOMEM;
+		h->idx	    = ix;
+		h->capacity = capacity;
+	}
+
+	/* the query is filled in by the caller, once its walk is done */
+	h->idx[h->n++] = idx;
+	return VEC_SUCCESS;
+}
+
+int itree_build(struct itree **tp, struct vector *v, size_t startoff, size_t endoff)
+{
+	ASSERT_PRECONDITION(tp != NULL && v != NULL && !vector_is_indirect(v), return VEC_EINVAL);
+	ASSERT_PRECONDITION(startoff + sizeof(int64_t) <= vector_object_size(v), return VEC_EINVAL);
+	ASSERT_PRECONDITION(endoff + sizeof(int64_t) <= vector_object_size(v), return VEC_EINVAL);
+
+	struct itree *t = calloc(1, sizeof *t);
+	if (!t)
+		return VEC_ENOMEM;
+
+	t->n	 = vector_size(v);
+	t->nodes = malloc((t->n ? t->n : 1) * sizeof *t->nodes);
+	if (!t->nodes) {
+		itree_free(&t);
+		return VEC_ENOMEM;
+	}
+
+	size_t objsz	 = vector_object_size(v);
+	const char *data = vector_data(v);
+	for (size_t i = 0; i < t->n; i++) {
+		struct it_node *node = &t->nodes[i];
+		memcpy(&node->start, data + (i * objsz) + startoff, sizeof node->start);
+		memcpy(&node->end, data + (i * objsz) + endoff, sizeof node->end);
+		node->idx = i;
+	}
+
+	qsort(t->nodes, t->n, sizeof *t->nodes, __it_cmp_node);
+	t->root = t->n ? __it_index(t->nodes, t->n) : 0;
+
+	*tp = t;
+	return VEC_SUCCESS;
+}
+
+void itree_free(struct itree **tp)
+{
+	ASSERT_PRECONDITION(tp && *tp, return );
+
+	struct itree *t = *tp;
+	free(t->nodes);
+	free(t);
+
+	*tp = NULL;
+}
+
+size_t itree_size(struct itree *t)
+{
+	ASSERT_PRECONDITION(t != NULL, return 0);
+	return t->n;
+}
+
+int itree_overlap(struct itree *t, int64_t start, int64_t end, struct vector *out)
+{
+	ASSERT_PRECONDITION(t != NULL && out != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(out) == sizeof(size_t), return VEC_EINVAL);
+
+	return __it_query(t, start, end, __it_emit_vector, out);
+}
+
+int itree_overlap_batch(struct itree *t, const struct itree_range *q, size_t k, struct jagged *out)
+{
+	ASSERT_PRECONDITION(t != NULL && out != NULL && (k == 0 || q != NULL), return VEC_EINVAL);
+	ASSERT_PRECONDITION(jagged_object_size(out) == sizeof(size_t), return VEC_EINVAL);
+
+	struct it_query *order = malloc((k ? k : 1) * sizeof *order);
+	size_t *first	       = calloc(k + 1, sizeof *first);
+	struct it_hits hits    = { 0 };
+	int res		       = order && first ? VEC_SUCCESS : VEC_ENOMEM;
+
+	if (res == VEC_SUCCESS) {
+		for (size_t i = 0; i < k; i++)
+			order[i] = (struct it_query){ q[i].start, i };
+		qsort(order, k, sizeof *order, __it_cmp_query);
+	}
+
+	/* run the queries by start, counting the hits of each */
+	for (size_t i = 0; i < k && res == VEC_SUCCESS; i++) {
+		size_t before = hits.n;
+		res	      = __it_query(t, order[i].start, q[order[i].q].end, __it_emit_hit, &hits);
+		for (size_t j = before; j < hits.n; j++)
+			hits.q[j] = order[i].q;
+		first[order[i].q + 1] = hits.n - before;
+	}
+
+	/* then place them back in the order of the queries */
+	size_t *placed = NULL;
+	if (res == VEC_SUCCESS && hits.n && !(placed = malloc(hits.n * sizeof *placed)))
+		res = VEC_ENOMEM;
+	if (res == VEC_SUCCESS) {
+		for (size_t i = 0; i < k; i++)
+			first[i + 1] += first[i];
+		for (size_t j = 0; j < hits.n; j++)
+			placed[first[hits.q[j]]++] = hits.idx[j];
+
+		size_t j = 0;
+		for (size_t i = 0; i < k && res == VEC_SUCCESS; i++) {
+			res = jagged_add_row(out);
+			for (; res == VEC_SUCCESS && j < first[i]; j++)
+				res = jagged_push(out, &placed[j]);
+		}
+	}
+
+	free(placed);
+	free(hits.q);
+	free(hits.idx);
+	free(order);
+	free(first);
+	return res;
+}
@@ -0,0 +1,189 @@
+/*
+ * jagged -- Jagged arrays stored as one vector of objects and row offsets
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "jagged.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+struct jagged {
+	/* objects of all rows, row after row */
+	struct vector *objs;
+
+	/* row i holds objs [offsets[i], offsets[i + 1]), rows + 1 entries */
+	struct vector *offsets;
+
+	/* number of rows */
+	size_t rows;
+};
+
+static inline size_t *__jagged_offsets(struct jagged *j)
+{
+	return vector_data(j->offsets);
+}
+
+struct jagged *jagged_new(size_t objsz)
+{
+	struct jagged *j = malloc(sizeof *j);
+	if (!j)
+		return NULL;
+
+	j->rows	   = 0;
+	j->objs	   = vector_new(0, objsz);
+	j->offsets = vector_new(1, sizeof(size_t));
+
+	size_t zero = 0;
+	if (!j->objs || !j->offsets || vector_push(j->offsets, &zero) != VEC_SUCCESS) {
+		jagged_free(&j, NULL);
+		return NULL;
+	}
+
+	return j;
+}
+
+struct jagged *jagged_build(struct vector *rows, struct vector *objs, size_t nrows)
+{
+	ASSERT_PRECONDITION(rows && objs && vector_size(rows) == vector_size(objs), return NULL);
+	ASSERT_PRECONDITION(vector_object_size(rows) == sizeof(size_t), return NULL);
+	ASSERT_PRECONDITION(!vector_is_indirect(rows), return NULL);
+
+	size_t n     = vector_size(objs);
+	size_t objsz = vector_object_size(objs);
+
+	struct jagged *j = malloc(sizeof *j);
+	if (!j)
+		return NULL;
+
+	j->rows	   = nrows;
+	j->objs	   = vector_new(n, objsz);
+	j->offsets = vector_new(nrows + 1, sizeof(size_t));
+	if (!j->objs || !j->offsets) {
+		jagged_free(&j, NULL);
+		return NULL;
+	}
+
+	/* the offsets and the last object set the sizes, the rest is written in place */
+	size_t zero = 0;
+	if (vector_insert(j->offsets, nrows, &zero) != VEC_SUCCESS
+	    || (n > 0 && vector_insert(j->objs, n - 1, vector_at(objs, n - 1)) != VEC_SUCCESS)) {
+		jagged_free(&j, NULL);
+		return NULL;
+	}
+
+	size_t *row	 = vector_data(rows);
+	size_t *offsets	 = __jagged_offsets(j);
+	const char *src	 = vector_data(objs);
+	char *dst	 = vector_data(j->objs);
+	bool indirect	 = vector_is_indirect(objs);
+
+	/* count the objects of each row, shifted by one ... */
+	for (size_t i = 0; i < n; i++) {
+		if (row[i] >= nrows) {
+			jagged_free(&j, NULL);
+			return NULL;
+		}
+		offsets[row[i] + 1]++;
+	}
+
+	/* ... so the prefix sums give where each row begins */
+	for (size_t r = 0; r < nrows; r++)
+		offsets[r + 1] += offsets[r];
+
+	/* scatter, advancing each row's beginning as it fills up */
+	for (size_t i = 0; i < n; i++) {
+		const char *obj = indirect ? vector_at(objs, i) : src + (i * objsz);
+		memcpy(dst + (offsets[row[i]]++ * objsz), obj, objsz);
+	}
+
+	/* every beginning now sits at the end of its row, shift them back */
+	memmove(offsets + 1, offsets, nrows * sizeof *offsets);
+	offsets[0] = 0;
+
+	return j;
+}
+
+void jagged_free(struct jagged **jp, void (*elem_dtor)(void *))
+{
+	ASSERT_PRECONDITION(jp && *jp, return );
+
+	struct jagged *j = *jp;
+	if (j->objs)
+		vector_free(&j->objs, elem_dtor);
+	if (j->offsets)
+		vector_free(&j->offsets, NULL);
+	free(j);
+
+	*jp = NULL;
+}
+
+size_t jagged_rows(struct jagged *j)
+{
+	ASSERT_PRECONDITION(j != NULL, return 0);
+	return j->rows;
+}
+
+size_t jagged_size(struct jagged *j)
+{
+	ASSERT_PRECONDITION(j != NULL, return 0);
+	return vector_size(j->objs);
+}
+
+size_t jagged_object_size(struct jagged *j)
+{
+	ASSERT_PRECONDITION(j != NULL, return 0);
+	return vector_object_size(j->objs);
+}
+
+int jagged_add_row(struct jagged *j)
+{
+	ASSERT_PRECONDITION(j != NULL, return VEC_EINVAL);
+
+	size_t end = vector_size(j->objs);
+	int res	   = vector_push(j->offsets, &end);
+	if (res == VEC_SUCCESS)
+		j->rows++;
+	return res;
+}
+
+int jagged_push(struct jagged *j, void *p)
+{
+	ASSERT_PRECONDITION(j != NULL && p != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(j->rows > 0, return VEC_ERANGE);
+
+	int res = vector_push(j->objs, p);
+	if (res != VEC_SUCCESS)
+		return res;
+
+	/* only the end of the last row moves */
+	__jagged_offsets(j)[j->rows]++;
+	return VEC_SUCCESS;
+}
+
+int jagged_row(struct jagged *j, size_t row, struct jagged_span *span)
+{
+	ASSERT_PRECONDITION(j != NULL && span != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(row < j->rows, return VEC_ERANGE);
+
+	size_t *offsets = __jagged_offsets(j);
+	span->size	= offsets[row + 1] - offsets[row];
+	span->data	= span->size ? vector_at(j->objs, offsets[row]) : NULL;
+	return VEC_SUCCESS;
+}
+
+int jagged_get(struct jagged *j, size_t row, size_t idx, void *p)
+{
+	ASSERT_PRECONDITION(j != NULL && p != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(row < j->rows, return VEC_ERANGE);
+
+	size_t *offsets = __jagged_offsets(j);
+	ASSERT_PRECONDITION(idx < offsets[row + 1] - offsets[row], return VEC_ERANGE);
+
+	return vector_get(j->objs, offsets[row] + idx, p);
+}
@@ -0,0 +1,776 @@
+/*
+ * mphf -- Minimal perfect hash functions, PTHash style
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "mphf.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum mphf_consts {
+	/* "RMPH" */
+	MPHF_MAGIC = 0x48504d52,
+
+	MPHF_VERSION = 1,
+
+	/* keys per partition, on average */
+	MPHF_PART_KEYS = 1 << 17,
+
+	/* keys hashed at once by a build thread */
+	MPHF_HASH_CHUNK = 1 << 16,
+
+	/* buckets per key, times the log2 of the number of keys */
+	MPHF_BUCKET_C = 4,
+
+	/* a bucket failing to place its keys with all smaller pilots restarts the build */
+	MPHF_MAX_PILOT = 1 << 24,
+
+	/* seeds tried before giving up on duplicate keys */
+	MPHF_ATTEMPTS = 8,
+
+	/* lookups of a batch interleaved, each with a read in flight */
+	MPHF_BATCH_GROUP = 16,
+
+	MPHF_MAX_THREADS = 64
+};
+
+/* 60% of the keys go to 30% of the buckets */
+static const uint64_t MPHF_DENSE_KEYS = UINT64_C(0x9999999999999999);
+
+static const uint64_t MPHF_PART_SALT   = UINT64_C(0x2545f4914f6cdd1d);
+static const uint64_t MPHF_BUCKET_SALT = UINT64_C(0x94d049bb133111eb);
+static const uint64_t MPHF_POS_SALT    = UINT64_C(0xbf58476d1ce4e5b9);
+static const uint64_t MPHF_PILOT_SALT  = UINT64_C(0x632be59bd9b4e019);
+
+/* layout of a stored hash function, followed by nparts partitions */
+struct mphf_header {
+	uint32_t magic;
+	uint32_t version;
+
+	uint64_t seed;
+	uint64_t keyoff;
+	uint64_t keylen;
+	uint64_t size;
+	uint64_t nparts;
+};
+
+/* layout of a stored partition, followed by its codes, dictionary and free slots */
+struct mphf_part_header {
+	uint64_t offset;
+	uint64_t n;
+	uint64_t tablesz;
+	uint64_t nbuckets;
+	uint64_t ndict;
+	uint64_t width;
+};
+
+struct mphf_part {
+	/* first slot of the partition, and its number of keys */
+	uint64_t offset;
+	uint64_t n;
+
+	/* positions keys are hashed to, slightly more than n */
+	uint64_t tablesz;
+
+	uint64_t nbuckets;
+
+	/* distinct pilots, indexed by code */
+	uint32_t *dict;
+	uint64_t ndict;
+
+	/* code of the pilot of each bucket, width bits each */
+	uint64_t *codes;
+	uint64_t width;
+
+	/* slot for each position past n, the positions below n left free */
+	uint32_t *free;
+};
+
+struct mphf {
+	uint64_t seed;
+	size_t keyoff;
+	size_t keylen;
+	size_t size;
+
+	struct mphf_part *parts;
+	size_t nparts;
+};
+
+/* state shared by the build threads */
+struct mphf_build {
+	struct mphf *h;
+
+	const char *data;
+	size_t objsz;
+
+	/* hash of each key, then grouped by partition */
+	uint64_t *hashes;
+	uint64_t *grouped;
+
+	/* first hash of each partition in grouped, nparts + 1 entries */
+	size_t *starts;
+
+	/* next chunk or partition to pick */
+	_Atomic size_t next;
+
+	/* first error of a thread */
+	_Atomic int res;
+};
+
+static inline uint64_t __mphf_mix(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= UINT64_C(0xbf58476d1ce4e5b9);
+	x ^= x >> 27;
+	x *= UINT64_C(0x94d049bb133111eb);
+	return x ^ (x >> 31);
+}
+
+static uint64_t __mphf_hash(const char *p, size_t n, uint64_t seed)
+{
+	uint64_t h = seed ^ (n * UINT64_C(0x9e3779b97f4a7c15));
+	for (; n >= 8; p += 8, n -= 8) {
+		uint64_t w;
+		memcpy(&w, p, 8);
+		h = __mphf_mix(h ^ w);
+	}
+	if (n) {
+		uint64_t w = 0;
+		memcpy(&w, p, n);
+		h = __mphf_mix(h ^ w ^ UINT64_C(0xc4ceb9fe1a85ec53));
+	}
+	return __mphf_mix(h);
+}
+
+static inline size_t __mphf_part_of(uint64_t x, size_t nparts)
+{
+	return __mphf_mix(x ^ MPHF_PART_SALT) % nparts;
+}
+
+static inline size_t __mphf_bucket(uint64_t x, size_t nbuckets)
+{
+	size_t dense = nbuckets * 3 / 10 ? nbuckets * 3 / 10 : 1;
+	uint64_t y   = __mphf_mix(x ^ MPHF_BUCKET_SALT);
+	return x < MPHF_DENSE_KEYS ? y % dense : dense + (y % (nbuckets - dense));
+}
+
+static inline uint64_t __mphf_pos_hash(uint64_t x)
+{
+	return __mphf_mix(x ^ MPHF_POS_SALT);
+}
+
+static inline uint64_t __mphf_pilot_hash(uint64_t pilot)
+{
+	return __mphf_mix(pilot ^ MPHF_PILOT_SALT);
+}
+
+static inline uint32_t __mphf_code(const uint64_t *words, size_t width, size_t i)
+{
+	size_t bit = i * width, w = bit / 64, off = bit % 64;
+	uint64_t x = words[w] >> off;
+	if (off + width > 64)
+		x |= words[w + 1] << (64 - off);
+	return x & ((UINT64_C(1) << width) - 1);
+}
+
+static inline void __mphf_put_code(uint64_t *words, size_t width, size_t i, uint64_t code)
+{
+	size_t bit = i * width, w = bit / 64, off = bit % 64;
+	words[w] |= code << off;
+	if (off + width > 64)
+		words[w + 1] |= code >> (64 - off);
+}
+
+static inline size_t __mphf_code_words(size_t nbuckets, size_t width)
+{
+	/* one spare word, codes straddling a word read the next one */
+	return ((nbuckets * width) + 63) / 64 + 1;
+}
+
+/* slot of the key hashed to x, given its partition and bucket */
+static inline size_t __mphf_slot(const struct mphf_part *part, uint64_t x, size_t bucket)
+{
+	uint32_t pilot = part->dict[__mphf_code(part->codes, part->width, bucket)];
+	size_t s       = (__mphf_pos_hash(x) ^ __mphf_pilot_hash(pilot)) % part->tablesz;
+	return part->offset + (s < part->n ? s : part->free[s - part->n]);
+}
+
+/*
+ * Slots of a group of keys. All keys are hashed and the code words of
+ * their buckets prefetched before any is read, so the misses on the codes
+ * of the group overlap.
+ */
+static void __mphf_index_group(struct mphf *h, const char *keys, size_t stride, size_t g, size_t *out)
+{
+	uint64_t x[MPHF_BATCH_GROUP];
+	struct mphf_part *parts[MPHF_BATCH_GROUP];
+	size_t buckets[MPHF_BATCH_GROUP];
+
+	for (size_t i = 0; i < g; i++) {
+		x[i]	   = __mphf_hash(keys + (i * stride), h->keylen, h->seed);
+		parts[i]   = &h->parts[__mphf_part_of(x[i], h->nparts)];
+		buckets[i] = __mphf_bucket(x[i], parts[i]->nbuckets);
+		__builtin_prefetch(parts[i]->codes + ((buckets[i] * parts[i]->width) / 64));
+	}
+	for (size_t i = 0; i < g; i++)
+		out[i] = __mphf_slot(parts[i], x[i], buckets[i]);
+}
+
+static int __mphf_cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void __mphf_free_part(struct mphf_part *part)
+{
+	free(part->dict);
+	free(part->codes);
+	free(part->free);
+}
+
+/* dictionary encode the pilots of the buckets */
+static int __mphf_encode_pilots(struct mphf_part *part, const uint32_t *pilots)
+{
+	size_t m   = part->nbuckets;
+	part->dict = malloc(m * sizeof *part->dict);
+	if (!part->dict)
+		return VEC_ENOMEM;
+
+	memcpy(part->dict, pilots, m * sizeof *part->dict);
+	qsort(part->dict, m, sizeof *part->dict, __mphf_cmp_u32);
+
+	size_t ndict = 1;
+	for (size_t i = 1; i < m; i++) {
+		if (part->dict[i] != part->dict[ndict - 1])
+			part->dict[ndict++] = part->dict[i];
+	}
+	part->ndict = ndict;
+	part->width = ndict > 1 ? 32 - __builtin_clz(ndict - 1) : 1;
+
+	part->codes = calloc(__mphf_code_words(m, part->width), sizeof *part->codes);
+	if (!part->codes)
+		return VEC_ENOMEM;
+
+	for (size_t b = 0; b < m; b++) {
+		const uint32_t *d = bsearch(&pilots[b], part->dict, ndict, sizeof *part->dict, __mphf_cmp_u32);
+		__mphf_put_code(part->codes, part->width, b, d - part->dict);
+	}
+	return VEC_SUCCESS;
+}
+
+/*
+ * Place the n keys of a partition. Returns VEC_EMAXED when a bucket can not
+ * be placed, either by bad luck or because of duplicate keys.
+ */
+static int __mphf_build_part(struct mphf_part *part, const uint64_t *hashes, size_t n)
+{
+	size_t lg     = n > 2 ? 63 - __builtin_clzll(n) : 1;
+	part->n	      = n;
+	part->tablesz = n + ((n + 98) / 99) + (n == 0);
+	part->nbuckets = (MPHF_BUCKET_C * n) / lg > 2 ? (MPHF_BUCKET_C * n) / lg : 2;
+
+	size_t m = part->nbuckets, tablesz = part->tablesz;
+	uint64_t *pos	 = malloc((n ? n : 1) * sizeof *pos);
+	uint32_t *bucket = malloc((n ? n : 1) * sizeof *bucket);
+	size_t *start	 = calloc(m + 1, sizeof *start);
+	size_t *fill	 = malloc(m * sizeof *fill);
+	uint32_t *pilots = calloc(m, sizeof *pilots);
+	uint32_t *order	 = malloc(m * sizeof *order);
+	uint64_t *taken	 = calloc((tablesz + 63) / 64, sizeof *taken);
+	part->free	 = calloc(tablesz - n, sizeof *part->free);
+	size_t *bysize	 = NULL;
+	size_t *slots	 = NULL;
+
+	int res = VEC_ENOMEM;
+	if (!pos || !bucket || !start || !fill || !pilots || !order || !taken || !part->free)
+		goto out;
+
+	/* group the position hashes by bucket */
+	size_t maxsz = 0;
+	for (size_t i = 0; i < n; i++) {
+		bucket[i] = __mphf_bucket(hashes[i], m);
+		start[bucket[i] + 1]++;
+	}
+	for (size_t b = 0; b < m; b++) {
+		maxsz	     = start[b + 1] > maxsz ? start[b + 1] : maxsz;
+		start[b + 1] += start[b];
+		fill[b]	     = start[b];
+	}
+	for (size_t i = 0; i < n; i++)
+		pos[fill[bucket[i]]++] = __mphf_pos_hash(hashes[i]);
+
+	/* largest buckets first */
+	bysize = calloc(maxsz + 2, sizeof *bysize);
+	slots  = malloc((maxsz + 1) * sizeof *slots);
+	if (!bysize || !slots)
+		goto out;
+	for (size_t b = 0; b < m; b++)
+		bysize[maxsz - (start[b + 1] - start[b]) + 1]++;
+	for (size_t s = 0; s <= maxsz; s++)
+		bysize[s + 1] += bysize[s];
+	for (size_t b = 0; b < m; b++)
+		order[bysize[maxsz - (start[b + 1] - start[b])]++] = b;
+
+	res = VEC_EMAXED;
+	for (size_t j = 0; j < m; j++) {
+		size_t b = order[j], k = start[b + 1] - start[b];
+		if (k == 0)
+			break;
+
+		/* equal hashes never land on distinct slots */
+		const uint64_t *hp = pos + start[b];
+		for (size_t i = 1; i < k; i++) {
+			for (size_t l = 0; l < i; l++) {
+				if (hp[i] == hp[l])
+					goto out;
+			}
+		}
+
+		uint32_t p;
+		for (p = 0; p < MPHF_MAX_PILOT; p++) {
+			uint64_t ph = __mphf_pilot_hash(p);
+			size_t i;
+			for (i = 0; i < k; i++) {
+				size_t s = (hp[i] ^ ph) % tablesz;
+				if (taken[s / 64] & (UINT64_C(1) << (s % 64)))
+					break;
+				taken[s / 64] |= UINT64_C(1) << (s % 64);
+				slots[i] = s;
+			}
+			if (i == k)
+				break;
+			while (i--)
+				taken[slots[i] / 64] &= ~(UINT64_C(1) << (slots[i] % 64));
+		}
+		if (p == MPHF_MAX_PILOT)
+			goto out;
+		pilots[b] = p;
+	}
+
+	/* positions past n take the free slots below n */
+	size_t cur = 0;
+	for (size_t s = n; s < tablesz; s++) {
+		if (!(taken[s / 64] & (UINT64_C(1) << (s % 64))))
+			continue;
+		while (taken[cur / 64] & (UINT64_C(1) << (cur % 64)))
+			cur++;
+		part->free[s - n] = cur++;
+	}
+
+	res = __mphf_encode_pilots(part, pilots);
+
+out:
+	free(pos);
+	free(bucket);
+	free(start);
+	free(fill);
+	free(pilots);
+	free(order);
+	free(taken);
+	free(bysize);
+	free(slots);
+	return res;
+}
+
+static void *__mphf_hash_worker(void *arg)
+{
+	struct mphf_build *b = arg;
+	struct mphf *h	     = b->h;
+
+	size_t chunk;
+	while ((chunk = atomic_fetch_add(&b->next, 1)) * MPHF_HASH_CHUNK < h->size) {
+		size_t end = (chunk + 1) * MPHF_HASH_CHUNK < h->size ? (chunk + 1) * MPHF_HASH_CHUNK : h->size;
+		for (size_t i = chunk * MPHF_HASH_CHUNK; i < end; i++)
+			b->hashes[i] = __mphf_hash(b->data + (i * b->objsz) + h->keyoff, h->keylen, h->seed);
+	}
+	return NULL;
+}
+
+static void *__mphf_part_worker(void *arg)
+{
+	struct mphf_build *b = arg;
+	struct mphf *h	     = b->h;
+
+	size_t i;
+	while ((i = atomic_fetch_add(&b->next, 1)) < h->nparts && atomic_load(&b->res) == VEC_SUCCESS) {
+		h->parts[i].offset = b->starts[i];
+		int res = __mphf_build_part(&h->parts[i], b->grouped + b->starts[i], b->starts[i + 1] - b->starts[i]);
+		if (res != VEC_SUCCESS) {
+			int ok = VEC_SUCCESS;
+			atomic_compare_exchange_strong(&b->res, &ok, res);
+		}
+	}
+	return NULL;
+}
+
+/* run fn on nthreads threads, the calling thread being one of them */
+static void __mphf_parallel(size_t nthreads, void *(*fn)(void *), struct mphf_build *b)
+{
+	pthread_t threads[nthreads];
+	bool spawned[nthreads];
+
+	atomic_store(&b->next, 0);
+	for (size_t t = 0; t + 1 < nthreads; t++)
+		spawned[t] = pthread_create(&threads[t], NULL, fn, b) == 0;
+	fn(b);
+	for (size_t t = 0; t + 1 < nthreads; t++) {
+		if (spawned[t])
+			pthread_join(threads[t], NULL);
+	}
+}
+
+static int __mphf_build_seeded(struct mphf_build *b, size_t nthreads)
+{
+	struct mphf *h = b->h;
+
+	__mphf_parallel(nthreads, __mphf_hash_worker, b);
+
+	memset(b->starts, 0, (h->nparts + 1) * sizeof *b->starts);
+	for (size_t i = 0; i < h->size; i++)
+		b->starts[__mphf_part_of(b->hashes[i], h->nparts) + 1]++;
+	for (size_t p = 0; p < h->nparts; p++)
+		b->starts[p + 1] += b->starts[p];
+
+	size_t *fill = malloc(h->nparts * sizeof *fill);
+	if (!fill)
+		return VEC_ENOMEM;
+	memcpy(fill, b->starts, h->nparts * sizeof *fill);
+	for (size_t i = 0; i < h->size; i++)
+		b->grouped[fill[__mphf_part_of(b->hashes[i], h->nparts)]++] = b->hashes[i];
+	free(fill);
+
+	atomic_store(&b->res, VEC_SUCCESS);
+	__mphf_parallel(nthreads, __mphf_part_worker, b);
+	return atomic_load(&b->res);
+}
+
+int mphf_build(struct mphf **hp, struct vector *v, size_t keyoff, size_t keylen, size_t nthreads)
+{
+	ASSERT_PRECONDITION(hp != NULL && v != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(!vector_is_mutable(v) && !vector_is_indirect(v), return VEC_EINVAL);
+	ASSERT_PRECONDITION(keylen > 0 && keyoff + keylen <= vector_object_size(v), return VEC_EINVAL);
+
+	if (nthreads == 0) {
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads    = online > 0 ? online : 1;
+	}
+	nthreads = nthreads < MPHF_MAX_THREADS ? nthreads : MPHF_MAX_THREADS;
+
+	struct mphf *h = calloc(1, sizeof *h);
+	if (!h)
+		return VEC_ENOMEM;
+	h->keyoff = keyoff;
+	h->keylen = keylen;
+	h->size	  = vector_size(v);
+	h->nparts = (h->size + MPHF_PART_KEYS - 1) / MPHF_PART_KEYS;
+
+	struct mphf_build b = {
+		.h	 = h,
+		.data	 = vector_data(v),
+		.objsz	 = vector_object_size(v),
+		.hashes	 = malloc((h->size ? h->size : 1) * sizeof *b.hashes),
+		.grouped = malloc((h->size ? h->size : 1) * sizeof *b.grouped),
+		.starts	 = malloc((h->nparts + 1) * sizeof *b.starts),
+	};
+
+	int res = VEC_ENOMEM;
+	if (b.hashes && b.grouped && b.starts) {
+		res = VEC_EMAXED;
+		for (int attempt = 0; attempt < MPHF_ATTEMPTS && res == VEC_EMAXED; attempt++) {
+			for (size_t p = 0; p < h->nparts && h->parts; p++)
+				__mphf_free_part(&h->parts[p]);
+			free(h->parts);
+
+			h->seed	 = __mphf_mix(UINT64_C(0x9e3779b97f4a7c15) * (attempt + 1));
+			h->parts = calloc(h->nparts ? h->nparts : 1, sizeof *h->parts);
+			res	 = h->parts ? __mphf_build_seeded(&b, nthreads) : VEC_ENOMEM;
+		}
+	}
+
+	free(b.hashes);
+	free(b.grouped);
+	free(b.starts);
+
+	if (res != VEC_SUCCESS) {
+		mphf_free(&h);
+		return res == VEC_EMAXED ? VEC_EINVAL : res;
+	}
+
+	*hp = h;
+	return VEC_SUCCESS;
+}
+
+void mphf_free(struct mphf **hp)
+{
+	ASSERT_PRECONDITION(hp && *hp, return );
+
+	struct mphf *h = *hp;
+	for (size_t p = 0; p < h->nparts && h->parts; p++)
+		__mphf_free_part(&h->parts[p]);
+	free(h->parts);
+	free(h);
+
+	*hp = NULL;
+}
+
+size_t mphf_size(struct mphf *h)
+{
+	ASSERT_PRECONDITION(h != NULL, return 0);
+	return h->size;
+}
+
+size_t mphf_bits(struct mphf *h)
+{
+	ASSERT_PRECONDITION(h != NULL, return 0);
+
+	size_t bits = sizeof *h * 8;
+	for (size_t p = 0; p < h->nparts; p++) {
+		struct mphf_part *part = &h->parts[p];
+		bits += sizeof *part * 8;
+		bits += __mphf_code_words(part->nbuckets, part->width) * 64;
+		bits += part->ndict * 32;
+		bits += (part->tablesz - part->n) * 32;
+	}
+	return bits;
+}
+
+size_t mphf_index(struct mphf *h, const void *key)
+{
+	ASSERT_PRECONDITION(h != NULL && key != NULL && h->nparts > 0, return 0);
+
+	uint64_t x	       = __mphf_hash(key, h->keylen, h->seed);
+	struct mphf_part *part = &h->parts[__mphf_part_of(x, h->nparts)];
+	return __mphf_slot(part, x, __mphf_bucket(x, part->nbuckets));
+}
+
+int mphf_index_batch(struct mphf *h, const void *keys, size_t stride, size_t k, size_t *out)
+{
+	ASSERT_PRECONDITION(h != NULL && h->nparts > 0, return VEC_EINVAL);
+	ASSERT_PRECONDITION(k == 0 || (keys != NULL && out != NULL), return VEC_EINVAL);
+
+	for (size_t i = 0; i < k; i += MPHF_BATCH_GROUP) {
+		size_t g = k - i < MPHF_BATCH_GROUP ? k - i : MPHF_BATCH_GROUP;
+		__mphf_index_group(h, (const char *)keys + (i * stride), stride, g, out + i);
+	}
+	return VEC_SUCCESS;
+}
+
+int mphf_arrange(struct mphf *h, struct vector *v, struct vector **out)
+{
+	ASSERT_PRECONDITION(h != NULL && v != NULL && out != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_size(v) == h->size && !vector_is_indirect(v), return VEC_EINVAL);
+	ASSERT_PRECONDITION(h->keyoff + h->keylen <= vector_object_size(v), return VEC_EINVAL);
+
+	size_t objsz	   = vector_object_size(v);
+	struct vector *new = vector_new(h->size ? h->size : 1, objsz);
+	if (!new)
+		return VEC_ENOMEM;
+
+	int res = vector_resize(new, h->size);
+	if (res != VEC_SUCCESS) {
+		vector_free(&new, NULL);
+		return res;
+	}
+
+	const char *src = vector_data(v);
+	char *dst	= vector_data(new);
+	for (size_t i = 0; i < h->size; i++) {
+		const char *obj = src + (i * objsz);
+		memcpy(dst + (mphf_index(h, obj + h->keyoff) * objsz), obj, objsz);
+	}
+
+	vector_make_immutable(new);
+	*out = new;
+	return VEC_SUCCESS;
+}
+
+int mphf_get(struct mphf *h, struct vector *v, const void *key, void *p)
+{
+	ASSERT_PRECONDITION(h != NULL && v != NULL && key != NULL && p != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(!vector_is_indirect(v), return VEC_EINVAL);
+	ASSERT_PRECONDITION(h->keyoff + h->keylen <= vector_object_size(v), return VEC_EINVAL);
+
+	size_t idx = mphf_index(h, key);
+	ASSERT_PRECONDITION(idx < vector_size(v), return VEC_ERANGE);
+
+	const char *obj = (const char *)vector_data(v) + (idx * vector_object_size(v));
+	ASSERT_PRECONDITION(memcmp(obj + h->keyoff, key, h->keylen) == 0, return VEC_ERANGE);
+
+	memcpy(p, obj, vector_object_size(v));
+	return VEC_SUCCESS;
+}
+
+int mphf_get_batch(struct mphf *h, struct vector *v, const void *keys, size_t stride, size_t k,
+		   void *p, bool *found)
+{
+	ASSERT_PRECONDITION(h != NULL && v != NULL && h->nparts > 0, return VEC_EINVAL);
+	ASSERT_PRECONDITION(k == 0 || (keys != NULL && p != NULL), return VEC_EINVAL);
+	ASSERT_PRECONDITION(!vector_is_indirect(v), return VEC_EINVAL);
+	ASSERT_PRECONDITION(h->keyoff + h->keylen <= vector_object_size(v), return VEC_EINVAL);
+
+	size_t objsz	 = vector_object_size(v);
+	size_t size	 = vector_size(v);
+	const char *data = vector_data(v);
+
+	for (size_t i = 0; i < k; i += MPHF_BATCH_GROUP) {
+		size_t g	= k - i < MPHF_BATCH_GROUP ? k - i : MPHF_BATCH_GROUP;
+		const char *key = (const char *)keys + (i * stride);
+		size_t slots[MPHF_BATCH_GROUP];
+
+		/* the objects of the group are fetched together too */
+		__mphf_index_group(h, key, stride, g, slots);
+		for (size_t j = 0; j < g; j++) {
+			if (slots[j] < size)
+				__builtin_prefetch(data + (slots[j] * objsz));
+		}
+
+		for (size_t j = 0; j < g; j++) {
+			const char *obj = data + (slots[j] * objsz);
+			char *dst	= (char *)p + ((i + j) * objsz);
+			bool hit	= slots[j] < size
+				   && memcmp(obj + h->keyoff, key + (j * stride), h->keylen) == 0;
+			if (hit)
+				memcpy(dst, obj, objsz);
+			else
+				memset(dst, 0, objsz);
+			if (found)
+				found[i + j] = hit;
+		}
+	}
+	return VEC_SUCCESS;
+}
+
+int mphf_write(struct mphf *h, FILE *out)
+{
+	ASSERT_PRECONDITION(h != NULL && out != NULL, return CKPT_EINVAL);
+
+	struct mphf_header hdr = {
+		.magic	 = MPHF_MAGIC,
+		.version = MPHF_VERSION,
+		.seed	 = h->seed,
+		.keyoff	 = h->keyoff,
+		.keylen	 = h->keylen,
+		.size	 = h->size,
+		.nparts	 = h->nparts,
+	};
+	if (fwrite(&hdr, sizeof hdr, 1, out) != 1)
+		return CKPT_EIO;
+
+	for (size_t p = 0; p < h->nparts; p++) {
+		struct mphf_part *part	    = &h->parts[p];
+		struct mphf_part_header ph = {
+			part->offset, part->n, part->tablesz, part->nbuckets, part->ndict, part->width,
+		};
+		size_t nwords = __mphf_code_words(part->nbuckets, part->width);
+		size_t nfree  = part->tablesz - part->n;
+
+		if (fwrite(&ph, sizeof ph, 1, out) != 1
+		    || fwrite(part->codes, sizeof *part->codes, nwords, out) != nwords
+		    || fwrite(part->dict, sizeof *part->dict, part->ndict, out) != part->ndict
+		    || fwrite(part->free, sizeof *part->free, nfree, out) != nfree)
+			return CKPT_EIO;
+	}
+
+	return fflush(out) == 0 ? CKPT_SUCCESS : CKPT_EIO;
+}
+
+/* read a partition of a function of size keys and check every code and free slot stays in range */
+static int __mphf_read_part(struct mphf_part *part, FILE *in, uint64_t size)
+{
+	struct mphf_part_header ph;
+	if (fread(&ph, sizeof ph, 1, in) != 1)
+		return CKPT_EIO;
+
+	/* bounded by the size first, so that neither the table nor the codes overflow */
+	if (ph.n > size || ph.offset > size - ph.n || ph.n > (UINT64_MAX - 2) / MPHF_BUCKET_C)
+		return CKPT_EFORMAT;
+	if (ph.tablesz < ph.n || ph.tablesz - ph.n > ph.n / 64 + 64 || ph.nbuckets < 2 || ph.nbuckets > ph.n * MPHF_BUCKET_C + 2
+	    || ph.ndict == 0 || ph.ndict > ph.nbuckets || ph.width == 0 || ph.width > 32
+	    || ph.nbuckets > (SIZE_MAX - 63) / ph.width)
+		return CKPT_EFORMAT;
+
+	*part = (struct mphf_part){
+		.offset	  = ph.offset,
+		.n	  = ph.n,
+		.tablesz  = ph.tablesz,
+		.nbuckets = ph.nbuckets,
+		.ndict	  = ph.ndict,
+		.width	  = ph.width,
+	};
+
+	size_t nwords = __mphf_code_words(part->nbuckets, part->width);
+	size_t nfree  = part->tablesz - part->n;
+	part->codes   = malloc(nwords * sizeof *part->codes);
+	part->dict    = malloc(part->ndict * sizeof *part->dict);
+	part->free    = malloc((nfree ? nfree : 1) * sizeof *part->free);
+	if (!part->codes || !part->dict || !part->free)
+		return CKPT_ENOMEM;
+
+	if (fread(part->codes, sizeof *part->codes, nwords, in) != nwords
+	    || fread(part->dict, sizeof *part->dict, part->ndict, in) != part->ndict
+	    || fread(part->free, sizeof *part->free, nfree, in) != nfree)
+		return CKPT_EIO;
+
+	for (size_t b = 0; b < part->nbuckets; b++) {
+		if (__mphf_code(part->codes, part->width, b) >= part->ndict)
+			return CKPT_EFORMAT;
+	}
+	for (size_t i = 0; i < nfree; i++) {
+		if (part->free[i] >= part->n && part->n > 0)
+			return CKPT_EFORMAT;
+	}
+	return CKPT_SUCCESS;
+}
+
+int mphf_read(struct mphf **hp, FILE *in)
+{
+	ASSERT_PRECONDITION(hp != NULL && in != NULL, return CKPT_EINVAL);
+
+	struct mphf_header hdr;
+	if (fread(&hdr, sizeof hdr, 1, in) != 1)
+		return CKPT_EIO;
+	if (hdr.magic != MPHF_MAGIC || hdr.version != MPHF_VERSION || hdr.keylen == 0
+	    || hdr.nparts != hdr.size / MPHF_PART_KEYS + (hdr.size % MPHF_PART_KEYS != 0))
+		return CKPT_EFORMAT;
+
+	struct mphf *h = calloc(1, sizeof *h);
+	if (!h)
+		return CKPT_ENOMEM;
+	h->seed	  = hdr.seed;
+	h->keyoff = hdr.keyoff;
+	h->keylen = hdr.keylen;
+	h->size	  = hdr.size;
+	h->nparts = hdr.nparts;
+	h->parts  = calloc(h->nparts ? h->nparts : 1, sizeof *h->parts);
+
+	int res = h->parts ? CKPT_SUCCESS : CKPT_ENOMEM;
+	for (size_t p = 0; p < h->nparts && res == CKPT_SUCCESS; p++) {
+		res = __mphf_read_part(&h->parts[p], in, h->size);
+
+		/* partitions tile the slots */
+		uint64_t expect = p ? h->parts[p - 1].offset + h->parts[p - 1].n : 0;
+		if (res == CKPT_SUCCESS && h->parts[p].offset != expect)
+			res = CKPT_EFORMAT;
+	}
+	if (res == CKPT_SUCCESS && h->nparts && h->parts[h->nparts - 1].offset + h->parts[h->nparts - 1].n != h->size)
+		res = CKPT_EFORMAT;
+
+	if (res != CKPT_SUCCESS) {
+		mphf_free(&h);
+		return res;
+	}
+
+	*hp = h;
+	return CKPT_SUCCESS;
+}
@@ -0,0 +1,843 @@
+/*
+ * scan -- Predicate scans over vectors of numbers
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SCAN_HAVE_AVX2 1
+#endif
+
+#include "scan.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum scan_consts {
+	/* numbers compared at once, one bit of a mask each */
+	SCAN_BLOCK = 64,
+
+	/* indices collected before they are appended to a selection */
+	SCAN_SEL_BUFFER = 1024
+};
+
+/* a predicate as lo <= x <= hi in the type of x, possibly negated */
+struct scan_bounds {
+	union scan_value lo;
+	union scan_value hi;
+
+	/* no number is within the bounds */
+	bool none;
+
+	/* match the numbers outside the bounds instead */
+	bool negate;
+};
+
+/* matching indices waiting to be appended to a selection */
+struct scan_sel {
+	struct vector *out;
+	size_t n;
+	size_t idx[SCAN_SEL_BUFFER];
+};
+
+/* mask of numbers base .. base + n - 1 within the bounds, n <= SCAN_BLOCK */
+typedef uint64_t (*scan_block_fn)(const void *, size_t, size_t, const struct scan_bounds *);
+
+/* positions of the set bits of each byte, in increasing order */
+static uint8_t __scan_lut[256][8];
+static pthread_once_t __scan_lut_once = PTHREAD_ONCE_INIT;
+
+static void __scan_lut_init(void)
+{
+	for (int byte = 0; byte < 256; byte++) {
+		int n = 0;
+		for (int i = 0; i < 8; i++) {
+			if (byte & (1 << i))
+				__scan_lut[byte][n++] = i;
+		}
+	}
+}
+
+static size_t __scan_width(enum scan_type type)
+{
+	switch (type) {
+	case SCAN_I8:
+	case SCAN_U8:
+		return 1;
+	case SCAN_I16:
+	case SCAN_U16:
+		return 2;
+	case SCAN_I32:
+	case SCAN_U32:
+	case SCAN_F32:
+		return 4;
+	case SCAN_I64:
+	case SCAN_U64:
+	case SCAN_F64:
+		return 8;
+	}
+	return 0;
+}
+
+static bool __scan_is_valid(struct vector *v, enum scan_type type)
+{
+	size_t width = __scan_width(type);
+	return v && width && vector_object_size(v) == width && !vector_is_indirect(v);
+}
+
+static bool __scan_is_sel(struct vector *sel)
+{
+	return sel && vector_object_size(sel) == sizeof(size_t) && !vector_is_indirect(sel);
+}
+
+/* neighbouring floats, x must not be NaN */
+static float __scan_f32_step(float x, bool up)
+{
+	if (x == 0)
+		return up ? 0x1p-149f : -0x1p-149f;
+	if ((up && x == __builtin_inff()) || (!up && x == -__builtin_inff()))
+		return x;
+
+	uint32_t bits;
+	memcpy(&bits, &x, sizeof bits);
+	bits += (x > 0) == up ? 1 : -1;
+	memcpy(&x, &bits, sizeof bits);
+	return x;
+}
+
+static double __scan_f64_step(double x, bool up)
+{
+	if (x == 0)
+		return up ? 0x1p-1074 : -0x1p-1074;
+	if ((up && x == __builtin_inf()) || (!up && x == -__builtin_inf()))
+		return x;
+
+	uint64_t bits;
+	memcpy(&bits, &x, sizeof bits);
+	bits += (x > 0) == up ? 1 : -1;
+	memcpy(&x, &bits, sizeof bits);
+	return x;
+}
+
+/* smallest number of the type not less than c, or greater than c if strict */
+static double __scan_float_above(enum scan_type type, double c, bool strict)
+{
+	if (type == SCAN_F64)
+		return strict ? __scan_f64_step(c, true) : c;
+
+	float f = (float)c;
+	return f > c || (f == c && !strict) ? f : __scan_f32_step(f, true);
+}
+
+/* largest number of the type not greater than c, or less than c if strict */
+static double __scan_float_below(enum scan_type type, double c, bool strict)
+{
+	if (type == SCAN_F64)
+		return strict ? __scan_f64_step(c, false) : c;
+
+	float f = (float)c;
+	return f < c || (f == c && !strict) ? f : __scan_f32_step(f, false);
+}
+
+static void __scan_bounds_float(enum scan_type type, struct scan_pred *p, struct scan_bounds *b)
+{
+	double inf = __builtin_inf();
+	double a = p->a.f, c = p->b.f;
+	double lo = -inf, hi = inf;
+
+	if (a != a || (p->op == SCAN_BETWEEN && c != c)) {
+		b->none = true;
+		return;
+	}
+
+	switch (p->op) {
+	case SCAN_LT:
+		b->none = a == -inf;
+		hi	= __scan_float_below(type, a, true);
+		break;
+	case SCAN_LE:
+		hi = __scan_float_below(type, a, false);
+		break;
+	case SCAN_GT:
+		b->none = a == inf;
+		lo	= __scan_float_above(type, a, true);
+		break;
+	case SCAN_GE:
+		lo = __scan_float_above(type, a, false);
+		break;
+	case SCAN_EQ:
+	case SCAN_NE:
+		lo = __scan_float_above(type, a, false);
+		hi = __scan_float_below(type, a, false);
+		break;
+	case SCAN_BETWEEN:
+		b->none = c == -inf;
+		lo	= __scan_float_above(type, a, false);
+		hi	= __scan_float_below(type, c, true);
+		break;
+	}
+
+	b->none = b->none || lo > hi;
+	b->lo.f = lo;
+	b->hi.f = hi;
+}
+
+static void __scan_bounds_signed(struct scan_pred *p, int64_t tmin, int64_t tmax, struct scan_bounds *b)
+{
+	int64_t a = p->a.i, c = p->b.i;
+	int64_t lo = tmin, hi = tmax;
+
+	switch (p->op) {
+	case SCAN_LT:
+		b->none = a <= tmin;
+		hi	= b->none ? hi : a - 1;
+		break;
+	case SCAN_LE:
+		hi = a;
+		break;
+	case SCAN_GT:
+		b->none = a >= tmax;
+		lo	= b->none ? lo : a + 1;
+		break;
+	case SCAN_GE:
+		lo = a;
+		break;
+	case SCAN_EQ:
+	case SCAN_NE:
+		lo = hi = a;
+		break;
+	case SCAN_BETWEEN:
+		b->none = c <= a;
+		lo	= a;
+		hi	= b->none ? hi : c - 1;
+		break;
+	}
+
+	lo	= lo < tmin ? tmin : lo;
+	hi	= hi > tmax ? tmax : hi;
+	b->none = b->none || lo > hi;
+	b->lo.i = lo;
+	b->hi.i = hi;
+}
+
+static void __scan_bounds_unsigned(struct scan_pred *p, uint64_t tmax, struct scan_bounds *b)
+{
+	uint64_t a = p->a.u, c = p->b.u;
+	uint64_t lo = 0, hi = tmax;
+
+	switch (p->op) {
+	case SCAN_LT:
+		b->none = a == 0;
+		hi	= b->none ? hi : a - 1;
+		break;
+	case SCAN_LE:
+		hi = a;
+		break;
+	case SCAN_GT:
+		b->none = a >= tmax;
+		lo	= b->none ? lo : a + 1;
+		break;
+	case SCAN_GE:
+		lo = a;
+		break;
+	case SCAN_EQ:
+	case SCAN_NE:
+		lo = hi = a;
+		break;
+	case SCAN_BETWEEN:
+		b->none = c <= a;
+		lo	= a;
+		hi	= b->none ? hi : c - 1;
+		break;
+	}
+
+	hi	= hi > tmax ? tmax : hi;
+	b->none = b->none || lo > hi;
+	b->lo.u = lo;
+	b->hi.u = hi;
+}
+
+static bool __scan_bounds(enum scan_type type, struct scan_pred *p, struct scan_bounds *b)
+{
+	ASSERT_PRECONDITION(p->op >= SCAN_LT && p->op <= SCAN_BETWEEN, return false);
+
+	memset(b, 0, sizeof *b);
+	b->negate = p->op == SCAN_NE;
+
+	switch (type) {
+	case SCAN_I8:
+		__scan_bounds_signed(p, INT8_MIN, INT8_MAX, b);
+		break;
+	case SCAN_I16:
+		__scan_bounds_signed(p, INT16_MIN, INT16_MAX, b);
+		break;
+	case SCAN_I32:
+		__scan_bounds_signed(p, INT32_MIN, INT32_MAX, b);
+		break;
+	case SCAN_I64:
+		__scan_bounds_signed(p, INT64_MIN, INT64_MAX, b);
+		break;
+	case SCAN_U8:
+		__scan_bounds_unsigned(p, UINT8_MAX, b);
+		break;
+	case SCAN_U16:
+		__scan_bounds_unsigned(p, UINT16_MAX, b);
+		break;
+	case SCAN_U32:
+		__scan_bounds_unsigned(p, UINT32_MAX, b);
+		break;
+	case SCAN_U64:
+		__scan_bounds_unsigned(p, UINT64_MAX, b);
+		break;
+	case SCAN_F32:
+	case SCAN_F64:
+		__scan_bounds_float(type, p, b);
+		break;
+	}
+	return true;
+}
+
+#define SCAN_BLOCK_SCALAR(name, T, field)                                                        \
+	static uint64_t name(const void *data, size_t base, size_t n, const struct scan_bounds *b) \
+	{                                                                                          \
+		const T *x = (const T *)data + base;                                               \
+		T lo	   = b->lo.field;                                                          \
+		T hi	   = b->hi.field;                                                          \
+		uint64_t m = 0;                                                                    \
+		for (size_t i = 0; i < n; i++)                                                     \
+			m |= (uint64_t)(x[i] >= lo && x[i] <= hi) << i;                            \
+		return m;                                                                          \
+	}
+
+SCAN_BLOCK_SCALAR(__scan_block_i8, int8_t, i)
+SCAN_BLOCK_SCALAR(__scan_block_u8, uint8_t, u)
+SCAN_BLOCK_SCALAR(__scan_block_i16, int16_t, i)
+SCAN_BLOCK_SCALAR(__scan_block_u16, uint16_t, u)
+SCAN_BLOCK_SCALAR(__scan_block_i32, int32_t, i)
+SCAN_BLOCK_SCALAR(__scan_block_u32, uint32_t, u)
+SCAN_BLOCK_SCALAR(__scan_block_i64, int64_t, i)
+SCAN_BLOCK_SCALAR(__scan_block_u64, uint64_t, u)
+SCAN_BLOCK_SCALAR(__scan_block_f32, float, f)
+SCAN_BLOCK_SCALAR(__scan_block_f64, double, f)
+
+static uint64_t __scan_block_none(const void *data, size_t base, size_t n, const struct scan_bounds *b)
+{
+	return 0;
+}
+
+/* indexed by enum scan_type */
+static const scan_block_fn __scan_blocks[] = {
+	__scan_block_i8,  __scan_block_u8,  __scan_block_i16, __scan_block_u16, __scan_block_i32,
+	__scan_block_u32, __scan_block_i64, __scan_block_u64, __scan_block_f32, __scan_block_f64,
+};
+
+static bool __scan_test(const void *data, enum scan_type type, const struct scan_bounds *b, size_t idx)
+{
+	return b->negate ^ (!b->none && __scan_blocks[type](data, idx, 1, b));
+}
+
+#ifdef SCAN_HAVE_AVX2
+/*
+ * Integer kernels compare signed lanes, unsigned numbers are flipped into
+ * signed order by toggling their top bit. Each kernel handles SCAN_BLOCK
+ * numbers.
+ */
+
+__attribute__((target("avx2")))
+static inline __m256i __scan_outside_epi8(__m256i x, __m256i lo, __m256i hi)
+{
+	return _mm256_or_si256(_mm256_cmpgt_epi8(lo, x), _mm256_cmpgt_epi8(x, hi));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i __scan_outside_epi16(__m256i x, __m256i lo, __m256i hi)
+{
+	return _mm256_or_si256(_mm256_cmpgt_epi16(lo, x), _mm256_cmpgt_epi16(x, hi));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i __scan_outside_epi32(__m256i x, __m256i lo, __m256i hi)
+{
+	return _mm256_or_si256(_mm256_cmpgt_epi32(lo, x), _mm256_cmpgt_epi32(x, hi));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i __scan_outside_epi64(__m256i x, __m256i lo, __m256i hi)
+{
+	return _mm256_or_si256(_mm256_cmpgt_epi64(lo, x), _mm256_cmpgt_epi64(x, hi));
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t __scan_block_8_avx2(const void *data, size_t base, const struct scan_bounds *b, uint8_t flip)
+{
+	const __m256i *p = (const __m256i *)((const uint8_t *)data + base);
+	__m256i f	 = _mm256_set1_epi8(flip);
+	__m256i lo	 = _mm256_set1_epi8((uint8_t)b->lo.u ^ flip);
+	__m256i hi	 = _mm256_set1_epi8((uint8_t)b->hi.u ^ flip);
+
+	uint32_t m0 = _mm256_movemask_epi8(__scan_outside_epi8(_mm256_xor_si256(_mm256_loadu_si256(p), f), lo, hi));
+	uint32_t m1 = _mm256_movemask_epi8(__scan_outside_epi8(_mm256_xor_si256(_mm256_loadu_si256(p + 1), f), lo, hi));
+	return ~((uint64_t)m1 << 32 | m0);
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t __scan_block_16_avx2(const void *data, size_t base, const struct scan_bounds *b, uint16_t flip)
+{
+	const __m256i *p = (const __m256i *)((const uint16_t *)data + base);
+	__m256i f	 = _mm256_set1_epi16(flip);
+	__m256i lo	 = _mm256_set1_epi16((uint16_t)b->lo.u ^ flip);
+	__m256i hi	 = _mm256_set1_epi16((uint16_t)b->hi.u ^ flip);
+
+	uint64_t m = 0;
+	for (int k = 0; k < 4; k += 2) {
+		__m256i o0 = __scan_outside_epi16(_mm256_xor_si256(_mm256_loadu_si256(p + k), f), lo, hi);
+		__m256i o1 = __scan_outside_epi16(_mm256_xor_si256(_mm256_loadu_si256(p + k + 1), f), lo, hi);
+
+		/* packing works within 128 bit lanes, put the quarters back in order */
+		__m256i o = _mm256_permute4x64_epi64(_mm256_packs_epi16(o0, o1), 0xd8);
+		m |= (uint64_t)(uint32_t)_mm256_movemask_epi8(o) << (16 * k);
+	}
+	return ~m;
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t __scan_block_32_avx2(const void *data, size_t base, const struct scan_bounds *b, uint32_t flip)
+{
+	const __m256i *p = (const __m256i *)((const uint32_t *)data + base);
+	__m256i f	 = _mm256_set1_epi32(flip);
+	__m256i lo	 = _mm256_set1_epi32((uint32_t)b->lo.u ^ flip);
+	__m256i hi	 = _mm256_set1_epi32((uint32_t)b->hi.u ^ flip);
+
+	uint64_t m = 0;
+	for (int k = 0; k < 8; k++) {
+		__m256i o = __scan_outside_epi32(_mm256_xor_si256(_mm256_loadu_si256(p + k), f), lo, hi);
+		m |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(o)) << (8 * k);
+	}
+	return ~m;
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t __scan_block_64_avx2(const void *data, size_t base, const struct scan_bounds *b, uint64_t flip)
+{
+	const __m256i *p = (const __m256i *)((const uint64_t *)data + base);
+	__m256i f	 = _mm256_set1_epi64x(flip);
+	__m256i lo	 = _mm256_set1_epi64x(b->lo.u ^ flip);
+	__m256i hi	 = _mm256_set1_epi64x(b->hi.u ^ flip);
+
+	uint64_t m = 0;
+	for (int k = 0; k < 16; k++) {
+		__m256i o = __scan_outside_epi64(_mm256_xor_si256(_mm256_loadu_si256(p + k), f), lo, hi);
+		m |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(o)) << (4 * k);
+	}
+	return ~m;
+}
+
+__attribute__((target("avx2")))
+static uint64_t __scan_block_i8_avx2(const void *data, size_t base, size_t n, const struct scan_bounds *b)
+{
+	return __scan_block_8_avx2(data, base, b, 0);
+}
+
+__attribute__((target("avx2")))
+static uint64_t __scan_block_u8_avx2(const void *data, size_t base, size_t n, const struct scan_bounds *b)
+{
+	return __scan_block_8_avx2(data, base, b, UINT8_C(1) << 7);
+}
+
+__attribute__((target("avx2")))
+static uint64_t __scan_block_i16_avx2(const void *data, size_t base, size_t n, const struct scan_bounds *b)
+{
+	return __scan_block_16_avx2(data, base, b, 0);
+}
+
+__attribute__((target("avx2")))
+static uint64_t __scan_block_u16_avx2(const void *data, size_t base, size_t n, const struct scan_bounds *b)
+{
+	return __scan_block_16_avx2(data, base, b, UINT16_C(1) << 15);
+}
+
+__attribute__((target("avx2")))
+static uint64_t __scan_block_i32_avx2(const void *data, size_t base, size_t n, const struct scan_bounds *b)
+{
+	return __scan_block_32_avx2(data, base, b, 0);
+}
+
+__attribute__((target("avx2")))
+static uint64_t __scan_block_u32_avx2(const void *data, size_t base, size_t n, const struct scan_bounds *b)
+{
+	return __scan_block_32_avx2(data, base, b, UINT32_C(1) << 31);
+}
+
+__attribute__((target("avx2")))
+static uint64_t __scan_block_i64_avx2(const void *data, size_t base, size_t n, const struct scan_bounds *b)
+{
+	return __scan_block_64_avx2(data, base, b, 0);
+}
+
+__attribute__((target("avx2")))
+static uint64_t __scan_block_u64_avx2(const void *data, size_t base, size_t n, const struct scan_bounds *b)
+{
+	return __scan_block_64_avx2(data, base, b, UINT64_C(1) << 63);
+}
+
+__attribute__((target("avx2")))
+static uint64_t __scan_block_f32_avx2(const void *data, size_t base, size_t n, const struct scan_bounds *b)
+{
+	const float *p = (const float *)data + base;
+	__m256 lo      = _mm256_set1_ps(b->lo.f);
+	__m256 hi      = _mm256_set1_ps(b->hi.f);
+
+	/* ordered comparisons, NaN is never within the bounds */
+	uint64_t m = 0;
+	for (int k = 0; k < 8; k++) {
+		__m256 x  = _mm256_loadu_ps(p + (8 * k));
+		__m256 in = _mm256_and_ps(_mm256_cmp_ps(x, lo, _CMP_GE_OQ), _mm256_cmp_ps(x, hi, _CMP_LE_OQ));
+		m |= (uint64_t)_mm256_movemask_ps(in) << (8 * k);
+	}
+	return m;
+}
+
+__attribute__((target("avx2")))
+static uint64_t __scan_block_f64_avx2(const void *data, size_t base, size_t n, const struct scan_bounds *b)
+{
+	const double *p = (const double *)data + base;
+	__m256d lo	= _mm256_set1_pd(b->lo.f);
+	__m256d hi	= _mm256_set1_pd(b->hi.f);
+
+	uint64_t m = 0;
+	for (int k = 0; k < 16; k++) {
+		__m256d x  = _mm256_loadu_pd(p + (4 * k));
+		__m256d in = _mm256_and_pd(_mm256_cmp_pd(x, lo, _CMP_GE_OQ), _mm256_cmp_pd(x, hi, _CMP_LE_OQ));
+		m |= (uint64_t)_mm256_movemask_pd(in) << (4 * k);
+	}
+	return m;
+}
+
+static const scan_block_fn __scan_blocks_avx2[] = {
+	__scan_block_i8_avx2,  __scan_block_u8_avx2,  __scan_block_i16_avx2, __scan_block_u16_avx2,
+	__scan_block_i32_avx2, __scan_block_u32_avx2, __scan_block_i64_avx2, __scan_block_u64_avx2,
+	__scan_block_f32_avx2, __scan_block_f64_avx2,
+};
+
+/* widen the positions of each byte of mask to 64 bit indices, 4 at a time */
+__attribute__((target("avx2")))
+static size_t __scan_compress_avx2(size_t *out, size_t base, uint64_t mask)
+{
+	size_t n = 0;
+	for (int k = 0; k < 8; k++, mask >>= 8, base += 8) {
+		uint8_t byte = mask;
+		if (!byte)
+			continue;
+
+		__m128i pos = _mm_loadl_epi64((const __m128i *)__scan_lut[byte]);
+		__m256i b   = _mm256_set1_epi64x(base);
+		_mm256_storeu_si256((__m256i *)(out + n), _mm256_add_epi64(b, _mm256_cvtepu8_epi64(pos)));
+		_mm256_storeu_si256((__m256i *)(out + n + 4),
+				    _mm256_add_epi64(b, _mm256_cvtepu8_epi64(_mm_srli_si128(pos, 4))));
+		n += __builtin_popcount(byte);
+	}
+	return n;
+}
+#endif
+
+/*
+ * Store base + i for the bits i set in mask, and return how many there are.
+ * Each byte writes all 8 slots and keeps its popcount of them, so out needs
+ * room for SCAN_BLOCK indices.
+ */
+static size_t __scan_compress(size_t *out, size_t base, uint64_t mask)
+{
+	size_t n = 0;
+	for (int k = 0; k < 8; k++, mask >>= 8, base += 8) {
+		uint8_t byte = mask;
+		if (!byte)
+			continue;
+
+		for (int i = 0; i < 8; i++)
+			out[n + i] = base + __scan_lut[byte][i];
+		n += __builtin_popcount(byte);
+	}
+	return n;
+}
+
+static scan_block_fn __scan_block_fn(enum scan_type type, const struct scan_bounds *b)
+{
+	if (b->none)
+		return __scan_block_none;
+#ifdef SCAN_HAVE_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		return __scan_blocks_avx2[type];
+#endif
+	return __scan_blocks[type];
+}
+
+static size_t (*__scan_compress_fn(void))(size_t *, size_t, uint64_t)
+{
+	pthread_once(&__scan_lut_once, __scan_lut_init);
+#ifdef SCAN_HAVE_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		return __scan_compress_avx2;
+#endif
+	return __scan_compress;
+}
+
+static int __scan_sel_flush(struct scan_sel *s)
+{
+	if (s->n == 0)
+		return VEC_SUCCESS;
+
+	size_t base = vector_size(s->out);
+	int res	    = vector_resize(s->out, base + s->n);
+	if (res == VEC_SUCCESS)
+		memcpy((size_t *)vector_data(s->out) + base, s->idx, s->n * sizeof(size_t));
+	s->n = 0;
+	return res;
+}
+
+/* mask of the matching numbers base .. base + len - 1 */
+static inline uint64_t __scan_mask(scan_block_fn block, enum scan_type type, const void *data, size_t base,
+				   size_t len, const struct scan_bounds *b)
+{
+	uint64_t valid = len == SCAN_BLOCK ? ~UINT64_C(0) : (UINT64_C(1) << len) - 1;
+	uint64_t m     = len == SCAN_BLOCK ? block(data, base, len, b) : b->none ? 0 : __scan_blocks[type](data, base, len, b);
+	return (b->negate ? ~m : m) & valid;
+}
+
+/* every index of sel below size */
+static bool __scan_sel_in_range(struct vector *sel, size_t size)
+{
+	const size_t *idx = vector_data(sel);
+	size_t n	  = vector_size(sel);
+	for (size_t i = 0; i < n; i++) {
+		if (idx[i] >= size)
+			return false;
+	}
+	return true;
+}
+
+int scan_select(struct vector *v, enum scan_type type, struct scan_pred *pred,
+		struct vector *in, struct vector *sel)
+{
+	ASSERT_PRECONDITION(__scan_is_valid(v, type) && pred != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(__scan_is_sel(sel) && (in == NULL || (__scan_is_sel(in) && in != sel)),
+			    return VEC_EINVAL);
+
+	struct scan_bounds b;
+	ASSERT_PRECONDITION(__scan_bounds(type, pred, &b), return VEC_EINVAL);
+
+	size_t n = vector_size(v);
+	ASSERT_PRECONDITION(in == NULL || __scan_sel_in_range(in, n), return VEC_ERANGE);
+
+	struct scan_sel *s = malloc(sizeof *s);
+	if (!s)
+		return VEC_ENOMEM;
+	s->out = sel;
+	s->n   = 0;
+
+	const void *data = vector_data(v);
+	int res		 = VEC_SUCCESS;
+
+	if (in) {
+		const size_t *idx = vector_data(in);
+		size_t nin	  = vector_size(in);
+		for (size_t i = 0; i < nin && res == VEC_SUCCESS; i++) {
+			if (s->n == SCAN_SEL_BUFFER)
+				res = __scan_sel_flush(s);
+			if (__scan_test(data, type, &b, idx[i]))
+				s->idx[s->n++] = idx[i];
+		}
+	} else {
+		scan_block_fn block				 = __scan_block_fn(type, &b);
+		size_t (*compress)(size_t *, size_t, uint64_t) = __scan_compress_fn();
+		for (size_t i = 0; i < n && res == VEC_SUCCESS; i += SCAN_BLOCK) {
+			if (s->n > SCAN_SEL_BUFFER - SCAN_BLOCK)
+				res = __scan_sel_flush(s);
+
+			size_t len = n - i < SCAN_BLOCK ? n - i : SCAN_BLOCK;
+			s->n += compress(s->idx + s->n, i, __scan_mask(block, type, data, i, len, &b));
+		}
+	}
+
+	if (res == VEC_SUCCESS)
+		res = __scan_sel_flush(s);
+	free(s);
+	return res;
+}
+
+int scan_bitmap(struct vector *v, enum scan_type type, struct scan_pred *pred, struct vector *bitmap)
+{
+	ASSERT_PRECONDITION(__scan_is_valid(v, type) && pred != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(__scan_is_valid(bitmap, SCAN_U64), return VEC_EINVAL);
+
+	struct scan_bounds b;
+	ASSERT_PRECONDITION(__scan_bounds(type, pred, &b), return VEC_EINVAL);
+
+	size_t n = vector_size(v);
+	int res	 = vector_resize(bitmap, (n + SCAN_BLOCK - 1) / SCAN_BLOCK);
+	if (res != VEC_SUCCESS)
+		return res;
+
+	scan_block_fn block = __scan_block_fn(type, &b);
+	const void *data    = vector_data(v);
+	uint64_t *words	    = vector_data(bitmap);
+	for (size_t i = 0; i < n; i += SCAN_BLOCK) {
+		size_t len		= n - i < SCAN_BLOCK ? n - i : SCAN_BLOCK;
+		words[i / SCAN_BLOCK] = __scan_mask(block, type, data, i, len, &b);
+	}
+	return VEC_SUCCESS;
+}
+
+int scan_bitmap_select(struct vector *bitmap, struct vector *sel)
+{
+	ASSERT_PRECONDITION(__scan_is_valid(bitmap, SCAN_U64) && __scan_is_sel(sel), return VEC_EINVAL);
+
+	struct scan_sel *s = malloc(sizeof *s);
+	if (!s)
+		return VEC_ENOMEM;
+	s->out = sel;
+	s->n   = 0;
+
+	size_t (*compress)(size_t *, size_t, uint64_t) = __scan_compress_fn();
+	const uint64_t *words			       = vector_data(bitmap);
+	size_t nwords				       = vector_size(bitmap);
+
+	int res = VEC_SUCCESS;
+	for (size_t w = 0; w < nwords && res == VEC_SUCCESS; w++) {
+		if (s->n > SCAN_SEL_BUFFER - SCAN_BLOCK)
+			res = __scan_sel_flush(s);
+		s->n += compress(s->idx + s->n, w * SCAN_BLOCK, words[w]);
+	}
+
+	if (res == VEC_SUCCESS)
+		res = __scan_sel_flush(s);
+	free(s);
+	return res;
+}
+
+int scan_gather(struct vector *v, struct vector *sel, struct vector *out)
+{
+	ASSERT_PRECONDITION(v != NULL && out != NULL && v != out && __scan_is_sel(sel), return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(v) == vector_object_size(out) && !vector_is_indirect(out),
+			    return VEC_EINVAL);
+	ASSERT_PRECONDITION(__scan_sel_in_range(sel, vector_size(v)), return VEC_ERANGE);
+
+	size_t k    = vector_size(sel);
+	size_t base = vector_size(out);
+	int res	    = vector_resize(out, base + k);
+	if (res != VEC_SUCCESS)
+		return res;
+
+	const size_t *idx = vector_data(sel);
+	size_t objsz	  = vector_object_size(v);
+	char *dst	  = (char *)vector_data(out) + (base * objsz);
+
+	/* indirect objects are not in one array, fetch them one by one */
+	if (vector_is_indirect(v)) {
+		for (size_t i = 0; i < k; i++)
+			vector_get(v, idx[i], dst + (i * objsz));
+		return VEC_SUCCESS;
+	}
+
+	const char *src = vector_data(v);
+	switch (objsz) {
+	case 4:
+		for (size_t i = 0; i < k; i++)
+			((uint32_t *)dst)[i] = ((const uint32_t *)src)[idx[i]];
+		break;
+	case 8:
+		for (size_t i = 0; i < k; i++)
+			((uint64_t *)dst)[i] = ((const uint64_t *)src)[idx[i]];
+		break;
+	default:
+		for (size_t i = 0; i < k; i++)
+			memcpy(dst + (i * objsz), src + (idx[i] * objsz), objsz);
+	}
+	return VEC_SUCCESS;
+}
+
+#define SCAN_AGG(T, field, IDX)                          \
+	do {                                             \
+		const T *x = data;                       \
+		T mn	   = x[IDX(0)];                  \
+		T mx	   = mn;                         \
+		for (size_t i = 0; i < n; i++) {         \
+			T e = x[IDX(i)];                 \
+			SCAN_AGG_ADD_##field(agg->sum, e); \
+			mn = e < mn ? e : mn;            \
+			mx = e > mx ? e : mx;            \
+		}                                        \
+		agg->min.field = mn;                     \
+		agg->max.field = mx;                     \
+	} while (0)
+
+/* integer sums wrap around instead of overflowing */
+#define SCAN_AGG_ADD_i(sum, e) ((sum).u += (uint64_t)(int64_t)(e))
+#define SCAN_AGG_ADD_u(sum, e) ((sum).u += (e))
+#define SCAN_AGG_ADD_f(sum, e) ((sum).f += (e))
+
+#define SCAN_AGG_TYPES(IDX)                            \
+	switch (type) {                                \
+	case SCAN_I8:                                  \
+		SCAN_AGG(int8_t, i, IDX);              \
+		break;                                 \
+	case SCAN_U8:                                  \
+		SCAN_AGG(uint8_t, u, IDX);             \
+		break;                                 \
+	case SCAN_I16:                                 \
+		SCAN_AGG(int16_t, i, IDX);             \
+		break;                                 \
+	case SCAN_U16:                                 \
+		SCAN_AGG(uint16_t, u, IDX);            \
+		break;                                 \
+	case SCAN_I32:                                 \
+		SCAN_AGG(int32_t, i, IDX);             \
+		break;                                 \
+	case SCAN_U32:                                 \
+		SCAN_AGG(uint32_t, u, IDX);            \
+		break;                                 \
+	case SCAN_I64:                                 \
+		SCAN_AGG(int64_t, i, IDX);             \
+		break;                                 \
+	case SCAN_U64:                                 \
+		SCAN_AGG(uint64_t, u, IDX);            \
+		break;                                 \
+	case SCAN_F32:                                 \
+		SCAN_AGG(float, f, IDX);               \
+		break;                                 \
+	case SCAN_F64:                                 \
+		SCAN_AGG(double, f, IDX);              \
+		break;                                 \
+	}
+
+#define SCAN_IDX_ALL(i) (i)
+#define SCAN_IDX_SEL(i) (idx[i])
+
+int scan_aggregate(struct vector *v, enum scan_type type, struct vector *sel, struct scan_agg *agg)
+{
+	ASSERT_PRECONDITION(__scan_is_valid(v, type) && agg != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(sel == NULL || __scan_is_sel(sel), return VEC_EINVAL);
+	ASSERT_PRECONDITION(sel == NULL || __scan_sel_in_range(sel, vector_size(v)), return VEC_ERANGE);
+
+	memset(agg, 0, sizeof *agg);
+
+	size_t n = sel ? vector_size(sel) : vector_size(v);
+	agg->count = n;
+	if (n == 0)
+		return VEC_SUCCESS;
+
+	const void *data = vector_data(v);
+	if (sel) {
+		const size_t *idx = vector_data(sel);
+		SCAN_AGG_TYPES(SCAN_IDX_SEL);
+	} else {
+		SCAN_AGG_TYPES(SCAN_IDX_ALL);
+	}
+	return VEC_SUCCESS;
+}
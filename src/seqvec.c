@@ -0,0 +1,202 @@
+/*
+ * seqvec -- Vectors published under a sequence lock
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "seqvec.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum seq_consts {
+	/* keeps what readers load away from what writers lock */
+	SEQ_CACHE_LINE = 64
+};
+
+struct seqvec {
+	/* odd while a write is in progress, twice the number of publications otherwise */
+	_Alignas(SEQ_CACHE_LINE) _Atomic uint64_t seq;
+
+	/* number of published objects */
+	_Atomic size_t size;
+
+	size_t capacity;
+	size_t objsz;
+
+	/* the objects, as words so that racing copies are atomic accesses */
+	_Atomic uint64_t *words;
+
+	/* serializes writers */
+	_Alignas(SEQ_CACHE_LINE) pthread_mutex_t lock;
+};
+
+static inline size_t __seq_words(size_t bytes)
+{
+	return (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+}
+
+static inline void __seq_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+/*
+ * Copy n bytes out of the words, starting from byte off. The words may be
+ * written meanwhile, the caller checks the sequence number afterwards.
+ */
+static void __seq_copy_out(struct seqvec *s, size_t off, size_t n, char *dst)
+{
+	const _Atomic uint64_t *w = s->words + (off / sizeof(uint64_t));
+	size_t skip		  = off % sizeof(uint64_t);
+
+	if (skip) {
+		uint64_t x  = atomic_load_explicit(w++, memory_order_relaxed);
+		size_t take = sizeof x - skip < n ? sizeof x - skip : n;
+		memcpy(dst, (char *)&x + skip, take);
+		dst += take;
+		n -= take;
+	}
+	for (; n >= sizeof(uint64_t); n -= sizeof(uint64_t), dst += sizeof(uint64_t)) {
+		uint64_t x = atomic_load_explicit(w++, memory_order_relaxed);
+		memcpy(dst, &x, sizeof x);
+	}
+	if (n) {
+		uint64_t x = atomic_load_explicit(w, memory_order_relaxed);
+		memcpy(dst, &x, n);
+	}
+}
+
+/* wait for no write in progress, returning the sequence number */
+static inline uint64_t __seq_read_begin(struct seqvec *s)
+{
+	uint64_t seq;
+	while ((seq = atomic_load_explicit(&s->seq, memory_order_acquire)) & 1)
+		__seq_relax();
+	return seq;
+}
+
+/* whether nothing was written since __seq_read_begin() returned seq */
+static inline bool __seq_read_valid(struct seqvec *s, uint64_t seq)
+{
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&s->seq, memory_order_relaxed) == seq;
+}
+
+struct seqvec *seqvec_new(size_t nobj, size_t objsz)
+{
+	ASSERT_PRECONDITION(objsz > 0 && nobj <= SIZE_MAX / objsz, return NULL);
+
+	struct seqvec *s = aligned_alloc(SEQ_CACHE_LINE, sizeof *s);
+	if (!s)
+		return NULL;
+
+	atomic_init(&s->seq, 0);
+	atomic_init(&s->size, 0);
+	s->capacity = nobj;
+	s->objsz    = objsz;
+	s->words    = calloc(__seq_words(nobj * objsz) + 1, sizeof *s->words);
+	if (!s->words || pthread_mutex_init(&s->lock, NULL) != 0) {
+		free(s->words);
+		free(s);
+		return NULL;
+	}
+	return s;
+}
+
+void seqvec_free(struct seqvec **sp)
+{
+	ASSERT_PRECONDITION(sp && *sp, return );
+
+	struct seqvec *s = *sp;
+	pthread_mutex_destroy(&s->lock);
+	free(s->words);
+	free(s);
+
+	*sp = NULL;
+}
+
+uint64_t seqvec_version(struct seqvec *s)
+{
+	ASSERT_PRECONDITION(s != NULL, return 0);
+	return atomic_load_explicit(&s->seq, memory_order_acquire) / 2;
+}
+
+int seqvec_publish(struct seqvec *s, struct vector *v)
+{
+	ASSERT_PRECONDITION(s != NULL && v != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(v) == s->objsz && !vector_is_indirect(v), return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_size(v) <= s->capacity, return VEC_ERANGE);
+
+	size_t n	= vector_size(v);
+	size_t bytes	= n * s->objsz;
+	const char *src = vector_data(v);
+
+	pthread_mutex_lock(&s->lock);
+
+	/* readers seeing the odd number, or the number changed, retry */
+	uint64_t seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+	atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	for (size_t w = 0; w < __seq_words(bytes); w++) {
+		uint64_t x = 0;
+		size_t off = w * sizeof x;
+		memcpy(&x, src + off, bytes - off < sizeof x ? bytes - off : sizeof x);
+		atomic_store_explicit(&s->words[w], x, memory_order_relaxed);
+	}
+	atomic_store_explicit(&s->size, n, memory_order_relaxed);
+
+	atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+	pthread_mutex_unlock(&s->lock);
+	return VEC_SUCCESS;
+}
+
+int seqvec_read(struct seqvec *s, struct vector *out)
+{
+	ASSERT_PRECONDITION(s != NULL && out != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(out) == s->objsz && !vector_is_indirect(out), return VEC_EINVAL);
+
+	for (;;) {
+		uint64_t seq = __seq_read_begin(s);
+		size_t n     = atomic_load_explicit(&s->size, memory_order_relaxed);
+
+		/* a torn size is caught by the check below, but must not overflow the copy */
+		if (n > s->capacity)
+			continue;
+		if (n != vector_size(out)) {
+			int res = vector_resize(out, n);
+			if (res != VEC_SUCCESS)
+				return res;
+		}
+
+		if (n > 0)
+			__seq_copy_out(s, 0, n * s->objsz, vector_data(out));
+		if (__seq_read_valid(s, seq))
+			return VEC_SUCCESS;
+	}
+}
+
+int seqvec_get(struct seqvec *s, size_t idx, void *p)
+{
+	ASSERT_PRECONDITION(s != NULL && p != NULL, return VEC_EINVAL);
+
+	for (;;) {
+		uint64_t seq = __seq_read_begin(s);
+		size_t n     = atomic_load_explicit(&s->size, memory_order_relaxed);
+
+		if (idx < n && idx < s->capacity)
+			__seq_copy_out(s, idx * s->objsz, s->objsz, p);
+		if (__seq_read_valid(s, seq))
+			return idx < n ? VEC_SUCCESS : VEC_ERANGE;
+	}
+}
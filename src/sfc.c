@@ -0,0 +1,145 @@
+/*
+ * sfc -- Morton and Hilbert orders of points
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sfc.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum sfc_consts {
+	/* bits per axis of the grid */
+	SFC_BITS_2D = 32,
+	SFC_BITS_3D = 21
+};
+
+/* the curve and coordinates of a reordering, handed to the radix sort */
+struct sfc_sort {
+	enum sfc_curve curve;
+	unsigned dims;
+	void (*coords)(void *, void *, uint32_t *);
+	void *arg;
+};
+
+/* spread the bits of x to the even bits */
+static inline uint64_t __sfc_spread2(uint32_t x)
+{
+	uint64_t y = x;
+	y	   = (y | (y << 16)) & UINT64_C(0x0000ffff0000ffff);
+	y	   = (y | (y << 8)) & UINT64_C(0x00ff00ff00ff00ff);
+	y	   = (y | (y << 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+	y	   = (y | (y << 2)) & UINT64_C(0x3333333333333333);
+	y	   = (y | (y << 1)) & UINT64_C(0x5555555555555555);
+	return y;
+}
+
+/* spread the low 21 bits of x to every third bit */
+static inline uint64_t __sfc_spread3(uint32_t x)
+{
+	uint64_t y = x & 0x1fffff;
+	y	   = (y | (y << 32)) & UINT64_C(0x001f00000000ffff);
+	y	   = (y | (y << 16)) & UINT64_C(0x001f0000ff0000ff);
+	y	   = (y | (y << 8)) & UINT64_C(0x100f00f00f00f00f);
+	y	   = (y | (y << 4)) & UINT64_C(0x10c30c30c30c30c3);
+	y	   = (y | (y << 2)) & UINT64_C(0x1249249249249249);
+	return y;
+}
+
+/*
+ * Hilbert key of a point of n coordinates of b bits each, by Skilling's
+ * transform: undo the rotations and reflections of each level, Gray encode,
+ * then interleave the bits from the top.
+ */
+static uint64_t __sfc_hilbert(uint32_t *x, unsigned n, unsigned b)
+{
+	uint32_t m = UINT32_C(1) << (b - 1);
+
+	for (uint32_t q = m; q > 1; q >>= 1) {
+		uint32_t p = q - 1;
+		for (unsigned i = 0; i < n; i++) {
+			if (x[i] & q) {
+				x[0] ^= p;
+			} else {
+				uint32_t t = (x[0] ^ x[i]) & p;
+				x[0] ^= t;
+				x[i] ^= t;
+			}
+		}
+	}
+
+	for (unsigned i = 1; i < n; i++)
+		x[i] ^= x[i - 1];
+	uint32_t t = 0;
+	for (uint32_t q = m; q > 1; q >>= 1) {
+		if (x[n - 1] & q)
+			t ^= q - 1;
+	}
+	for (unsigned i = 0; i < n; i++)
+		x[i] ^= t;
+
+	uint64_t key = 0;
+	for (unsigned j = b; j-- > 0;) {
+		for (unsigned i = 0; i < n; i++)
+			key = (key << 1) | ((x[i] >> j) & 1);
+	}
+	return key;
+}
+
+static uint64_t __sfc_key(void *p, void *arg)
+{
+	struct sfc_sort *s = arg;
+	uint32_t c[3]	   = { 0, 0, 0 };
+	s->coords(p, s->arg, c);
+
+	if (s->curve == SFC_HILBERT)
+		return s->dims == 2 ? sfc_hilbert2(c[0], c[1]) : sfc_hilbert3(c[0], c[1], c[2]);
+	return s->dims == 2 ? sfc_morton2(c[0], c[1]) : sfc_morton3(c[0], c[1], c[2]);
+}
+
+uint64_t sfc_morton2(uint32_t x, uint32_t y)
+{
+	return __sfc_spread2(x) | (__sfc_spread2(y) << 1);
+}
+
+uint64_t sfc_morton3(uint32_t x, uint32_t y, uint32_t z)
+{
+	return __sfc_spread3(x) | (__sfc_spread3(y) << 1) | (__sfc_spread3(z) << 2);
+}
+
+uint64_t sfc_hilbert2(uint32_t x, uint32_t y)
+{
+	uint32_t c[2] = { x, y };
+	return __sfc_hilbert(c, 2, SFC_BITS_2D);
+}
+
+uint64_t sfc_hilbert3(uint32_t x, uint32_t y, uint32_t z)
+{
+	uint32_t c[3] = { x & 0x1fffff, y & 0x1fffff, z & 0x1fffff };
+	return __sfc_hilbert(c, 3, SFC_BITS_3D);
+}
+
+uint32_t sfc_quantize(double x, double lo, double hi, unsigned dims)
+{
+	double top = dims == 3 ? (double)((UINT32_C(1) << SFC_BITS_3D) - 1) : (double)UINT32_MAX;
+	if (!(hi > lo) || !(x > lo))
+		return 0;
+	if (x >= hi)
+		return top;
+	return (uint32_t)((x - lo) / (hi - lo) * top);
+}
+
+int sfc_reorder(struct vector *v, enum sfc_curve curve, unsigned dims,
+		void (*coords)(void *, void *, uint32_t *), void *arg, struct vector *perm)
+{
+	ASSERT_PRECONDITION(coords != NULL && (dims == 2 || dims == 3), return VEC_EINVAL);
+	ASSERT_PRECONDITION(curve == SFC_MORTON || curve == SFC_HILBERT, return VEC_EINVAL);
+
+	struct sfc_sort s = { curve, dims, coords, arg };
+	return vector_radix_sort(v, __sfc_key, &s, perm);
+}
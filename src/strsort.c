@@ -0,0 +1,293 @@
+/*
+ * strsort -- Multikey quicksort of strings with cached prefixes
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "strsort.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum str_consts {
+	/* ranges this short are insertion sorted */
+	STR_INSERTION = 16,
+
+	/* smallest column split into buckets sorted in parallel */
+	STR_PARALLEL_MIN = 1 << 15,
+
+	/* buckets of the parallel step, one per leading two bytes */
+	STR_BUCKETS = 1 << 16,
+
+	STR_MAX_THREADS = 64
+};
+
+struct str_item {
+	/* bytes [depth, depth + 8) of the string, big endian and zero padded */
+	uint64_t key;
+
+	const unsigned char *s;
+	size_t len;
+
+	/* position of the string before sorting */
+	size_t idx;
+};
+
+/* state shared by the threads sorting buckets */
+struct str_buckets {
+	struct str_item *items;
+
+	/* first item of each bucket, STR_BUCKETS + 1 entries */
+	size_t *starts;
+
+	/* next bucket to pick */
+	_Atomic size_t next;
+};
+
+static inline uint64_t __str_chunk(const unsigned char *s, size_t len, size_t depth)
+{
+	if (depth >= len)
+		return 0;
+
+	uint64_t w = 0;
+	size_t n   = len - depth;
+	if (n >= 8) {
+		memcpy(&w, s + depth, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		w = __builtin_bswap64(w);
+#endif
+		return w;
+	}
+	for (size_t i = 0; i < n; i++)
+		w |= (uint64_t)s[depth + i] << (56 - (8 * i));
+	return w;
+}
+
+static inline void __str_swap(struct str_item *a, size_t i, size_t j)
+{
+	struct str_item t = a[i];
+	a[i]		  = a[j];
+	a[j]		  = t;
+}
+
+/* compare strings equal before depth, whose keys are loaded for depth */
+static int __str_cmp(const struct str_item *a, const struct str_item *b, size_t depth)
+{
+	if (a->key != b->key)
+		return a->key < b->key ? -1 : 1;
+
+	size_t n = a->len < b->len ? a->len : b->len;
+	if (n > depth) {
+		int c = memcmp(a->s + depth, b->s + depth, n - depth);
+		if (c)
+			return c;
+	}
+	return (a->len > b->len) - (a->len < b->len);
+}
+
+static int __str_cmp_len(const void *a, const void *b)
+{
+	size_t x = ((const struct str_item *)a)->len, y = ((const struct str_item *)b)->len;
+	return (x > y) - (x < y);
+}
+
+static void __str_insertion(struct str_item *a, size_t n, size_t depth)
+{
+	for (size_t i = 1; i < n; i++) {
+		struct str_item x = a[i];
+		size_t j	  = i;
+		for (; j > 0 && __str_cmp(&x, &a[j - 1], depth) < 0; j--)
+			a[j] = a[j - 1];
+		a[j] = x;
+	}
+}
+
+static inline uint64_t __str_median(uint64_t x, uint64_t y, uint64_t z)
+{
+	if (x < y)
+		return y < z ? y : x < z ? z : x;
+	return x < z ? x : y < z ? z : y;
+}
+
+/*
+ * Multikey quicksort of strings equal before depth, 8 bytes at a time.
+ * Partitioning compares the cached keys only; the strings are read again
+ * just to load the next keys of the equal range.
+ */
+static void __str_mkqs(struct str_item *a, size_t n, size_t depth)
+{
+	while (n > STR_INSERTION) {
+		uint64_t p = __str_median(a[0].key, a[n / 2].key, a[n - 1].key);
+
+		/* [0, lt) below the pivot, [lt, gt) equal, [gt, n) above */
+		size_t lt = 0, i = 0, gt = n;
+		while (i < gt) {
+			if (a[i].key < p)
+				__str_swap(a, lt++, i++);
+			else if (a[i].key > p)
+				__str_swap(a, i, --gt);
+			else
+				i++;
+		}
+		__str_mkqs(a, lt, depth);
+		__str_mkqs(a + gt, n - gt, depth);
+
+		/* strings ending within these 8 bytes go first, shorter ones before */
+		a += lt;
+		n	     = gt - lt;
+		size_t ended = 0;
+		for (i = 0; i < n; i++) {
+			if (a[i].len <= depth + 8)
+				__str_swap(a, ended++, i);
+		}
+		if (ended > 1)
+			qsort(a, ended, sizeof *a, __str_cmp_len);
+
+		a += ended;
+		n -= ended;
+		depth += 8;
+		for (i = 0; i < n; i++)
+			a[i].key = __str_chunk(a[i].s, a[i].len, depth);
+	}
+
+	__str_insertion(a, n, depth);
+}
+
+static void *__str_bucket_worker(void *arg)
+{
+	struct str_buckets *b = arg;
+
+	size_t k;
+	while ((k = atomic_fetch_add(&b->next, 1)) < STR_BUCKETS)
+		__str_mkqs(b->items + b->starts[k], b->starts[k + 1] - b->starts[k], 0);
+	return NULL;
+}
+
+/*
+ * Sort n strings. Large columns are first distributed by their leading two
+ * bytes, and the buckets are sorted by nthreads threads.
+ */
+static int __str_sort(struct str_item *a, size_t n, size_t nthreads)
+{
+	if (nthreads == 0) {
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads    = online > 0 ? online : 1;
+	}
+	nthreads = nthreads < STR_MAX_THREADS ? nthreads : STR_MAX_THREADS;
+
+	if (n < STR_PARALLEL_MIN || nthreads == 1) {
+		__str_mkqs(a, n, 0);
+		return VEC_SUCCESS;
+	}
+
+	struct str_buckets b = {
+		.items	= malloc(n * sizeof *b.items),
+		.starts = calloc(STR_BUCKETS + 1, sizeof *b.starts),
+	};
+	size_t *fill = malloc(STR_BUCKETS * sizeof *fill);
+	if (!b.items || !b.starts || !fill) {
+		free(b.items);
+		free(b.starts);
+		free(fill);
+		return VEC_ENOMEM;
+	}
+
+	for (size_t i = 0; i < n; i++)
+		b.starts[(a[i].key >> 48) + 1]++;
+	for (size_t k = 0; k < STR_BUCKETS; k++) {
+		b.starts[k + 1] += b.starts[k];
+		fill[k] = b.starts[k];
+	}
+	for (size_t i = 0; i < n; i++)
+		b.items[fill[a[i].key >> 48]++] = a[i];
+	free(fill);
+
+	pthread_t threads[nthreads];
+	bool spawned[nthreads];
+	for (size_t t = 0; t + 1 < nthreads; t++)
+		spawned[t] = pthread_create(&threads[t], NULL, __str_bucket_worker, &b) == 0;
+	__str_bucket_worker(&b);
+	for (size_t t = 0; t + 1 < nthreads; t++) {
+		if (spawned[t])
+			pthread_join(threads[t], NULL);
+	}
+
+	memcpy(a, b.items, n * sizeof *a);
+	free(b.items);
+	free(b.starts);
+	return VEC_SUCCESS;
+}
+
+int strsort_ptrs(struct vector *v, size_t nthreads)
+{
+	ASSERT_PRECONDITION(v != NULL && vector_object_size(v) == sizeof(char *), return VEC_EINVAL);
+	ASSERT_PRECONDITION(!vector_is_indirect(v), return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_is_mutable(v), return VEC_EIMMUT);
+
+	size_t n = vector_size(v);
+	if (n < 2)
+		return VEC_SUCCESS;
+
+	struct str_item *a = malloc(n * sizeof *a);
+	if (!a)
+		return VEC_ENOMEM;
+
+	char **p = vector_data(v);
+	for (size_t i = 0; i < n; i++) {
+		const unsigned char *s = (const unsigned char *)p[i];
+		size_t len	       = s ? strlen((const char *)s) : 0;
+		a[i]		       = (struct str_item){ __str_chunk(s, len, 0), s, len, i };
+	}
+
+	int res = __str_sort(a, n, nthreads);
+	if (res == VEC_SUCCESS) {
+		for (size_t i = 0; i < n; i++)
+			p[i] = (char *)a[i].s;
+	}
+
+	free(a);
+	return res;
+}
+
+int strsort_jagged(struct jagged *j, struct vector *perm, size_t nthreads)
+{
+	ASSERT_PRECONDITION(j != NULL && perm != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(perm) == sizeof(size_t) && !vector_is_indirect(perm),
+			    return VEC_EINVAL);
+
+	size_t n     = jagged_rows(j);
+	size_t objsz = jagged_object_size(j);
+	int res	     = vector_resize(perm, n);
+	if (res != VEC_SUCCESS || n == 0)
+		return res;
+
+	struct str_item *a = malloc(n * sizeof *a);
+	if (!a)
+		return VEC_ENOMEM;
+
+	for (size_t i = 0; i < n; i++) {
+		struct jagged_span span;
+		jagged_row(j, i, &span);
+		const unsigned char *s = span.data;
+		size_t len	       = span.size * objsz;
+		a[i]		       = (struct str_item){ __str_chunk(s, len, 0), s, len, i };
+	}
+
+	res = __str_sort(a, n, nthreads);
+	if (res == VEC_SUCCESS) {
+		size_t *idx = vector_data(perm);
+		for (size_t i = 0; i < n; i++)
+			idx[i] = a[i].idx;
+	}
+
+	free(a);
+	return res;
+}
@@ -0,0 +1,435 @@
+/*
+ * tseries -- Time series compressed with delta of delta and XOR encoding
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "tseries.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum ts_consts {
+	/* no XOR window yet, the next value opens one */
+	TS_NO_WINDOW = 65,
+
+	/* new words a point may take, 68 bits of timestamp and 77 of value at most */
+	TS_POINT_WORDS = 3
+};
+
+/* a run of encoded points, starting at a word boundary */
+struct ts_block {
+	/* first and last timestamp of the block */
+	int64_t first;
+	int64_t last;
+
+	/* number of points */
+	size_t count;
+
+	/* index of the first word of the block */
+	size_t word;
+};
+
+struct tseries {
+	/* descriptors of the blocks */
+	struct vector *blocks;
+
+	/* encoded points of all blocks, most significant bit first */
+	struct vector *words;
+
+	/* number of bits written into words */
+	size_t nbits;
+
+	/* number of points */
+	size_t size;
+
+	/* encoder state: previous point, delta and XOR window */
+	int64_t prev_t;
+	int64_t prev_delta;
+	uint64_t prev_v;
+	unsigned lead;
+	unsigned trail;
+};
+
+/* decoder state, the mirror image of the encoder */
+struct ts_decoder {
+	/* next bit to read */
+	size_t pos;
+
+	/* points left in the block, and whether the next one is the first */
+	size_t left;
+	bool first;
+
+	int64_t t;
+	int64_t delta;
+	uint64_t v;
+	unsigned lead;
+	unsigned trail;
+};
+
+struct tseries_iter {
+	struct tseries *ts;
+
+	/* the time range */
+	int64_t begin;
+	int64_t end;
+
+	/* block being decoded */
+	size_t block;
+	struct ts_decoder d;
+
+	/* the next point, if has is true */
+	bool has;
+	int64_t t;
+	double v;
+};
+
+static inline uint64_t __ts_mask(unsigned n)
+{
+	return n >= 64 ? ~UINT64_C(0) : (UINT64_C(1) << n) - 1;
+}
+
+/* append the n lowest bits of bits */
+static int __ts_put(struct tseries *ts, uint64_t bits, unsigned n)
+{
+	while (n) {
+		unsigned used = ts->nbits % 64;
+		if (used == 0) {
+			uint64_t zero = 0;
+			int res	      = vector_push(ts->words, &zero);
+			if (res != VEC_SUCCESS)
+				return res;
+		}
+
+		unsigned room = 64 - used;
+		unsigned take = n < room ? n : room;
+		uint64_t *w   = vector_at(ts->words, ts->nbits / 64);
+
+		*w |= ((bits >> (n - take)) & __ts_mask(take)) << (room - take);
+		ts->nbits += take;
+		n -= take;
+	}
+	return VEC_SUCCESS;
+}
+
+static uint64_t __ts_get(const uint64_t *words, size_t *pos, unsigned n)
+{
+	uint64_t out = 0;
+	while (n) {
+		unsigned room = 64 - (*pos % 64);
+		unsigned take = n < room ? n : room;
+		uint64_t bits = (words[*pos / 64] >> (room - take)) & __ts_mask(take);
+
+		out = take == 64 ? bits : (out << take) | bits;
+		*pos += take;
+		n -= take;
+	}
+	return out;
+}
+
+static inline uint64_t __ts_bits(double v)
+{
+	uint64_t u;
+	memcpy(&u, &v, sizeof u);
+	return u;
+}
+
+static inline double __ts_double(uint64_t u)
+{
+	double v;
+	memcpy(&v, &u, sizeof v);
+	return v;
+}
+
+static int __ts_put_timestamp(struct tseries *ts, int64_t t)
+{
+	int64_t delta = (int64_t)((uint64_t)t - (uint64_t)ts->prev_t);
+	int64_t dod   = (int64_t)((uint64_t)delta - (uint64_t)ts->prev_delta);
+	ts->prev_t     = t;
+	ts->prev_delta = delta;
+
+	if (dod == 0)
+		return __ts_put(ts, 0x0, 1);
+	if (dod >= -63 && dod <= 64)
+		return __ts_put(ts, (0x2 << 7) | (uint64_t)(dod + 63), 2 + 7);
+	if (dod >= -255 && dod <= 256)
+		return __ts_put(ts, (0x6 << 9) | (uint64_t)(dod + 255), 3 + 9);
+	if (dod >= -2047 && dod <= 2048)
+		return __ts_put(ts, (0xe << 12) | (uint64_t)(dod + 2047), 4 + 12);
+
+	int res = __ts_put(ts, 0xf, 4);
+	return res == VEC_SUCCESS ? __ts_put(ts, (uint64_t)dod, 64) : res;
+}
+
+static int __ts_put_value(struct tseries *ts, double v)
+{
+	uint64_t bits = __ts_bits(v);
+	uint64_t x    = bits ^ ts->prev_v;
+	ts->prev_v    = bits;
+
+	if (x == 0)
+		return __ts_put(ts, 0x0, 1);
+
+	unsigned lead  = __builtin_clzll(x);
+	unsigned trail = __builtin_ctzll(x);
+	if (lead > 31)
+		lead = 31;
+
+	/* the meaningful bits fit in the previous window */
+	if (ts->lead != TS_NO_WINDOW && lead >= ts->lead && trail >= ts->trail) {
+		int res = __ts_put(ts, 0x2, 2);
+		return res == VEC_SUCCESS ? __ts_put(ts, x >> ts->trail, 64 - ts->lead - ts->trail) : res;
+	}
+
+	unsigned len = 64 - lead - trail;
+	ts->lead     = lead;
+	ts->trail    = trail;
+
+	int res = __ts_put(ts, (0x3 << 11) | (lead << 6) | (len - 1), 2 + 5 + 6);
+	return res == VEC_SUCCESS ? __ts_put(ts, x >> trail, len) : res;
+}
+
+static void __ts_decoder_start(struct ts_decoder *d, const struct ts_block *b)
+{
+	d->pos	 = b->word * 64;
+	d->left	 = b->count;
+	d->first = true;
+}
+
+/* decode the next point of the block, d->left must not be 0 */
+static void __ts_decode(struct ts_decoder *d, const uint64_t *words, int64_t *t, double *v)
+{
+	if (d->first) {
+		d->t	 = (int64_t)__ts_get(words, &d->pos, 64);
+		d->v	 = __ts_get(words, &d->pos, 64);
+		d->delta = 0;
+		d->lead	 = TS_NO_WINDOW;
+		d->first = false;
+	} else {
+		int64_t dod;
+		if (__ts_get(words, &d->pos, 1) == 0)
+			dod = 0;
+		else if (__ts_get(words, &d->pos, 1) == 0)
+			dod = (int64_t)__ts_get(words, &d->pos, 7) - 63;
+		else if (__ts_get(words, &d->pos, 1) == 0)
+			dod = (int64_t)__ts_get(words, &d->pos, 9) - 255;
+		else if (__ts_get(words, &d->pos, 1) == 0)
+			dod = (int64_t)__ts_get(words, &d->pos, 12) - 2047;
+		else
+			dod = (int64_t)__ts_get(words, &d->pos, 64);
+
+		d->delta = (int64_t)((uint64_t)d->delta + (uint64_t)dod);
+		d->t	 = (int64_t)((uint64_t)d->t + (uint64_t)d->delta);
+
+		if (__ts_get(words, &d->pos, 1) != 0) {
+			if (__ts_get(words, &d->pos, 1) != 0) {
+				d->lead	     = __ts_get(words, &d->pos, 5);
+				unsigned len = __ts_get(words, &d->pos, 6) + 1;
+				d->trail     = 64 - d->lead - len;
+			}
+			unsigned len = 64 - d->lead - d->trail;
+			d->v ^= __ts_get(words, &d->pos, len) << d->trail;
+		}
+	}
+
+	d->left--;
+	*t = d->t;
+	*v = __ts_double(d->v);
+}
+
+struct tseries *tseries_new(void)
+{
+	struct tseries *ts = calloc(1, sizeof *ts);
+	if (!ts)
+		return NULL;
+
+	ts->blocks = vector_new(0, sizeof(struct ts_block));
+	ts->words  = vector_new(0, sizeof(uint64_t));
+	if (!ts->blocks || !ts->words) {
+		tseries_free(&ts);
+		return NULL;
+	}
+
+	return ts;
+}
+
+void tseries_free(struct tseries **tp)
+{
+	ASSERT_PRECONDITION(tp && *tp, return );
+
+	struct tseries *ts = *tp;
+	if (ts->blocks)
+		vector_free(&ts->blocks, NULL);
+	if (ts->words)
+		vector_free(&ts->words, NULL);
+	free(ts);
+
+	*tp = NULL;
+}
+
+size_t tseries_size(struct tseries *ts)
+{
+	ASSERT_PRECONDITION(ts != NULL, return 0);
+	return ts->size;
+}
+
+size_t tseries_bytes(struct tseries *ts)
+{
+	ASSERT_PRECONDITION(ts != NULL, return 0);
+	return (vector_size(ts->words) * sizeof(uint64_t))
+	       + (vector_size(ts->blocks) * sizeof(struct ts_block));
+}
+
+size_t tseries_blocks(struct tseries *ts)
+{
+	ASSERT_PRECONDITION(ts != NULL, return 0);
+	return vector_size(ts->blocks);
+}
+
+int tseries_append(struct tseries *ts, int64_t t, double v)
+{
+	ASSERT_PRECONDITION(ts != NULL, return VEC_EINVAL);
+
+	size_t nblocks	 = vector_size(ts->blocks);
+	struct ts_block *b = nblocks ? vector_at(ts->blocks, nblocks - 1) : NULL;
+	ASSERT_PRECONDITION(!b || t >= b->last, return VEC_EINVAL);
+
+	/* reserve first, so nothing fails once the point is half written */
+	bool opening = !b || b->count == TSERIES_BLOCK_POINTS;
+	int res	     = vector_reserve(ts->words, vector_size(ts->words) + TS_POINT_WORDS);
+	if (res == VEC_SUCCESS && opening)
+		res = vector_reserve(ts->blocks, nblocks + 1);
+	if (res != VEC_SUCCESS)
+		return res;
+
+	if (opening) {
+		/* blocks start at a word boundary, with the first point in full */
+		ts->nbits = vector_size(ts->words) * 64;
+
+		struct ts_block nb = { t, t, 0, vector_size(ts->words) };
+		if ((res = vector_push(ts->blocks, &nb)) != VEC_SUCCESS)
+			return res;
+		b = vector_at(ts->blocks, nblocks);
+
+		if ((res = __ts_put(ts, (uint64_t)t, 64)) != VEC_SUCCESS
+		    || (res = __ts_put(ts, __ts_bits(v), 64)) != VEC_SUCCESS)
+			return res;
+
+		ts->prev_t     = t;
+		ts->prev_delta = 0;
+		ts->prev_v     = __ts_bits(v);
+		ts->lead       = TS_NO_WINDOW;
+	} else if ((res = __ts_put_timestamp(ts, t)) != VEC_SUCCESS
+		   || (res = __ts_put_value(ts, v)) != VEC_SUCCESS) {
+		return res;
+	}
+
+	b->last = t;
+	b->count++;
+	ts->size++;
+	return VEC_SUCCESS;
+}
+
+int tseries_decode_block(struct tseries *ts, size_t block, int64_t *t, double *v, size_t *n)
+{
+	ASSERT_PRECONDITION(ts != NULL && t != NULL && v != NULL && n != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(block < vector_size(ts->blocks), return VEC_ERANGE);
+
+	const uint64_t *words = vector_data(ts->words);
+	struct ts_decoder d;
+	__ts_decoder_start(&d, vector_at(ts->blocks, block));
+
+	*n = d.left;
+	for (size_t i = 0; d.left; i++)
+		__ts_decode(&d, words, &t[i], &v[i]);
+
+	return VEC_SUCCESS;
+}
+
+/* decode ahead to the next point in range, if any */
+static void __ts_iter_advance(struct tseries_iter *it)
+{
+	struct tseries *ts    = it->ts;
+	const uint64_t *words = vector_data(ts->words);
+	size_t nblocks	      = vector_size(ts->blocks);
+
+	it->has = false;
+	while (it->block < nblocks) {
+		if (it->d.left == 0) {
+			if (++it->block >= nblocks)
+				return;
+			__ts_decoder_start(&it->d, vector_at(ts->blocks, it->block));
+			continue;
+		}
+
+		__ts_decode(&it->d, words, &it->t, &it->v);
+		if (it->t >= it->end) {
+			it->block = nblocks;
+			return;
+		}
+		if (it->t >= it->begin) {
+			it->has = true;
+			return;
+		}
+	}
+}
+
+struct tseries_iter *tseries_get_iterator(struct tseries *ts, int64_t begin, int64_t end)
+{
+	ASSERT_PRECONDITION(ts != NULL && begin <= end, return NULL);
+
+	struct tseries_iter *it = calloc(1, sizeof *it);
+	if (!it)
+		return NULL;
+
+	it->ts	  = ts;
+	it->begin = begin;
+	it->end	  = end;
+
+	/* first block ending at or after begin */
+	size_t lo = 0, hi = vector_size(ts->blocks);
+	while (lo < hi) {
+		size_t mid	   = lo + (hi - lo) / 2;
+		struct ts_block *b = vector_at(ts->blocks, mid);
+		if (b->last < begin)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	it->block = lo;
+	if (lo < vector_size(ts->blocks)) {
+		__ts_decoder_start(&it->d, vector_at(ts->blocks, lo));
+		__ts_iter_advance(it);
+	}
+
+	return it;
+}
+
+bool tseries_has_next(struct tseries_iter *it)
+{
+	ASSERT_PRECONDITION(it != NULL, return false);
+	return it->has;
+}
+
+int tseries_get_next(struct tseries_iter *it, int64_t *t, double *v)
+{
+	ASSERT_PRECONDITION(it != NULL && t != NULL && v != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(it->has, return VEC_EITEHX);
+
+	*t = it->t;
+	*v = it->v;
+	__ts_iter_advance(it);
+	return VEC_SUCCESS;
+}
+
+void tseries_free_iterator(struct tseries_iter *it)
+{
+	ASSERT_PRECONDITION(it != NULL, return );
+	free(it);
+}
@@ -6,7 +6,11 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdbool.h>
-//#include <pthread.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "vector.h"
 
@@ -15,7 +19,52 @@
 	action
 
 enum vec_consts {
-	VEC_NEXTSIZE = 0
+	VEC_NEXTSIZE = 0,
+
+	/* smallest vector whose destructor pass is split across threads */
+	VEC_PARALLEL_DTOR_MIN = 1 << 16,
+
+	/* most threads a single destructor pass is split across */
+	VEC_PARALLEL_DTOR_MAX = 64,
+
+	/* most distinct tags learned by vector_new_tagged() */
+	VEC_TAG_SLOTS = 256,
+
+	/* final sizes of a tag are counted per power of two */
+	VEC_TAG_BUCKETS = 64,
+
+	/* bytes of object bodies allocated at once by an indirect vector */
+	VEC_POOL_CHUNK = 64 * 1024,
+
+	/* lookups interleaved by a batched search, each with a probe in flight */
+	VEC_BATCH_GROUP = 16,
+
+	/* runs sorted by insertion before an argsort starts merging */
+	VEC_ARGSORT_RUN = 16,
+
+	/* fewest objects gathered by a thread of vector_permute() */
+	VEC_GATHER_MIN = 1 << 16,
+
+	/* most threads gathering a permutation */
+	VEC_GATHER_MAX = 64,
+
+	/* wins in a row that switch a merge to galloping */
+	VEC_SORT_GALLOP = 7,
+
+	/* runs pending a merge, their powers increase up the stack */
+	VEC_SORT_STACK = 66,
+
+	/* bytes of a block compressed while cold, rounded up to whole pages */
+	VEC_COLD_BLOCK = 64 * 1024,
+
+	/* blocks compressing to more than 3/4 of their size are left as is */
+	VEC_COLD_RATIO = 4,
+
+	/* hashed positions the compressor finds matches in */
+	VEC_LZ_HASH_BITS = 12,
+
+	VEC_LZ_MIN_MATCH = 4,
+	VEC_LZ_MAX_OFFSET = 65535
 };
 
 struct vector {
@@ -28,12 +77,49 @@ struct vector {
 	/* size of an object */
 	size_t objsz;
 
+	/* size of an entry of the array, objsz unless the vector is indirect */
+	size_t slotsz;
+
+	/* bodies of the objects of an indirect vector, NULL if direct */
+	struct __vec_pool *pool;
+
 	/* if false, this vector is immutable */
 	bool mutable;
 
 	/* beginning of the dynamic array holding objects */
 	char *data;
 
+	/* objects moved per operation while growing incrementally, 0 if disabled */
+	size_t migrate_step;
+
+	/* previous array while growing incrementally, holds [migrated, old_size) */
+	char *old_data;
+
+	/* size of the vector when old_data was replaced */
+	size_t old_size;
+
+	/* number of objects already moved from old_data to data */
+	size_t migrated;
+
+	/* percent of capacity after which the next array is prepared, 0 if disabled */
+	unsigned pregrow_mark;
+
+	/* the next array being prepared in the background, NULL if none */
+	struct __vec_pregrow *pregrow;
+
+	/* lowest object written below the prepared snapshot since it was taken */
+	size_t pregrow_dirty;
+
+	/* the creation site this vector reports its final size to, NULL if untagged */
+	struct __vec_tag *tag;
+
+	/* blocks of the array compressed while cold, NULL if disabled */
+	struct __vec_cold *cold;
+
+	/* called before the array is replaced or released, NULL if none */
+	void (*moved)(void *);
+	void *moved_arg;
+
 	/* mutex for thread safety */
 	// pthread_mutex_t lock;
 };
@@ -52,12 +138,241 @@ struct vector_iter {
 	size_t current;
 };
 
+/* an object index and its sort key */
+struct __vec_keyed {
+	uint64_t key;
+	size_t idx;
+};
+
+/*
+ * A job for a background worker. The job function owns the job
+ * and releases it when done.
+ */
+struct __vec_job {
+	void (*fn)(struct __vec_job *);
+	struct __vec_job *next;
+};
+
+/* a single background thread draining a FIFO of jobs */
+struct __vec_worker {
+	pthread_mutex_t lock;
+
+	/* signalled when a job is queued */
+	pthread_cond_t wake;
+
+	/* signalled when there are no more pending jobs */
+	pthread_cond_t idle;
+
+	/* queued jobs, oldest first */
+	struct __vec_job *head;
+	struct __vec_job *tail;
+
+	/* number of queued and running jobs */
+	size_t pending;
+
+	/* worker thread is started lazily, on the first job */
+	bool started;
+	pthread_t thread;
+};
+
+/* a vector handed over to the reclaimer */
+struct __vec_reclaim {
+	struct __vec_job job;
+	struct vector *v;
+	void (*elem_dtor)(void *);
+};
+
+enum __vec_pregrow_state {
+	PREGROW_QUEUED,
+	PREGROW_RUNNING,
+	PREGROW_READY,
+	PREGROW_CANCELLED
+};
+
+/*
+ * The next array of a vector, allocated and filled with a snapshot
+ * of the objects by the grower thread.
+ */
+struct __vec_pregrow {
+	struct __vec_job job;
+
+	pthread_mutex_t lock;
+
+	/* signalled when the array is ready */
+	pthread_cond_t ready;
+
+	enum __vec_pregrow_state state;
+
+	/* entries [0, nobj) of src are copied into the new array */
+	const char *src;
+	size_t nobj;
+	size_t slotsz;
+
+	/* the new array, NULL if allocation failed */
+	char *data;
+	size_t capacity;
+};
+
+/* final sizes seen for vectors created with a tag */
+struct __vec_tag {
+	/* copy of the tag string, NULL if the slot is free */
+	char *name;
+
+	/* counts[b] is the number of final sizes in (2^(b-1), 2^b] */
+	size_t counts[VEC_TAG_BUCKETS];
+
+	/* number of final sizes seen */
+	size_t n;
+};
+
+/* header of a chunk of object bodies, keeping the bodies aligned */
+union __vec_chunk {
+	union __vec_chunk *next;
+	max_align_t align;
+};
+
+/* fixed size bodies of the objects of an indirect vector */
+struct __vec_pool {
+	/* size of a body, rounded up to keep bodies aligned */
+	size_t bodysz;
+
+	/* number of bodies in a chunk */
+	size_t per_chunk;
+
+	/* all chunks, newest first */
+	union __vec_chunk *chunks;
+
+	/* released bodies, linked through their first word */
+	void *free;
+
+	/* next never used body of the newest chunk, and how many are left */
+	char *next;
+	size_t left;
+};
+
+/* a block of the array of a vector, compressed while it is cold */
+struct __vec_block {
+	/* compressed copy of the block, NULL once it is written */
+	unsigned char *z;
+	size_t zsize;
+
+	/* the pages were given back, the objects are only in z */
+	bool released;
+
+	/* read or written since the last sweep */
+	bool touched;
+
+	/* did not compress, left as is until written */
+	bool raw;
+};
+
+/* blocks of a vector kept compressed while nothing touches them */
+struct __vec_cold {
+	/* the array the blocks are laid out on, NULL until the next sweep */
+	char *data;
+
+	/* blocks start at the first page boundary of the array */
+	size_t first;
+	size_t pagesz;
+	size_t blocksz;
+
+	/* blocks wholly below the size of the vector at the last sweep */
+	struct __vec_block *blocks;
+	size_t nblocks;
+	size_t capacity;
+
+	/* blocks with a compressed copy, released ones, and bytes of the copies */
+	size_t nz;
+	size_t nreleased;
+	size_t zbytes;
+
+	/* blocks decompressed for reading that kept their copy, oldest first */
+	size_t *cache;
+	size_t ncache;
+	size_t cache_cap;
+
+	/* output of the compressor, a block */
+	unsigned char *scratch;
+};
+
+/* a slice of a parallel destructor pass */
+struct __vec_dtor_slice {
+	struct vector *v;
+	void (*elem_dtor)(void *);
+	size_t begin;
+	size_t end;
+};
+
+/* a slice of a parallel gather, dst[i] = src[perm[i]] */
+struct __vec_gather_slice {
+	const char *src;
+	char *dst;
+	const size_t *perm;
+	size_t slotsz;
+	size_t begin;
+	size_t end;
+};
+
+/* state of a stable sort, merging runs of slots */
+struct __vec_sorter {
+	struct vector *v;
+	int (*cmp)(const void *, const void *);
+
+	/* stands for the objects an indirect vector never wrote */
+	char *zero;
+
+	/* bytes moved per object, a pointer if the vector is indirect */
+	size_t sz;
+
+	/* the shorter run of a merge is copied here */
+	char *tmp;
+	size_t tmpcap;
+
+	/* a slot being inserted or swapped */
+	char *pivot;
+
+	/* wins in a row before galloping, adapting to how well it pays off */
+	size_t min_gallop;
+};
+
+/* a sorted run waiting to be merged */
+struct __vec_pending {
+	size_t start;
+	size_t len;
+	unsigned power;
+};
+
+/* a comparator of numbers, and the keys it orders by */
+struct __vec_numeric {
+	int (*cmp)(const void *, const void *);
+	size_t objsz;
+	uint64_t (*key)(const void *);
+};
+
 static size_t __vector_default_growby(size_t sz);
 
 static allocator_fn   __vec_alloc   = &malloc;
+static callocator_fn  __vec_calloc  = &calloc;
 static deallocator_fn __vec_dealloc = &free;
 static growby_fn      __vec_growby  = &__vector_default_growby;
 
+static struct __vec_worker __vec_reclaimer = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+	.idle = PTHREAD_COND_INITIALIZER,
+};
+static _Atomic size_t __vec_reclaim_threads = 1;
+
+static pthread_mutex_t __vec_tags_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct __vec_tag __vec_tags[VEC_TAG_SLOTS];
+static unsigned __vec_tag_pct = 90;
+
+static struct __vec_worker __vec_grower = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+	.idle = PTHREAD_COND_INITIALIZER,
+};
+
 static inline bool __vector_idx_is_valid(struct vector *v, size_t idx)
 {
 	return v && idx >= 0 && idx < v->capacity;
@@ -66,59 +381,1492 @@ static inline bool __vector_idx_is_valid(struct vector *v, size_t idx)
 static inline char *__vector_idx_to_ptr(struct vector *v, size_t idx)
 {
 	// v is assumed to be not NULL and v->data is valid
-	return v->data + (idx * v->objsz);
+	if (v->old_data && idx >= v->migrated && idx < v->old_size)
+		return v->old_data + (idx * v->slotsz);
+	return v->data + (idx * v->slotsz);
 }
 
 static inline bool __vector_is_valid(struct vector *v)
 {
-	return v && v->data;
+	// empty vectors have no array until they first grow
+	return v && (v->data || v->capacity == 0);
 }
 
 static inline bool __vector_needs_realloc_for(struct vector *v, size_t idx)
 {
-	return idx > v->capacity;
+	return idx >= v->capacity;
+}
+
+static size_t __vector_default_growby(size_t sz)
+{
+	// first time grow for empty vectors
+	if (sz == 0)
+		return 1;
+
+	// We need to keep the size as a power of 2
+	if ((sz & (sz - 1)) == 0)
+		return sz << 1;
+
+	size_t y = 1;
+	while (y < sz)
+		y <<= 1;
+	return y;
+}
+
+/*
+ * Allocate a zero filled array of nobj objects.
+ *
+ * A calloc like allocator gets fresh mmap'ed arrays from the kernel already
+ * zeroed, so the pages are not touched here. Otherwise fall back to the
+ * plain allocator and clear the array ourselves.
+ */
+static void *__vector_zalloc(size_t nobj, size_t objsz)
+{
+	if (objsz && nobj > SIZE_MAX / objsz)
+		return NULL;
+
+	if (__vec_calloc)
+		return __vec_calloc(nobj, objsz);
+
+	void *p = __vec_alloc(nobj * objsz);
+	if (p)
+		memset(p, 0, nobj * objsz);
+	return p;
+}
+
+/*
+ * Find the slot of a tag, claiming a free one for new tags.
+ * Must be called with __vec_tags_lock held. Returns NULL if the table is full.
+ */
+static struct __vec_tag *__vector_tag_lookup(const char *name)
+{
+	size_t h = 5381;
+	for (const char *c = name; *c; c++)
+		h = (h * 33) ^ (unsigned char)*c;
+
+	for (size_t i = 0; i < VEC_TAG_SLOTS; i++) {
+		struct __vec_tag *t = &__vec_tags[(h + i) % VEC_TAG_SLOTS];
+		if (t->name && strcmp(t->name, name) == 0)
+			return t;
+		if (t->name)
+			continue;
+
+		size_t len = strlen(name) + 1;
+		t->name	   = __vec_alloc(len);
+		if (!t->name)
+			return NULL;
+		memcpy(t->name, name, len);
+		return t;
+	}
+
+	return NULL;
+}
+
+/* ceil(log2(sz)), the power of two capacity holding sz objects */
+static inline unsigned __vector_tag_bucket(size_t sz)
+{
+	return sz <= 1 ? 0 : 64 - __builtin_clzll(sz - 1);
+}
+
+/*
+ * Capacity covering the learned percentile of final sizes of a tag,
+ * 0 if nothing was learned yet. Must be called with __vec_tags_lock held.
+ */
+static size_t __vector_tag_hint(struct __vec_tag *t)
+{
+	if (t->n == 0)
+		return 0;
+
+	size_t want = (t->n * __vec_tag_pct + 99) / 100;
+	size_t seen = 0;
+	for (unsigned b = 0; b < VEC_TAG_BUCKETS; b++) {
+		seen += t->counts[b];
+		if (seen >= want)
+			return (size_t)1 << b;
+	}
+	return 0;
+}
+
+static struct __vec_pool *__vector_pool_new(size_t objsz)
+{
+	struct __vec_pool *pool = __vec_alloc(sizeof *pool);
+	if (!pool)
+		return NULL;
+
+	size_t align	= _Alignof(max_align_t);
+	size_t bodysz	= objsz > sizeof(void *) ? objsz : sizeof(void *);
+	pool->bodysz	= (bodysz + align - 1) / align * align;
+	pool->per_chunk = pool->bodysz < VEC_POOL_CHUNK ? VEC_POOL_CHUNK / pool->bodysz : 1;
+	pool->chunks	= NULL;
+	pool->free	= NULL;
+	pool->next	= NULL;
+	pool->left	= 0;
+	return pool;
+}
+
+static void __vector_pool_free(struct __vec_pool *pool)
+{
+	while (pool->chunks) {
+		union __vec_chunk *next = pool->chunks->next;
+		__vec_dealloc(pool->chunks);
+		pool->chunks = next;
+	}
+	__vec_dealloc(pool);
+}
+
+/* a zero filled body of objsz bytes, NULL if allocation failed */
+static char *__vector_pool_get(struct __vec_pool *pool, size_t objsz)
+{
+	if (pool->free) {
+		char *body = pool->free;
+		pool->free = *(void **)body;
+		memset(body, 0, objsz);
+		return body;
+	}
+
+	if (pool->left == 0) {
+		union __vec_chunk *chunk = __vector_zalloc(1, sizeof *chunk + (pool->per_chunk * pool->bodysz));
+		if (!chunk)
+			return NULL;
+
+		chunk->next  = pool->chunks;
+		pool->chunks = chunk;
+		pool->next   = (char *)(chunk + 1);
+		pool->left   = pool->per_chunk;
+	}
+
+	char *body = pool->next;
+	pool->next += pool->bodysz;
+	pool->left--;
+	return body;
+}
+
+static void __vector_pool_put(struct __vec_pool *pool, char *body)
+{
+	*(void **)body = pool->free;
+	pool->free     = body;
+}
+
+/*
+ * Get the object at idx. Indirect vectors have no body for objects never
+ * written, NULL is returned unless create is true.
+ */
+static inline char *__vector_obj_ptr(struct vector *v, size_t idx, bool create)
+{
+	char *slot = __vector_idx_to_ptr(v, idx);
+	if (!v->pool)
+		return slot;
+
+	char *body = *(char **)slot;
+	if (!body && create) {
+		body = __vector_pool_get(v->pool, v->objsz);
+		*(char **)slot = body;
+	}
+	return body;
+}
+
+/* bytes continuing a length past its 4 bit field */
+static inline size_t __vector_lz_extra(size_t len)
+{
+	return len < 15 ? 0 : ((len - 15) / 255) + 1;
+}
+
+static inline size_t __vector_lz_put_len(unsigned char *dst, size_t op, size_t len)
+{
+	if (len < 15)
+		return op;
+	for (len -= 15; len >= 255; len -= 255)
+		dst[op++] = 255;
+	dst[op++] = len;
+	return op;
+}
+
+/*
+ * Append a sequence of nlit literals and a match of len bytes at off bytes
+ * back, len 0 for the last sequence. Returns the new output size, SIZE_MAX
+ * if it would pass cap.
+ */
+static size_t __vector_lz_sequence(unsigned char *dst, size_t op, size_t cap, const unsigned char *lit,
+				   size_t nlit, size_t off, size_t len)
+{
+	size_t mlen = len ? len - VEC_LZ_MIN_MATCH : 0;
+	size_t need = 1 + __vector_lz_extra(nlit) + nlit + (len ? 2 + __vector_lz_extra(mlen) : 0);
+	if (need > cap - op)
+		return SIZE_MAX;
+
+	dst[op++] = ((nlit < 15 ? nlit : 15) << 4) | (mlen < 15 ? mlen : 15);
+	op	  = __vector_lz_put_len(dst, op, nlit);
+	memcpy(dst + op, lit, nlit);
+	op += nlit;
+	if (len) {
+		dst[op++] = off & 0xff;
+		dst[op++] = off >> 8;
+		op	  = __vector_lz_put_len(dst, op, mlen);
+	}
+	return op;
+}
+
+/*
+ * Compress n bytes of src into at most cap bytes of dst, LZ4 style: each
+ * sequence is a token holding 4 bits of literal length and 4 bits of match
+ * length, longer lengths going on in bytes up to 255, the literals, and
+ * the 16 bit offset of the match. The last sequence has literals only.
+ * Matches are found through the last position of each hash of 4 bytes.
+ * Returns the compressed size, 0 if it does not fit.
+ */
+static size_t __vector_lz_compress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap)
+{
+	uint32_t table[1 << VEC_LZ_HASH_BITS];
+	memset(table, 0, sizeof table);
+
+	size_t ip = 0, anchor = 0, op = 0;
+	while (ip + VEC_LZ_MIN_MATCH <= n) {
+		uint32_t seq, at;
+		memcpy(&seq, src + ip, sizeof seq);
+		uint32_t h  = (seq * UINT32_C(2654435761)) >> (32 - VEC_LZ_HASH_BITS);
+		size_t cand = table[h];
+		table[h]    = ip;
+		memcpy(&at, src + cand, sizeof at);
+
+		if (cand >= ip || ip - cand > VEC_LZ_MAX_OFFSET || at != seq) {
+			/* move faster through data that does not compress */
+			ip += 1 + ((ip - anchor) >> 6);
+			continue;
+		}
+
+		size_t len = VEC_LZ_MIN_MATCH;
+		while (ip + len < n && src[cand + len] == src[ip + len])
+			len++;
+		op = __vector_lz_sequence(dst, op, cap, src + anchor, ip - anchor, ip - cand, len);
+		if (op == SIZE_MAX)
+			return 0;
+		ip += len;
+		anchor = ip;
+	}
+
+	op = __vector_lz_sequence(dst, op, cap, src + anchor, n - anchor, 0, 0);
+	return op == SIZE_MAX ? 0 : op;
+}
+
+/* decompress the n bytes of src into exactly cap bytes of dst, false if they do not decode to that */
+static bool __vector_lz_decompress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap)
+{
+	size_t ip = 0, op = 0;
+	while (ip < n) {
+		unsigned token = src[ip++];
+		size_t nlit    = token >> 4;
+		for (unsigned char b = nlit == 15 ? 255 : 0; b == 255; nlit += b) {
+			if (ip == n)
+				return false;
+			b = src[ip++];
+		}
+		if (nlit > n - ip || nlit > cap - op)
+			return false;
+		memcpy(dst + op, src + ip, nlit);
+		ip += nlit;
+		op += nlit;
+		if (ip == n)
+			break;
+
+		if (n - ip < 2)
+			return false;
+		size_t off = src[ip] | ((size_t)src[ip + 1] << 8);
+		size_t len = token & 15;
+		ip += 2;
+		for (unsigned char b = len == 15 ? 255 : 0; b == 255; len += b) {
+			if (ip == n)
+				return false;
+			b = src[ip++];
+		}
+		len += VEC_LZ_MIN_MATCH;
+		if (off == 0 || off > op || len > cap - op)
+			return false;
+
+		/* a match may overlap the bytes it produces, by whole words if it is a word back */
+		if (off >= len) {
+			memcpy(dst + op, dst + op - off, len);
+		} else {
+			size_t i = 0;
+			for (; off >= 8 && i + 8 <= len; i += 8)
+				memcpy(dst + op + i, dst + op + i - off, 8);
+			for (; i < len; i++)
+				dst[op + i] = dst[op + i - off];
+		}
+		op += len;
+	}
+	return op == cap;
+}
+
+static inline char *__vector_cold_block(struct vector *v, size_t b)
+{
+	return v->data + v->cold->first + (b * v->cold->blocksz);
+}
+
+/* give the pages of block b back, its objects are in its compressed copy */
+static void __vector_cold_release(struct vector *v, size_t b)
+{
+#ifdef MADV_DONTNEED
+	madvise(__vector_cold_block(v, b), v->cold->blocksz, MADV_DONTNEED);
+#endif
+	v->cold->blocks[b].released = true;
+	v->cold->nreleased++;
+}
+
+static void __vector_cold_uncache(struct __vec_cold *c, size_t b)
+{
+	for (size_t i = 0; i < c->ncache; i++) {
+		if (c->cache[i] == b) {
+			memmove(c->cache + i, c->cache + i + 1, (c->ncache - i - 1) * sizeof *c->cache);
+			c->ncache--;
+			return;
+		}
+	}
+}
+
+/*
+ * Keep block b decompressed, releasing the oldest cached block if there are
+ * too many. Blocks first .. b are being read together and are never the
+ * ones released; if every cached block is among them, b stays decompressed
+ * until the next sweep without being cached.
+ */
+static void __vector_cold_cache(struct vector *v, size_t b, size_t first)
+{
+	struct __vec_cold *c = v->cold;
+	if (c->ncache == c->cache_cap) {
+		size_t i = 0;
+		while (i < c->ncache && c->cache[i] >= first && c->cache[i] < b)
+			i++;
+		if (i == c->ncache)
+			return;
+		__vector_cold_release(v, c->cache[i]);
+		memmove(c->cache + i, c->cache + i + 1, (--c->ncache - i) * sizeof *c->cache);
+	}
+	c->cache[c->ncache++] = b;
+}
+
+/* decompress block b if it was released, and drop its copy if it is written */
+static void __vector_cold_load(struct vector *v, size_t b, bool write)
+{
+	struct __vec_cold *c  = v->cold;
+	struct __vec_block *k = &c->blocks[b];
+
+	if (k->released) {
+		/* the copy was made from this block, it decodes to a whole one */
+		__vector_lz_decompress(k->z, k->zsize, (unsigned char *)__vector_cold_block(v, b), c->blocksz);
+		k->released = false;
+		c->nreleased--;
+	} else if (write) {
+		__vector_cold_uncache(c, b);
+	}
+
+	if (write) {
+		__vec_dealloc(k->z);
+		c->zbytes -= k->zsize;
+		c->nz--;
+		k->z	 = NULL;
+		k->zsize = 0;
+	}
+}
+
+/*
+ * Note an access to object idx. The blocks it spans are decompressed if
+ * they were released, and lose their compressed copy if it is a write.
+ * Caching one of them for a read never releases another.
+ */
+static inline void __vector_cold_touch(struct vector *v, size_t idx, bool write)
+{
+	struct __vec_cold *c = v->cold;
+	size_t lo = idx * v->slotsz, hi = lo + v->slotsz;
+	if (c->data != v->data || hi <= c->first || v->slotsz == 0)
+		return;
+
+	size_t first = lo < c->first ? 0 : (lo - c->first) / c->blocksz;
+	for (size_t b = first; b < c->nblocks && c->first + (b * c->blocksz) < hi; b++) {
+		struct __vec_block *k = &c->blocks[b];
+		k->touched	      = true;
+		k->raw		      = k->raw && !write;
+		if (k->z && (k->released || write)) {
+			bool cache = k->released && !write;
+			__vector_cold_load(v, b, write);
+			if (cache)
+				__vector_cold_cache(v, b, first);
+		}
+	}
+}
+
+/* decompress every block and drop the copies, the array may be written or moved afterwards */
+static void __vector_cold_thaw(struct vector *v)
+{
+	struct __vec_cold *c = v->cold;
+	for (size_t b = 0; b < c->nblocks && c->nz > 0; b++) {
+		if (c->blocks[b].z)
+			__vector_cold_load(v, b, true);
+	}
+	c->data = NULL;
+}
+
+/* lay the blocks out over the objects of the array, new blocks count as touched */
+static int __vector_cold_layout(struct vector *v)
+{
+	struct __vec_cold *c = v->cold;
+	if (c->data != v->data) {
+		c->data	   = v->data;
+		c->first   = (c->pagesz - ((uintptr_t)v->data % c->pagesz)) % c->pagesz;
+		c->nblocks = 0;
+	}
+
+	size_t bytes = v->size * v->slotsz;
+	size_t n     = bytes > c->first ? (bytes - c->first) / c->blocksz : 0;
+	for (size_t b = n; b < c->nblocks; b++) {
+		if (c->blocks[b].z)
+			__vector_cold_load(v, b, true);
+	}
+
+	if (n > c->capacity) {
+		size_t capacity		   = n > 2 * c->capacity ? n : 2 * c->capacity;
+		struct __vec_block *blocks = __vec_alloc(capacity * sizeof *blocks);
+		if (!blocks)
+			return VEC_ENOMEM;
+		if (c->blocks) {
+			memcpy(blocks, c->blocks, c->nblocks * sizeof *blocks);
+			__vec_dealloc(c->blocks);
+		}
+		c->blocks   = blocks;
+		c->capacity = capacity;
+	}
+	for (size_t b = c->nblocks; b < n; b++)
+		c->blocks[b] = (struct __vec_block){ .touched = true };
+	c->nblocks = n;
+	return VEC_SUCCESS;
+}
+
+/* compress block b and give its pages back, unless it does not compress */
+static int __vector_cold_freeze(struct vector *v, size_t b)
+{
+	struct __vec_cold *c  = v->cold;
+	struct __vec_block *k = &c->blocks[b];
+
+	size_t zsize = __vector_lz_compress((const unsigned char *)__vector_cold_block(v, b), c->blocksz, c->scratch,
+					    c->blocksz - (c->blocksz / VEC_COLD_RATIO));
+	if (zsize == 0) {
+		k->raw = true;
+		return VEC_SUCCESS;
+	}
+
+	k->z = __vec_alloc(zsize);
+	if (!k->z)
+		return VEC_ENOMEM;
+	memcpy(k->z, c->scratch, zsize);
+	k->zsize = zsize;
+	c->zbytes += zsize;
+	c->nz++;
+	__vector_cold_release(v, b);
+	return VEC_SUCCESS;
+}
+
+static void __vector_cold_free(struct vector *v)
+{
+	struct __vec_cold *c = v->cold;
+	for (size_t b = 0; b < c->nblocks; b++) {
+		if (c->blocks[b].z)
+			__vec_dealloc(c->blocks[b].z);
+	}
+	if (c->blocks)
+		__vec_dealloc(c->blocks);
+	if (c->cache)
+		__vec_dealloc(c->cache);
+	if (c->scratch)
+		__vec_dealloc(c->scratch);
+	__vec_dealloc(c);
+	v->cold = NULL;
+}
+
+static void *__vector_worker_main(void *arg)
+{
+	struct __vec_worker *w = arg;
+
+	pthread_mutex_lock(&w->lock);
+	for (;;) {
+		while (!w->head)
+			pthread_cond_wait(&w->wake, &w->lock);
+
+		struct __vec_job *job = w->head;
+		w->head		      = job->next;
+		if (!w->head)
+			w->tail = NULL;
+
+		pthread_mutex_unlock(&w->lock);
+		job->fn(job);
+		pthread_mutex_lock(&w->lock);
+
+		if (--w->pending == 0)
+			pthread_cond_broadcast(&w->idle);
+	}
+
+	return NULL;
+}
+
+/*
+ * Queue a job on the worker, starting its thread if needed.
+ * Returns false if the thread could not be started, in which case
+ * the job is left to the caller.
+ */
+static bool __vector_worker_submit(struct __vec_worker *w, struct __vec_job *job)
+{
+	pthread_mutex_lock(&w->lock);
+	if (!w->started) {
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		w->started = pthread_create(&w->thread, &attr, __vector_worker_main, w) == 0;
+		pthread_attr_destroy(&attr);
+
+		if (!w->started) {
+			pthread_mutex_unlock(&w->lock);
+			return false;
+		}
+	}
+
+	job->next = NULL;
+	if (w->tail)
+		w->tail->next = job;
+	else
+		w->head = job;
+	w->tail = job;
+	w->pending++;
+
+	pthread_cond_signal(&w->wake);
+	pthread_mutex_unlock(&w->lock);
+	return true;
+}
+
+static void __vector_worker_wait(struct __vec_worker *w)
+{
+	pthread_mutex_lock(&w->lock);
+	while (w->pending > 0)
+		pthread_cond_wait(&w->idle, &w->lock);
+	pthread_mutex_unlock(&w->lock);
+}
+
+/* tell the listener, if any, that the array is about to be replaced or released */
+static inline void __vector_moving(struct vector *v)
+{
+	if (v->moved && v->data)
+		v->moved(v->moved_arg);
+}
+
+static void __vector_pregrow_release(struct __vec_pregrow *pg)
+{
+	pthread_mutex_destroy(&pg->lock);
+	pthread_cond_destroy(&pg->ready);
+	__vec_dealloc(pg);
+}
+
+static void __vector_pregrow_job(struct __vec_job *job)
+{
+	struct __vec_pregrow *pg = (struct __vec_pregrow *)job;
+
+	pthread_mutex_lock(&pg->lock);
+	if (pg->state == PREGROW_CANCELLED) {
+		/* the vector gave up on this array before it was started */
+		pthread_mutex_unlock(&pg->lock);
+		__vector_pregrow_release(pg);
+		return;
+	}
+	pg->state = PREGROW_RUNNING;
+	pthread_mutex_unlock(&pg->lock);
+
+	pg->data = __vector_zalloc(pg->capacity, pg->slotsz);
+	if (pg->data)
+		memcpy(pg->data, pg->src, pg->nobj * pg->slotsz);
+
+	pthread_mutex_lock(&pg->lock);
+	pg->state = PREGROW_READY;
+	pthread_cond_signal(&pg->ready);
+	pthread_mutex_unlock(&pg->lock);
+}
+
+/*
+ * Detach the prepared array from v, waiting for the grower if it is
+ * working on it. Returns NULL if the array was never started or failed
+ * to allocate.
+ */
+static struct __vec_pregrow *__vector_pregrow_detach(struct vector *v)
+{
+	struct __vec_pregrow *pg = v->pregrow;
+	if (!pg)
+		return NULL;
+	v->pregrow = NULL;
+
+	pthread_mutex_lock(&pg->lock);
+	if (pg->state == PREGROW_QUEUED) {
+		/* the grower releases it when it gets there */
+		pg->state = PREGROW_CANCELLED;
+		pthread_mutex_unlock(&pg->lock);
+		return NULL;
+	}
+	while (pg->state != PREGROW_READY)
+		pthread_cond_wait(&pg->ready, &pg->lock);
+	pthread_mutex_unlock(&pg->lock);
+
+	if (!pg->data) {
+		__vector_pregrow_release(pg);
+		return NULL;
+	}
+	return pg;
+}
+
+/* drop the prepared array, if any. v->data may be replaced afterwards */
+static void __vector_pregrow_cancel(struct vector *v)
+{
+	struct __vec_pregrow *pg = __vector_pregrow_detach(v);
+	if (pg) {
+		__vec_dealloc(pg->data);
+		__vector_pregrow_release(pg);
+	}
+}
+
+/* ask the grower for the next array once v passes its high water mark */
+static void __vector_pregrow_start(struct vector *v)
+{
+	if (!v->pregrow_mark || v->pregrow || v->old_data || !v->data)
+		return;
+
+	/* the grower would copy released pages */
+	if (v->cold && v->cold->nz > 0)
+		return;
+	if (v->size * 100 < (size_t)v->pregrow_mark * v->capacity)
+		return;
+
+	/* same size the synchronous growth would pick for the next push */
+	size_t newcap = __vec_growby(v->capacity + 1);
+	if (newcap <= v->capacity || (v->slotsz && newcap > SIZE_MAX / v->slotsz))
+		return;
+
+	struct __vec_pregrow *pg = __vec_alloc(sizeof *pg);
+	if (!pg)
+		return;
+
+	pthread_mutex_init(&pg->lock, NULL);
+	pthread_cond_init(&pg->ready, NULL);
+	pg->job.fn   = __vector_pregrow_job;
+	pg->state    = PREGROW_QUEUED;
+	pg->src	     = v->data;
+	pg->nobj     = v->size;
+	pg->slotsz   = v->slotsz;
+	pg->data     = NULL;
+	pg->capacity = newcap;
+
+	if (!__vector_worker_submit(&__vec_grower, &pg->job)) {
+		__vector_pregrow_release(pg);
+		return;
+	}
+
+	v->pregrow	 = pg;
+	v->pregrow_dirty = pg->nobj;
+}
+
+/*
+ * Wait for the grower to finish copying the snapshot, so the objects it
+ * reads can be written. An array it has not started on is dropped instead.
+ */
+static void __vector_pregrow_wait(struct vector *v)
+{
+	struct __vec_pregrow *pg = v->pregrow;
+
+	pthread_mutex_lock(&pg->lock);
+	if (pg->state == PREGROW_QUEUED) {
+		pthread_mutex_unlock(&pg->lock);
+		__vector_pregrow_cancel(v);
+		return;
+	}
+	while (pg->state != PREGROW_READY)
+		pthread_cond_wait(&pg->ready, &pg->lock);
+	pthread_mutex_unlock(&pg->lock);
+}
+
+/*
+ * Note a write to idx, so it is copied again when the prepared array is
+ * taken. Called before the write: the first one below the snapshot waits
+ * for the grower to be done reading it.
+ */
+static inline void __vector_pregrow_touch(struct vector *v, size_t idx)
+{
+	if (!v->pregrow || idx >= v->pregrow_dirty)
+		return;
+	if (v->pregrow_dirty == v->pregrow->nobj) {
+		__vector_pregrow_wait(v);
+		if (!v->pregrow)
+			return;
+	}
+	v->pregrow_dirty = idx;
+}
+
+/*
+ * Swap in the prepared array if it holds at least atleast objects, copying
+ * over only what changed since its snapshot. Returns false if there is no
+ * usable prepared array.
+ */
+static bool __vector_pregrow_take(struct vector *v, size_t atleast)
+{
+	size_t dirty		 = v->pregrow_dirty;
+	struct __vec_pregrow *pg = __vector_pregrow_detach(v);
+	if (!pg)
+		return false;
+
+	if (pg->capacity < atleast) {
+		__vec_dealloc(pg->data);
+		__vector_pregrow_release(pg);
+		return false;
+	}
+
+	/* objects popped since the snapshot are zeroed in v->data, and copied over too */
+	size_t end = v->size > pg->nobj ? v->size : pg->nobj;
+	if (v->cold)
+		__vector_cold_thaw(v);
+	if (end > dirty)
+		memcpy(pg->data + (dirty * v->slotsz),
+		       v->data + (dirty * v->slotsz),
+		       (end - dirty) * v->slotsz);
+
+	__vector_moving(v);
+	__vec_dealloc(v->data);
+	v->data	    = pg->data;
+	v->capacity = pg->capacity;
+	__vector_pregrow_release(pg);
+	return true;
+}
+
+static void *__vector_dtor_slice(void *arg)
+{
+	struct __vec_dtor_slice *s = arg;
+	for (size_t i = s->begin; i < s->end; i++) {
+		char *el = __vector_obj_ptr(s->v, i, false);
+		if (el)
+			s->elem_dtor(el);
+	}
+	return NULL;
+}
+
+/*
+ * Call elem_dtor on every object of v. Large vectors are split into
+ * up to nthreads slices, the calling thread takes the last one.
+ */
+static void __vector_destroy_objects(struct vector *v, void (*elem_dtor)(void *),
+				     size_t nthreads)
+{
+	if (!v->data || !elem_dtor || v->size == 0)
+		return;
+	if (v->cold)
+		__vector_cold_thaw(v);
+
+	if (nthreads > VEC_PARALLEL_DTOR_MAX)
+		nthreads = VEC_PARALLEL_DTOR_MAX;
+	if (nthreads > v->size / VEC_PARALLEL_DTOR_MIN)
+		nthreads = v->size / VEC_PARALLEL_DTOR_MIN;
+	if (nthreads <= 1) {
+		struct __vec_dtor_slice all = { v, elem_dtor, 0, v->size };
+		__vector_dtor_slice(&all);
+		return;
+	}
+
+	struct __vec_dtor_slice slices[nthreads];
+	pthread_t threads[nthreads];
+	bool spawned[nthreads];
+
+	size_t step = v->size / nthreads;
+	for (size_t t = 0; t < nthreads; t++) {
+		slices[t] = (struct __vec_dtor_slice){
+			v, elem_dtor, t * step, t == nthreads - 1 ? v->size : (t + 1) * step
+		};
+
+		/* run the slice inline when no thread is available */
+		spawned[t] = t < nthreads - 1
+			     && pthread_create(&threads[t], NULL, __vector_dtor_slice, &slices[t]) == 0;
+		if (!spawned[t])
+			__vector_dtor_slice(&slices[t]);
+	}
+
+	for (size_t t = 0; t < nthreads; t++) {
+		if (spawned[t])
+			pthread_join(threads[t], NULL);
+	}
+}
+
+static void __vector_reclaim_job(struct __vec_job *job)
+{
+	struct __vec_reclaim *r = (struct __vec_reclaim *)job;
+
+	__vector_destroy_objects(r->v, r->elem_dtor, atomic_load(&__vec_reclaim_threads));
+	vector_free(&r->v, NULL);
+	__vec_dealloc(r);
+}
+
+/*
+ * Move up to n objects of a pending incremental growth into the new array.
+ * The old array is released once everything has moved.
+ */
+static void __vector_migrate(struct vector *v, size_t n)
+{
+	if (!v->old_data)
+		return;
+
+	if (n > v->old_size - v->migrated)
+		n = v->old_size - v->migrated;
+
+	memcpy(v->data + (v->migrated * v->slotsz),
+	       v->old_data + (v->migrated * v->slotsz),
+	       n * v->slotsz);
+	v->migrated += n;
+
+	if (v->migrated == v->old_size) {
+		__vec_dealloc(v->old_data);
+		v->old_data = NULL;
+		v->old_size = 0;
+		v->migrated = 0;
+	}
+}
+
+/* finish any pending incremental growth and decompress cold blocks, making v->data complete */
+static inline void __vector_settle(struct vector *v)
+{
+	__vector_migrate(v, SIZE_MAX);
+	if (v->cold)
+		__vector_cold_thaw(v);
+}
+
+static int __vector_realloc(struct vector *v, size_t atleast)
+{
+	if (__vector_pregrow_take(v, atleast))
+		return VEC_SUCCESS;
+
+	size_t cursz  = atleast ? atleast : v->capacity;
+	size_t newcap = __vec_growby(cursz);
+
+	if (newcap <= v->capacity || newcap < atleast)
+		return VEC_EMAXED;
+	if (v->slotsz && newcap > SIZE_MAX / v->slotsz)
+		return VEC_EMAXED;
+
+	/* the tail past the copied objects stays as zero pages */
+	char *newp = __vector_zalloc(newcap, v->slotsz);
+	if (!newp)
+		return VEC_ENOMEM;
+
+	__vector_settle(v);
+	__vector_moving(v);
+
+	if (v->migrate_step && v->data && v->size > 0) {
+		/* leave the objects behind, later operations move them over */
+		v->old_data = v->data;
+		v->old_size = v->size;
+		v->migrated = 0;
+	} else if (v->data) {
+		memcpy(newp, v->data, v->size * v->slotsz);
+		__vec_dealloc(v->data);
+	}
+	v->data	    = newp;
+	v->capacity = newcap;
+	return VEC_SUCCESS;
+}
+
+/*
+ * Stable LSD radix sort of n keyed indices, a byte per pass. Bytes shared
+ * by every key take no pass. Returns whichever of a and tmp holds the
+ * sorted keys.
+ */
+static struct __vec_keyed *__vector_radix_keys(struct __vec_keyed *a, struct __vec_keyed *tmp, size_t n)
+{
+	size_t counts[8][256];
+	memset(counts, 0, sizeof counts);
+	for (size_t i = 0; i < n; i++) {
+		for (unsigned b = 0; b < 8; b++)
+			counts[b][(a[i].key >> (8 * b)) & 0xff]++;
+	}
+
+	for (unsigned b = 0; b < 8 && n > 0; b++) {
+		size_t *c = counts[b];
+		if (c[(a[0].key >> (8 * b)) & 0xff] == n)
+			continue;
+
+		size_t sum = 0;
+		for (unsigned d = 0; d < 256; d++) {
+			size_t x = c[d];
+			c[d]	 = sum;
+			sum += x;
+		}
+		for (size_t i = 0; i < n; i++)
+			tmp[c[(a[i].key >> (8 * b)) & 0xff]++] = a[i];
+
+		struct __vec_keyed *t = a;
+		a		      = tmp;
+		tmp		      = t;
+	}
+	return a;
+}
+
+/* move the objects of v so that the i-th one is the former order[i].idx-th */
+static int __vector_reorder(struct vector *v, const struct __vec_keyed *order)
+{
+	if (v->size == 0)
+		return VEC_SUCCESS;
+
+	char *tmp = __vec_alloc(v->size * v->slotsz);
+	if (!tmp)
+		return VEC_ENOMEM;
+
+	__vector_pregrow_touch(v, 0);
+	for (size_t i = 0; i < v->size; i++)
+		memcpy(tmp + (i * v->slotsz), v->data + (order[i].idx * v->slotsz), v->slotsz);
+	memcpy(v->data, tmp, v->size * v->slotsz);
+
+	__vec_dealloc(tmp);
+	return VEC_SUCCESS;
+}
+
+/* keys of numbers, unsigned and ordered as the numbers are */
+static uint64_t __vector_key_i32(const void *p)
+{
+	uint32_t x;
+	memcpy(&x, p, sizeof x);
+	return x ^ UINT32_C(0x80000000);
+}
+
+static uint64_t __vector_key_u32(const void *p)
+{
+	uint32_t x;
+	memcpy(&x, p, sizeof x);
+	return x;
+}
+
+static uint64_t __vector_key_i64(const void *p)
+{
+	uint64_t x;
+	memcpy(&x, p, sizeof x);
+	return x ^ (UINT64_C(1) << 63);
+}
+
+static uint64_t __vector_key_u64(const void *p)
+{
+	uint64_t x;
+	memcpy(&x, p, sizeof x);
+	return x;
+}
+
+/* negative numbers have every bit flipped, positive ones the sign bit */
+static uint64_t __vector_key_float(const void *p)
+{
+	uint32_t x;
+	memcpy(&x, p, sizeof x);
+	return x >> 31 ? (uint32_t)~x : x | UINT32_C(0x80000000);
+}
+
+static uint64_t __vector_key_double(const void *p)
+{
+	uint64_t x;
+	memcpy(&x, p, sizeof x);
+	return x >> 63 ? ~x : x | (UINT64_C(1) << 63);
+}
+
+static const struct __vec_numeric __vec_numerics[] = {
+	{ vector_cmp_i32, sizeof(int32_t), __vector_key_i32 },
+	{ vector_cmp_u32, sizeof(uint32_t), __vector_key_u32 },
+	{ vector_cmp_i64, sizeof(int64_t), __vector_key_i64 },
+	{ vector_cmp_u64, sizeof(uint64_t), __vector_key_u64 },
+	{ vector_cmp_float, sizeof(float), __vector_key_float },
+	{ vector_cmp_double, sizeof(double), __vector_key_double },
+};
+
+/* the object at idx, or zero if an indirect vector never wrote it */
+static inline const char *__vector_argsort_obj(struct vector *v, size_t idx, const char *zero)
+{
+	const char *el = __vector_obj_ptr(v, idx, false);
+	return el ? el : zero;
+}
+
+/*
+ * Stable merge sort of the n indices of a by the objects of v. Runs of
+ * VEC_ARGSORT_RUN are sorted by insertion, then merged pairwise back and
+ * forth between a and tmp; pairs already in order are copied as is.
+ * Returns whichever of a and tmp holds the sorted indices.
+ */
+static size_t *__vector_merge_indices(struct vector *v, int (*cmp)(const void *, const void *),
+				      const char *zero, size_t *a, size_t *tmp, size_t n)
+{
+	for (size_t lo = 0; lo < n; lo += VEC_ARGSORT_RUN) {
+		size_t hi = n - lo < VEC_ARGSORT_RUN ? n : lo + VEC_ARGSORT_RUN;
+		for (size_t i = lo + 1; i < hi; i++) {
+			size_t x       = a[i], j = i;
+			const char *el = __vector_argsort_obj(v, x, zero);
+			for (; j > lo && cmp(__vector_argsort_obj(v, a[j - 1], zero), el) > 0; j--)
+				a[j] = a[j - 1];
+			a[j] = x;
+		}
+	}
+
+	for (size_t w = VEC_ARGSORT_RUN; w < n; w *= 2) {
+		for (size_t lo = 0; lo < n; lo += 2 * w) {
+			size_t mid = n - lo < w ? n : lo + w;
+			size_t hi  = n - mid < w ? n : mid + w;
+			size_t i = lo, j = mid, k = lo;
+			if (mid < hi
+			    && cmp(__vector_argsort_obj(v, a[mid - 1], zero), __vector_argsort_obj(v, a[mid], zero)) > 0) {
+				while (i < mid && j < hi) {
+					if (cmp(__vector_argsort_obj(v, a[j], zero), __vector_argsort_obj(v, a[i], zero)) < 0)
+						tmp[k++] = a[j++];
+					else
+						tmp[k++] = a[i++];
+				}
+			}
+			memcpy(tmp + k, a + i, (mid - i) * sizeof *a);
+			memcpy(tmp + k + (mid - i), a + j, (hi - j) * sizeof *a);
+		}
+
+		size_t *t = a;
+		a	  = tmp;
+		tmp	  = t;
+	}
+	return a;
+}
+
+static inline int __vector_sort_cmp(const struct __vec_sorter *s, const char *a, const char *b)
+{
+	if (s->v->pool) {
+		a = *(char *const *)a ? *(char *const *)a : s->zero;
+		b = *(char *const *)b ? *(char *const *)b : s->zero;
+	}
+	return s->cmp(a, b);
+}
+
+/* is x ordered before key, or also when equal if right */
+static inline bool __vector_sort_before(const struct __vec_sorter *s, const char *x, const char *key, bool right)
+{
+	int c = __vector_sort_cmp(s, x, key);
+	return right ? c <= 0 : c < 0;
+}
+
+/*
+ * Count the slots of base ordered before key: those comparing less, or
+ * also equal if right. The search gallops from the end if from_end, in
+ * steps doubling from 1, then bisects the last step, so it takes
+ * O(log k) comparisons for an answer k slots away from where it starts.
+ */
+static size_t __vector_gallop(const struct __vec_sorter *s, const char *key, const char *base, size_t n, bool right,
+			      bool from_end)
+{
+	size_t sz = s->sz, lo, hi;
+	if (!from_end) {
+		if (n == 0 || !__vector_sort_before(s, base, key, right))
+			return 0;
+		size_t last = 0, ofs = 1;
+		for (; ofs < n && __vector_sort_before(s, base + (ofs * sz), key, right); ofs = (2 * ofs) + 1)
+			last = ofs;
+		lo = last + 1;
+		hi = ofs < n ? ofs : n;
+	} else {
+		if (n == 0 || __vector_sort_before(s, base + ((n - 1) * sz), key, right))
+			return n;
+		size_t last = 0, ofs = 1;
+		for (; ofs < n && !__vector_sort_before(s, base + ((n - 1 - ofs) * sz), key, right); ofs = (2 * ofs) + 1)
+			last = ofs;
+		lo = ofs < n ? n - ofs : 0;
+		hi = n - 1 - last;
+	}
+
+	while (lo < hi) {
+		size_t m = lo + ((hi - lo) / 2);
+		if (__vector_sort_before(s, base + (m * sz), key, right))
+			lo = m + 1;
+		else
+			hi = m;
+	}
+	return lo;
+}
+
+/* make room for k slots in the merge buffer, growing it at most to half the vector */
+static int __vector_sort_reserve(struct __vec_sorter *s, size_t k)
+{
+	if (k <= s->tmpcap)
+		return VEC_SUCCESS;
+
+	size_t cap = 2 * s->tmpcap > k ? 2 * s->tmpcap : k;
+	cap	   = cap < (s->v->size / 2) + 1 ? cap : (s->v->size / 2) + 1;
+	char *tmp  = __vec_alloc(cap * s->sz);
+	if (!tmp)
+		return VEC_ENOMEM;
+	if (s->tmp)
+		__vec_dealloc(s->tmp);
+	s->tmp	  = tmp;
+	s->tmpcap = cap;
+	return VEC_SUCCESS;
+}
+
+/*
+ * Merge the run of na slots at base with the following run of nb, the
+ * first one copied out and merged from the front. Once a run is taken
+ * min_gallop times in a row both runs are galloped over instead, for as
+ * long as that moves blocks of VEC_SORT_GALLOP slots.
+ */
+static void __vector_merge_lo(struct __vec_sorter *s, char *base, size_t na, size_t nb)
+{
+	size_t sz = s->sz;
+	char *a = s->tmp, *b = base + (na * sz), *d = base;
+	memcpy(a, base, na * sz);
+
+	while (na && nb) {
+		size_t wa = 0, wb = 0;
+		while (na && nb && wa < s->min_gallop && wb < s->min_gallop) {
+			if (__vector_sort_cmp(s, b, a) < 0) {
+				memcpy(d, b, sz);
+				b += sz;
+				nb--;
+				wb++;
+				wa = 0;
+			} else {
+				memcpy(d, a, sz);
+				a += sz;
+				na--;
+				wa++;
+				wb = 0;
+			}
+			d += sz;
+		}
+
+		while (na && nb) {
+			size_t k = __vector_gallop(s, b, a, na, true, false);
+			memcpy(d, a, k * sz);
+			a += k * sz;
+			d += k * sz;
+			na -= k;
+			if (!na)
+				break;
+
+			size_t j = __vector_gallop(s, a, b, nb, false, false);
+			memmove(d, b, j * sz);
+			b += j * sz;
+			d += j * sz;
+			nb -= j;
+
+			if (k < VEC_SORT_GALLOP && j < VEC_SORT_GALLOP) {
+				s->min_gallop++;
+				break;
+			}
+			if (s->min_gallop > 1)
+				s->min_gallop--;
+		}
+	}
+
+	/* what is left of the second run is in place already */
+	memcpy(d, a, na * sz);
+}
+
+/* as __vector_merge_lo(), the second run copied out and merged from the back */
+static void __vector_merge_hi(struct __vec_sorter *s, char *base, size_t na, size_t nb)
+{
+	size_t sz = s->sz;
+	memcpy(s->tmp, base + (na * sz), nb * sz);
+
+	/* one past the last slot of each run, and of the output */
+	char *a = base + (na * sz), *b = s->tmp + (nb * sz), *d = base + ((na + nb) * sz);
+	while (na && nb) {
+		size_t wa = 0, wb = 0;
+		while (na && nb && wa < s->min_gallop && wb < s->min_gallop) {
+			d -= sz;
+			if (__vector_sort_cmp(s, b - sz, a - sz) < 0) {
+				a -= sz;
+				memcpy(d, a, sz);
+				na--;
+				wa++;
+				wb = 0;
+			} else {
+				b -= sz;
+				memcpy(d, b, sz);
+				nb--;
+				wb++;
+				wa = 0;
+			}
+		}
+
+		while (na && nb) {
+			size_t k = na - __vector_gallop(s, b - sz, base, na, true, true);
+			a -= k * sz;
+			d -= k * sz;
+			memmove(d, a, k * sz);
+			na -= k;
+			if (!na)
+				break;
+
+			size_t j = nb - __vector_gallop(s, a - sz, s->tmp, nb, false, true);
+			b -= j * sz;
+			d -= j * sz;
+			memcpy(d, b, j * sz);
+			nb -= j;
+
+			if (k < VEC_SORT_GALLOP && j < VEC_SORT_GALLOP) {
+				s->min_gallop++;
+				break;
+			}
+			if (s->min_gallop > 1)
+				s->min_gallop--;
+		}
+	}
+
+	/* what is left of the first run is in place already */
+	memcpy(base, s->tmp, nb * sz);
+}
+
+/*
+ * Merge the sorted runs [base, base + na) and the nb slots after it.
+ * Slots of the first run up to the first of the second, and those of the
+ * second from the last of the first on, do not move and are left out.
+ */
+static int __vector_merge_runs(struct __vec_sorter *s, char *base, size_t na, size_t nb)
+{
+	size_t sz = s->sz;
+	char *b	  = base + (na * sz);
+	if (__vector_sort_cmp(s, b - sz, b) <= 0)
+		return VEC_SUCCESS;
+
+	size_t k = __vector_gallop(s, b, base, na, true, false);
+	base += k * sz;
+	na -= k;
+	nb = __vector_gallop(s, b - sz, b, nb, false, true);
+
+	int res = __vector_sort_reserve(s, na < nb ? na : nb);
+	if (res != VEC_SUCCESS)
+		return res;
+	if (na <= nb)
+		__vector_merge_lo(s, base, na, nb);
+	else
+		__vector_merge_hi(s, base, na, nb);
+	return VEC_SUCCESS;
+}
+
+/* length of the run at the start of the n slots of base, reversed if descending */
+static size_t __vector_sort_run(struct __vec_sorter *s, char *base, size_t n)
+{
+	size_t sz = s->sz, i = 2;
+	if (n < 2)
+		return n;
+
+	if (__vector_sort_cmp(s, base + sz, base) >= 0) {
+		for (; i < n && __vector_sort_cmp(s, base + (i * sz), base + ((i - 1) * sz)) >= 0; i++)
+			;
+		return i;
+	}
+
+	/* strictly descending, so reversing keeps equal objects in order */
+	for (; i < n && __vector_sort_cmp(s, base + (i * sz), base + ((i - 1) * sz)) < 0; i++)
+		;
+	for (size_t l = 0, r = i - 1; l < r; l++, r--) {
+		memcpy(s->pivot, base + (l * sz), sz);
+		memcpy(base + (l * sz), base + (r * sz), sz);
+		memcpy(base + (r * sz), s->pivot, sz);
+	}
+	return i;
+}
+
+/* extend the sorted first k of the n slots of base to all n, by binary insertion */
+static void __vector_insertion_sort(struct __vec_sorter *s, char *base, size_t k, size_t n)
+{
+	size_t sz = s->sz;
+	for (; k < n; k++) {
+		memcpy(s->pivot, base + (k * sz), sz);
+
+		size_t lo = 0, hi = k;
+		while (lo < hi) {
+			size_t m = lo + ((hi - lo) / 2);
+			if (__vector_sort_cmp(s, s->pivot, base + (m * sz)) < 0)
+				hi = m;
+			else
+				lo = m + 1;
+		}
+		memmove(base + ((lo + 1) * sz), base + (lo * sz), (k - lo) * sz);
+		memcpy(base + (lo * sz), s->pivot, sz);
+	}
+}
+
+/*
+ * Depth of the boundary between the adjacent runs [s1, s1 + n1) and
+ * [s1 + n1, s1 + n1 + n2) of n slots: the first bit at which the binary
+ * fractions of their midpoints, relative to n, differ.
+ */
+static unsigned __vector_node_power(size_t n, size_t s1, size_t n1, size_t n2)
+{
+	size_t a = (2 * s1) + n1, b = a + n1 + n2;
+	unsigned power = 0;
+	for (;;) {
+		power++;
+		if (a >= n) {
+			a -= n;
+			b -= n;
+		} else if (b >= n) {
+			break;
+		}
+		a <<= 1;
+		b <<= 1;
+	}
+	return power;
+}
+
+/* runs shorter than this are extended by insertion, between 32 and 64 so n / minrun is close to a power of 2 */
+static size_t __vector_min_run(size_t n)
+{
+	size_t r = 0;
+	for (; n >= 64; n >>= 1)
+		r |= n & 1;
+	return n + r;
+}
+
+static void *__vector_gather_slice(void *arg)
+{
+	struct __vec_gather_slice *s = arg;
+	for (size_t i = s->begin; i < s->end; i++)
+		memcpy(s->dst + (i * s->slotsz), s->src + (s->perm[i] * s->slotsz), s->slotsz);
+	return NULL;
+}
+
+/*
+ * Gather the objects of v into a new array by perm, split into nthreads
+ * slices, the calling thread takes the last one.
+ */
+static int __vector_gather(struct vector *v, const size_t *perm, size_t nthreads)
+{
+	char *dst = __vector_zalloc(v->capacity, v->slotsz);
+	if (!dst)
+		return VEC_ENOMEM;
+
+	struct __vec_gather_slice slices[nthreads];
+	pthread_t threads[nthreads];
+	bool spawned[nthreads];
+
+	size_t step = v->size / nthreads;
+	for (size_t t = 0; t < nthreads; t++) {
+		slices[t] = (struct __vec_gather_slice){
+			v->data, dst, perm, v->slotsz, t * step, t == nthreads - 1 ? v->size : (t + 1) * step
+		};
+
+		/* run the slice inline when no thread is available */
+		spawned[t] = t < nthreads - 1
+			     && pthread_create(&threads[t], NULL, __vector_gather_slice, &slices[t]) == 0;
+		if (!spawned[t])
+			__vector_gather_slice(&slices[t]);
+	}
+
+	for (size_t t = 0; t < nthreads; t++) {
+		if (spawned[t])
+			pthread_join(threads[t], NULL);
+	}
+
+	__vector_moving(v);
+	__vec_dealloc(v->data);
+	v->data = dst;
+	return VEC_SUCCESS;
 }
 
-static size_t __vector_default_growby(size_t sz)
+/*
+ * Move the objects of v in place so that the i-th one is the former
+ * perm[i]-th, a cycle of the permutation at a time. left has a bit set
+ * for each index not moved yet.
+ */
+static int __vector_permute_cycles(struct vector *v, const size_t *perm, uint64_t *left)
 {
-	// first time grow for empty vectors
-	if (sz == 0)
-		return 1;
+	char *tmp = __vec_alloc(v->slotsz);
+	if (!tmp)
+		return VEC_ENOMEM;
 
-	// We need to keep the size as a power of 2
-	if ((sz & (sz - 1)) == 0)
-		return sz << 1;
+	size_t sz = v->slotsz;
+	for (size_t w = 0; w < (v->size + 63) / 64; w++) {
+		while (left[w]) {
+			size_t first = (w * 64) + __builtin_ctzll(left[w]), i = first;
+			left[w] &= left[w] - 1;
+			if (perm[first] == first)
+				continue;
+
+			memcpy(tmp, v->data + (first * sz), sz);
+			for (size_t j = perm[i]; j != first; i = j, j = perm[j]) {
+				memcpy(v->data + (i * sz), v->data + (j * sz), sz);
+				left[j / 64] &= ~(UINT64_C(1) << (j % 64));
+			}
+			memcpy(v->data + (i * sz), tmp, sz);
+		}
+	}
 
-	size_t y = 1;
-	while (y > sz)
-		y <<= 1;
-	return y;
+	__vec_dealloc(tmp);
+	return VEC_SUCCESS;
 }
 
-static int __vector_realloc(struct vector *v, size_t atleast)
+/*
+ * Insert the k objects of elems before the positions given by order, sorted
+ * by position, in one backward pass: the objects after the last position
+ * move first, straight to their final slots, so each object moves once.
+ * Capacity for all of them is already reserved and bodies holds a fresh
+ * body per object if the vector is indirect.
+ */
+static void __vector_merge_batch(struct vector *v, const struct __vec_keyed *order, const char *elems,
+				 size_t k, char **bodies)
 {
-	size_t cursz = atleast ? atleast : v->capacity;
-	size_t newsz = __vec_growby(cursz) * v->objsz;
-
-	if (newsz <= v->capacity)
-		return VEC_EMAXED;
+	size_t end = v->size;
+	for (size_t j = k; j-- > 0;) {
+		size_t pos = order[j].key;
+		memmove(v->data + ((pos + j + 1) * v->slotsz),
+			v->data + (pos * v->slotsz),
+			(end - pos) * v->slotsz);
+		end = pos;
+
+		char *slot	= v->data + ((pos + j) * v->slotsz);
+		const char *src = elems + (order[j].idx * v->objsz);
+		if (bodies) {
+			*(char **)slot = bodies[j];
+			slot	       = bodies[j];
+		}
+		memcpy(slot, src, v->objsz);
+	}
+}
 
-	char *newp = __vec_alloc(newsz);
-	if (!newp)
-		return VEC_ENOMEM;
+/*
+ * Lower bounds of a group of keys, searched in lockstep. Every search over
+ * n objects takes the same steps, so each step first prefetches the probe
+ * of every key and only then compares them, overlapping the misses of the
+ * whole group instead of taking them one after the other.
+ */
+static void __vector_lower_bound_group(const char *data, size_t n, size_t objsz,
+				       int (*cmp)(const void *, const void *),
+				       const char *keys, size_t keysz, size_t g, size_t *out)
+{
+	size_t base[VEC_BATCH_GROUP] = { 0 };
+
+	for (size_t len = n; len > 1;) {
+		size_t half = len / 2;
+		for (size_t i = 0; i < g; i++)
+			__builtin_prefetch(data + ((base[i] + half) * objsz));
+		for (size_t i = 0; i < g; i++) {
+			if (cmp(keys + (i * keysz), data + ((base[i] + half) * objsz)) > 0)
+				base[i] += half;
+		}
+		len -= half;
+	}
 
-	memcpy(newp, v->data, v->size);
-	free(v->data);
-	v->data	    = newp;
-	v->capacity = newsz;
-	return VEC_SUCCESS;
+	for (size_t i = 0; i < g; i++)
+		out[i] = base[i] + (n > 0 && cmp(keys + (i * keysz), data + (base[i] * objsz)) > 0);
 }
 
 allocator_fn vector_allocator(allocator_fn alloc)
 {
 	void *(*old)(size_t) = __vec_alloc;
-	if (alloc)
+	if (alloc) {
 		__vec_alloc = alloc;
+		// calloc does not pair with a foreign deallocator
+		__vec_calloc = NULL;
+	}
+	return old;
+}
+
+callocator_fn vector_callocator(callocator_fn zalloc)
+{
+	void *(*old)(size_t, size_t) = __vec_calloc;
+	if (zalloc)
+		__vec_calloc = zalloc;
 	return old;
 }
 
@@ -147,35 +1895,110 @@ struct vector *vector_new(size_t nobj, size_t objsz)
 	char *arr = NULL;
 
 	if (nobj > 0) {
-		arr = __vec_alloc(nobj * objsz);
+		arr = __vector_zalloc(nobj, objsz);
 		if (!arr) {
 			__vec_dealloc(v);
 			return NULL;
 		}
-		memset(arr, 0, nobj * objsz);
 	}
 
 	v->data	    = arr;
+	v->old_data = NULL;
+	v->old_size = 0;
+	v->migrated = 0;
+	v->pregrow  = NULL;
 	v->size	    = 0;
 	v->objsz    = objsz;
+	v->slotsz   = objsz;
+	v->pool	    = NULL;
 	v->capacity = nobj;
 	v->mutable  = true;
 	// v->lock	    = (pthread_mutex_t)PTHREAD_MUTEX_INITIALIZER;
 
+	/* incremental growth and pre-growth are off until asked for */
+	v->migrate_step = 0;
+	v->pregrow_mark = 0;
+	v->tag		= NULL;
+	v->cold		= NULL;
+	v->moved	= NULL;
+	v->moved_arg	= NULL;
+
+	return v;
+}
+
+struct vector *vector_new_indirect(size_t nobj, size_t objsz)
+{
+	struct vector *v = vector_new(nobj, sizeof(char *));
+	if (!v)
+		return NULL;
+
+	v->pool = __vector_pool_new(objsz);
+	if (!v->pool) {
+		vector_free(&v, NULL);
+		return NULL;
+	}
+	v->objsz = objsz;
+
+	return v;
+}
+
+struct vector *vector_new_tagged(const char *tag, size_t nobj, size_t objsz)
+{
+	ASSERT_PRECONDITION(tag != NULL, return vector_new(nobj, objsz));
+
+	pthread_mutex_lock(&__vec_tags_lock);
+	struct __vec_tag *t = __vector_tag_lookup(tag);
+	size_t hint	    = t ? __vector_tag_hint(t) : 0;
+	pthread_mutex_unlock(&__vec_tags_lock);
+
+	/* objects are zero pages until written, over-reserving is cheap */
+	struct vector *v = NULL;
+	if (hint > nobj && (!objsz || hint <= SIZE_MAX / objsz))
+		v = vector_new(hint, objsz);
+	if (!v)
+		v = vector_new(nobj, objsz);
+	if (v)
+		v->tag = t;
+
 	return v;
 }
 
+unsigned vector_tag_percentile(unsigned pct)
+{
+	pthread_mutex_lock(&__vec_tags_lock);
+	unsigned old = __vec_tag_pct;
+	if (pct > 0 && pct <= 100)
+		__vec_tag_pct = pct;
+	pthread_mutex_unlock(&__vec_tags_lock);
+	return old;
+}
+
 void vector_free(struct vector **vp, void (*elem_dtor)(void *))
 {
 	ASSERT_PRECONDITION((vp && (*vp)), return );
 
 	struct vector *v = *vp;
 
-	if (v->data && elem_dtor) {
-		for (size_t i = 0; i < v->size; i++)
-			elem_dtor(v->data + (i * v->objsz));
+	if (v->tag) {
+		pthread_mutex_lock(&__vec_tags_lock);
+		v->tag->counts[__vector_tag_bucket(v->size)]++;
+		v->tag->n++;
+		pthread_mutex_unlock(&__vec_tags_lock);
 	}
 
+	__vector_pregrow_cancel(v);
+	__vector_destroy_objects(v, elem_dtor, 1);
+
+	if (v->old_data)
+		__vec_dealloc(v->old_data);
+
+	if (v->pool)
+		__vector_pool_free(v->pool);
+
+	if (v->cold)
+		__vector_cold_free(v);
+
+	__vector_moving(v);
 	if (v->data)
 		__vec_dealloc(v->data);
 
@@ -184,6 +2007,64 @@ void vector_free(struct vector **vp, void (*elem_dtor)(void *))
 	*vp = NULL;
 }
 
+void vector_free_async(struct vector **vp, void (*elem_dtor)(void *))
+{
+	ASSERT_PRECONDITION((vp && (*vp)), return );
+
+	struct __vec_reclaim *r = __vec_alloc(sizeof *r);
+	if (r) {
+		r->job.fn    = __vector_reclaim_job;
+		r->v	     = *vp;
+		r->elem_dtor = elem_dtor;
+
+		if (__vector_worker_submit(&__vec_reclaimer, &r->job)) {
+			*vp = NULL;
+			return;
+		}
+		__vec_dealloc(r);
+	}
+
+	/* no reclaimer available, release it right here */
+	vector_free(vp, elem_dtor);
+}
+
+void vector_free_async_wait(void)
+{
+	__vector_worker_wait(&__vec_reclaimer);
+}
+
+size_t vector_reclaimer_threads(size_t nthreads)
+{
+	if (nthreads)
+		return atomic_exchange(&__vec_reclaim_threads, nthreads);
+	return atomic_load(&__vec_reclaim_threads);
+}
+
+int vector_incremental_growth(struct vector *v, size_t max_bytes)
+{
+	ASSERT_PRECONDITION(v != NULL, return VEC_EINVAL);
+
+	if (max_bytes == 0) {
+		__vector_settle(v);
+		v->migrate_step = 0;
+		return VEC_SUCCESS;
+	}
+
+	v->migrate_step = v->slotsz && max_bytes > v->slotsz ? max_bytes / v->slotsz : 1;
+	return VEC_SUCCESS;
+}
+
+int vector_pregrowth(struct vector *v, unsigned high_water)
+{
+	ASSERT_PRECONDITION(v != NULL && high_water <= 100, return VEC_EINVAL);
+
+	if (high_water == 0)
+		__vector_pregrow_cancel(v);
+
+	v->pregrow_mark = high_water;
+	return VEC_SUCCESS;
+}
+
 size_t vector_size(struct vector *v)
 {
 	ASSERT_PRECONDITION(v != NULL, return 0);
@@ -196,6 +2077,36 @@ size_t vector_capacity(struct vector *v)
 	return v->capacity;
 }
 
+size_t vector_object_size(struct vector *v)
+{
+	ASSERT_PRECONDITION(v != NULL, return 0);
+	return v->objsz;
+}
+
+void *vector_data(struct vector *v)
+{
+	ASSERT_PRECONDITION(__vector_is_valid(v), return NULL);
+
+	__vector_settle(v);
+	return v->data;
+}
+
+int vector_array_listener(struct vector *v, void (*moved)(void *), void *arg)
+{
+	ASSERT_PRECONDITION(v != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(moved == NULL || v->moved == NULL, return VEC_EINVAL);
+
+	v->moved     = moved;
+	v->moved_arg = arg;
+	return VEC_SUCCESS;
+}
+
+bool vector_is_indirect(struct vector *v)
+{
+	ASSERT_PRECONDITION(v != NULL, return false);
+	return v->pool != NULL;
+}
+
 bool vector_is_empty(struct vector *v)
 {
 	ASSERT_PRECONDITION(v != NULL, return true);
@@ -214,9 +2125,121 @@ int vector_reserve(struct vector *v, size_t size)
 	ASSERT_PRECONDITION(v != NULL && size > 0, return VEC_EINVAL);
 	ASSERT_PRECONDITION(v->mutable, return VEC_EIMMUT);
 
+	if (size <= v->capacity)
+		return VEC_SUCCESS;
+
 	return __vector_realloc(v, size);
 }
 
+int vector_resize(struct vector *v, size_t size)
+{
+	ASSERT_PRECONDITION(__vector_is_valid(v), return VEC_EINVAL);
+	ASSERT_PRECONDITION(v->mutable, return VEC_EIMMUT);
+
+	if (size > v->capacity) {
+		int res = __vector_realloc(v, size);
+		if (res != VEC_SUCCESS)
+			return res;
+	}
+
+	/* objects past the size are kept zeroed */
+	while (v->size > size) {
+		int res = vector_erase(v, v->size - 1);
+		if (res != VEC_SUCCESS)
+			return res;
+	}
+
+	v->size = size;
+	__vector_pregrow_start(v);
+	return VEC_SUCCESS;
+}
+
+int vector_cold_compression(struct vector *v, size_t cache_blocks)
+{
+	ASSERT_PRECONDITION(__vector_is_valid(v) && !v->pool, return VEC_EINVAL);
+
+	if (cache_blocks == 0) {
+		if (v->cold) {
+			__vector_cold_thaw(v);
+			__vector_cold_free(v);
+		}
+		return VEC_SUCCESS;
+	}
+
+	if (!v->cold) {
+		struct __vec_cold *c = __vec_alloc(sizeof *c);
+		if (!c)
+			return VEC_ENOMEM;
+
+		long pagesz = sysconf(_SC_PAGESIZE);
+		*c	    = (struct __vec_cold){ .pagesz = pagesz > 0 ? pagesz : 4096 };
+		c->blocksz  = (VEC_COLD_BLOCK + c->pagesz - 1) / c->pagesz * c->pagesz;
+		c->scratch  = __vec_alloc(c->blocksz);
+		v->cold	    = c;
+		if (!c->scratch) {
+			__vector_cold_free(v);
+			return VEC_ENOMEM;
+		}
+	}
+
+	struct __vec_cold *c = v->cold;
+	size_t *cache	     = __vec_alloc(cache_blocks * sizeof *cache);
+	if (!cache)
+		return VEC_ENOMEM;
+
+	/* the oldest blocks past the new limit are released */
+	size_t drop = c->ncache > cache_blocks ? c->ncache - cache_blocks : 0;
+	for (size_t i = 0; i < drop; i++)
+		__vector_cold_release(v, c->cache[i]);
+	c->ncache -= drop;
+	if (c->cache) {
+		memcpy(cache, c->cache + drop, c->ncache * sizeof *cache);
+		__vec_dealloc(c->cache);
+	}
+	c->cache     = cache;
+	c->cache_cap = cache_blocks;
+	return VEC_SUCCESS;
+}
+
+int vector_compress_cold(struct vector *v)
+{
+	ASSERT_PRECONDITION(__vector_is_valid(v) && v->cold, return VEC_EINVAL);
+
+	/* neither the grower nor a pending move may read the array meanwhile */
+	__vector_pregrow_cancel(v);
+	__vector_migrate(v, SIZE_MAX);
+	if (!v->data)
+		return VEC_SUCCESS;
+
+	struct __vec_cold *c = v->cold;
+	int res		     = __vector_cold_layout(v);
+	for (size_t b = 0; b < c->nblocks && res == VEC_SUCCESS; b++) {
+		struct __vec_block *k = &c->blocks[b];
+		if (!k->touched && k->z && !k->released) {
+			__vector_cold_uncache(c, b);
+			__vector_cold_release(v, b);
+		} else if (!k->touched && !k->z && !k->raw) {
+			res = __vector_cold_freeze(v, b);
+		}
+		k->touched = false;
+	}
+	return res;
+}
+
+int vector_cold_stats(struct vector *v, struct vector_cold_stats *st)
+{
+	ASSERT_PRECONDITION(v != NULL && v->cold && st != NULL, return VEC_EINVAL);
+
+	struct __vec_cold *c = v->cold;
+	*st		     = (struct vector_cold_stats){
+			    .block_size = c->blocksz,
+			    .released	= c->nreleased,
+			    .cached	= c->ncache,
+			    .zbytes	= c->zbytes,
+	};
+	return VEC_SUCCESS;
+}
+
 int vector_make_immutable(struct vector *v)
 {
 	return vector_fit(v, true);
@@ -226,14 +2249,21 @@ int vector_fit(struct vector *v, bool immutable)
 {
 	ASSERT_PRECONDITION(__vector_is_valid(v), return VEC_EINVAL);
 
+	__vector_pregrow_cancel(v);
+	__vector_settle(v);
+
 	if (v->size < v->capacity) {
-		char *fitp = __vec_alloc(v->size);
-		if (!fitp)
-			return VEC_ENOMEM;
+		char *fitp = NULL;
+		if (v->size > 0) {
+			fitp = __vec_alloc(v->size * v->slotsz);
+			if (!fitp)
+				return VEC_ENOMEM;
+			memcpy(fitp, v->data, v->size * v->slotsz);
+		}
 
-		memcpy(fitp, v->data, v->size);
 		v->capacity = v->size;
-		free(v->data);
+		__vector_moving(v);
+		__vec_dealloc(v->data);
 		v->data = fitp;
 	}
 	v->mutable = !immutable;
@@ -246,11 +2276,31 @@ int vector_get(struct vector *v, size_t idx, void *p)
 	ASSERT_PRECONDITION(__vector_is_valid(v) && p != NULL, return VEC_EINVAL);
 	ASSERT_PRECONDITION(__vector_idx_is_valid(v, idx), return VEC_ERANGE);
 
-	char *el = __vector_idx_to_ptr(v, idx);
-	memcpy(p, el, v->objsz);
+	__vector_migrate(v, v->migrate_step);
+	if (v->cold)
+		__vector_cold_touch(v, idx, false);
+
+	char *el = __vector_obj_ptr(v, idx, false);
+	if (el)
+		memcpy(p, el, v->objsz);
+	else
+		memset(p, 0, v->objsz);
 	return VEC_SUCCESS;
 }
 
+void *vector_at(struct vector *v, size_t idx)
+{
+	ASSERT_PRECONDITION(__vector_is_valid(v), return NULL);
+	ASSERT_PRECONDITION(__vector_idx_is_valid(v, idx), return NULL);
+
+	__vector_migrate(v, v->migrate_step);
+	__vector_pregrow_touch(v, idx);
+	if (v->cold)
+		__vector_cold_touch(v, idx, true);
+
+	return __vector_obj_ptr(v, idx, true);
+}
+
 int vector_insert(struct vector *v, size_t idx, void *p)
 {
 	ASSERT_PRECONDITION(__vector_is_valid(v) && p != NULL, return VEC_EINVAL);
@@ -258,10 +2308,17 @@ int vector_insert(struct vector *v, size_t idx, void *p)
 	/* try to resize the vector if idx exceed the capacity */
 	int res;
 	if (__vector_needs_realloc_for(v, idx)
-	    && (res = __vector_realloc(v, VEC_NEXTSIZE)) != VEC_SUCCESS)
+	    && (res = __vector_realloc(v, idx + 1)) != VEC_SUCCESS)
 		return res;
 
-	char *el = __vector_idx_to_ptr(v, idx);
+	__vector_migrate(v, v->migrate_step);
+	__vector_pregrow_touch(v, idx);
+	if (v->cold)
+		__vector_cold_touch(v, idx, true);
+
+	char *el = __vector_obj_ptr(v, idx, true);
+	if (!el)
+		return VEC_ENOMEM;
 	memcpy(el, p, v->objsz);
 
 	/* when idx exceed current size, advance size to this index.
@@ -270,6 +2327,8 @@ int vector_insert(struct vector *v, size_t idx, void *p)
 	if (v->size <= idx)
 		v->size = idx + 1;
 
+	__vector_pregrow_start(v);
+
 	return VEC_SUCCESS;
 }
 
@@ -279,8 +2338,19 @@ int vector_erase(struct vector *v, size_t idx)
 	ASSERT_PRECONDITION(v->mutable, return VEC_EIMMUT);
 	ASSERT_PRECONDITION(__vector_idx_is_valid(v, idx), return VEC_ERANGE);
 
-	char *el = __vector_idx_to_ptr(v, idx);
-	memset(el, 0, v->objsz);
+	__vector_pregrow_touch(v, idx);
+	if (v->cold)
+		__vector_cold_touch(v, idx, true);
+
+	if (v->pool) {
+		/* objects without a body read as zeros */
+		char **slot = (char **)__vector_idx_to_ptr(v, idx);
+		if (*slot)
+			__vector_pool_put(v->pool, *slot);
+		*slot = NULL;
+	} else {
+		memset(__vector_idx_to_ptr(v, idx), 0, v->objsz);
+	}
 
 	if (idx == v->size - 1)
 		v->size--;
@@ -303,6 +2373,329 @@ int vector_pop(struct vector *v, void *p)
 	return vector_erase(v, v->size - 1);
 }
 
+int vector_insert_batch(struct vector *v, const size_t *positions, const void *elems, size_t k)
+{
+	ASSERT_PRECONDITION(__vector_is_valid(v), return VEC_EINVAL);
+	ASSERT_PRECONDITION(k == 0 || (positions != NULL && elems != NULL), return VEC_EINVAL);
+	ASSERT_PRECONDITION(v->mutable, return VEC_EIMMUT);
+
+	for (size_t j = 0; j < k; j++)
+		ASSERT_PRECONDITION(positions[j] <= v->size, return VEC_ERANGE);
+	if (k == 0)
+		return VEC_SUCCESS;
+	if (k > SIZE_MAX - v->size)
+		return VEC_EMAXED;
+
+	int res;
+	if (v->size + k > v->capacity && (res = __vector_realloc(v, v->size + k)) != VEC_SUCCESS)
+		return res;
+	__vector_settle(v);
+
+	struct __vec_keyed *a	= __vec_alloc(k * sizeof *a);
+	struct __vec_keyed *tmp = __vec_alloc(k * sizeof *tmp);
+	char **bodies		= v->pool ? __vec_alloc(k * sizeof *bodies) : NULL;
+	size_t nbodies		= 0;
+	res			= a && tmp && (bodies || !v->pool) ? VEC_SUCCESS : VEC_ENOMEM;
+
+	/* take every body first, so that a failure leaves the vector as is */
+	for (; v->pool && res == VEC_SUCCESS && nbodies < k; nbodies++) {
+		if (!(bodies[nbodies] = __vector_pool_get(v->pool, v->objsz)))
+			res = VEC_ENOMEM;
+	}
+
+	if (res == VEC_SUCCESS) {
+		for (size_t j = 0; j < k; j++)
+			a[j] = (struct __vec_keyed){ positions[j], j };
+		struct __vec_keyed *order = __vector_radix_keys(a, tmp, k);
+
+		__vector_pregrow_touch(v, order[0].key);
+		__vector_merge_batch(v, order, elems, k, bodies);
+		v->size += k;
+		__vector_pregrow_start(v);
+	} else if (bodies) {
+		while (nbodies-- > 0) {
+			if (bodies[nbodies])
+				__vector_pool_put(v->pool, bodies[nbodies]);
+		}
+	}
+
+	if (a)
+		__vec_dealloc(a);
+	if (tmp)
+		__vec_dealloc(tmp);
+	if (bodies)
+		__vec_dealloc(bodies);
+	return res;
+}
+
+int vector_radix_sort(struct vector *v, uint64_t (*key)(void *, void *), void *arg, struct vector *perm)
+{
+	ASSERT_PRECONDITION(__vector_is_valid(v) && key != NULL && perm != v, return VEC_EINVAL);
+	ASSERT_PRECONDITION(perm == NULL || (perm->objsz == sizeof(size_t) && !perm->pool), return VEC_EINVAL);
+	ASSERT_PRECONDITION(v->mutable, return VEC_EIMMUT);
+
+	__vector_settle(v);
+
+	size_t n		= v->size;
+	struct __vec_keyed *a	= __vec_alloc((n ? n : 1) * sizeof *a);
+	struct __vec_keyed *tmp = __vec_alloc((n ? n : 1) * sizeof *tmp);
+	int res			= a && tmp ? VEC_SUCCESS : VEC_ENOMEM;
+
+	/* the permutation is sized before v is reordered, so that a failure leaves v as is */
+	size_t nperm = perm ? perm->size : 0;
+	if (res == VEC_SUCCESS && perm)
+		res = vector_resize(perm, n);
+
+	/* bodies created for indirect objects are written to their slots */
+	__vector_pregrow_touch(v, 0);
+	for (size_t i = 0; i < n && res == VEC_SUCCESS; i++) {
+		char *el = __vector_obj_ptr(v, i, true);
+		if (!el)
+			res = VEC_ENOMEM;
+		else
+			a[i] = (struct __vec_keyed){ key(el, arg), i };
+	}
+
+	struct __vec_keyed *sorted = NULL;
+	if (res == VEC_SUCCESS) {
+		sorted = __vector_radix_keys(a, tmp, n);
+		res    = __vector_reorder(v, sorted);
+	}
+	if (res == VEC_SUCCESS && perm) {
+		size_t *idx = vector_data(perm);
+		for (size_t i = 0; i < n; i++)
+			idx[i] = sorted[i].idx;
+	} else if (perm) {
+		vector_resize(perm, nperm);
+	}
+
+	if (a)
+		__vec_dealloc(a);
+	if (tmp)
+		__vec_dealloc(tmp);
+	return res;
+}
+
+int vector_stable_sort(struct vector *v, int (*cmp)(const void *, const void *))
+{
+	ASSERT_PRECONDITION(__vector_is_valid(v) && cmp != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(v->mutable, return VEC_EIMMUT);
+
+	__vector_settle(v);
+
+	size_t n = v->size;
+	if (n < 2)
+		return VEC_SUCCESS;
+
+	struct __vec_sorter s = { v, cmp, NULL, v->slotsz, NULL, 0, NULL, VEC_SORT_GALLOP };
+	s.pivot		      = __vec_alloc(s.sz);
+	if (v->pool)
+		s.zero = __vector_zalloc(1, v->objsz);
+	int res = s.pivot && (s.zero || !v->pool) ? VEC_SUCCESS : VEC_ENOMEM;
+
+	/* runs waiting to be merged, each with the power of the boundary on its left */
+	struct __vec_pending stack[VEC_SORT_STACK];
+	size_t top = 0, minrun = __vector_min_run(n);
+
+	__vector_pregrow_touch(v, 0);
+	for (size_t lo = 0; lo < n && res == VEC_SUCCESS;) {
+		char *base = v->data + (lo * s.sz);
+		size_t len = __vector_sort_run(&s, base, n - lo);
+		if (len < minrun) {
+			size_t force = n - lo < minrun ? n - lo : minrun;
+			__vector_insertion_sort(&s, base, len, force);
+			len = force;
+		}
+
+		unsigned power = top ? __vector_node_power(n, stack[top - 1].start, stack[top - 1].len, len) : 0;
+		while (top > 1 && stack[top - 1].power > power && res == VEC_SUCCESS) {
+			struct __vec_pending *x = &stack[top - 2], *y = &stack[top - 1];
+			res = __vector_merge_runs(&s, v->data + (x->start * s.sz), x->len, y->len);
+			x->len += y->len;
+			top--;
+		}
+
+		stack[top++] = (struct __vec_pending){ lo, len, power };
+		lo += len;
+	}
+
+	while (top > 1 && res == VEC_SUCCESS) {
+		struct __vec_pending *x = &stack[top - 2], *y = &stack[top - 1];
+		res = __vector_merge_runs(&s, v->data + (x->start * s.sz), x->len, y->len);
+		x->len += y->len;
+		top--;
+	}
+
+	if (s.tmp)
+		__vec_dealloc(s.tmp);
+	if (s.pivot)
+		__vec_dealloc(s.pivot);
+	if (s.zero)
+		__vec_dealloc(s.zero);
+	return res;
+}
+
+int vector_cmp_i32(const void *a, const void *b)
+{
+	uint64_t x = __vector_key_i32(a), y = __vector_key_i32(b);
+	return (x > y) - (x < y);
+}
+
+int vector_cmp_u32(const void *a, const void *b)
+{
+	uint64_t x = __vector_key_u32(a), y = __vector_key_u32(b);
+	return (x > y) - (x < y);
+}
+
+int vector_cmp_i64(const void *a, const void *b)
+{
+	uint64_t x = __vector_key_i64(a), y = __vector_key_i64(b);
+	return (x > y) - (x < y);
+}
+
+int vector_cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = __vector_key_u64(a), y = __vector_key_u64(b);
+	return (x > y) - (x < y);
+}
+
+int vector_cmp_float(const void *a, const void *b)
+{
+	uint64_t x = __vector_key_float(a), y = __vector_key_float(b);
+	return (x > y) - (x < y);
+}
+
+int vector_cmp_double(const void *a, const void *b)
+{
+	uint64_t x = __vector_key_double(a), y = __vector_key_double(b);
+	return (x > y) - (x < y);
+}
+
+int vector_argsort(struct vector *v, int (*cmp)(const void *, const void *), struct vector *perm)
+{
+	ASSERT_PRECONDITION(__vector_is_valid(v) && cmp != NULL && perm != NULL && perm != v, return VEC_EINVAL);
+	ASSERT_PRECONDITION(perm->objsz == sizeof(size_t) && !perm->pool, return VEC_EINVAL);
+
+	const struct __vec_numeric *num = NULL;
+	for (size_t i = 0; i < sizeof __vec_numerics / sizeof *__vec_numerics; i++) {
+		if (__vec_numerics[i].cmp == cmp)
+			num = &__vec_numerics[i];
+	}
+	ASSERT_PRECONDITION(num == NULL || num->objsz == v->objsz, return VEC_EINVAL);
+
+	__vector_settle(v);
+
+	size_t n = v->size;
+	int res	 = vector_resize(perm, n);
+	if (res != VEC_SUCCESS || n == 0)
+		return res;
+
+	size_t *idx = vector_data(perm);
+	char *zero  = v->pool ? __vector_zalloc(1, v->objsz) : NULL;
+	if (v->pool && !zero)
+		return VEC_ENOMEM;
+
+	if (num) {
+		struct __vec_keyed *a	= __vec_alloc(n * sizeof *a);
+		struct __vec_keyed *tmp = __vec_alloc(n * sizeof *tmp);
+		if (a && tmp) {
+			for (size_t i = 0; i < n; i++)
+				a[i] = (struct __vec_keyed){ num->key(__vector_argsort_obj(v, i, zero)), i };
+
+			struct __vec_keyed *sorted = __vector_radix_keys(a, tmp, n);
+			for (size_t i = 0; i < n; i++)
+				idx[i] = sorted[i].idx;
+		} else {
+			res = VEC_ENOMEM;
+		}
+
+		if (a)
+			__vec_dealloc(a);
+		if (tmp)
+			__vec_dealloc(tmp);
+	} else {
+		size_t *tmp = __vec_alloc(n * sizeof *tmp);
+		if (tmp) {
+			for (size_t i = 0; i < n; i++)
+				idx[i] = i;
+
+			size_t *sorted = __vector_merge_indices(v, cmp, zero, idx, tmp, n);
+			if (sorted != idx)
+				memcpy(idx, sorted, n * sizeof *idx);
+			__vec_dealloc(tmp);
+		} else {
+			res = VEC_ENOMEM;
+		}
+	}
+
+	if (zero)
+		__vec_dealloc(zero);
+	return res;
+}
+
+int vector_permute(struct vector *v, struct vector *perm, size_t nthreads)
+{
+	ASSERT_PRECONDITION(__vector_is_valid(v) && __vector_is_valid(perm) && perm != v, return VEC_EINVAL);
+	ASSERT_PRECONDITION(perm->objsz == sizeof(size_t) && !perm->pool && perm->size == v->size,
+			    return VEC_EINVAL);
+	ASSERT_PRECONDITION(v->mutable, return VEC_EIMMUT);
+
+	__vector_pregrow_cancel(v);
+	__vector_settle(v);
+
+	size_t n = v->size;
+	if (n == 0)
+		return VEC_SUCCESS;
+
+	/* each index must appear once, the bits mark the objects left to move */
+	const size_t *p = vector_data(perm);
+	uint64_t *left	= __vector_zalloc((n + 63) / 64, sizeof *left);
+	if (!left)
+		return VEC_ENOMEM;
+
+	int res = VEC_SUCCESS;
+	for (size_t i = 0; i < n && res == VEC_SUCCESS; i++) {
+		uint64_t bit = UINT64_C(1) << (p[i] % 64);
+		if (p[i] >= n || (left[p[i] / 64] & bit))
+			res = VEC_EINVAL;
+		else
+			left[p[i] / 64] |= bit;
+	}
+
+	if (nthreads == 0) {
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads    = online > 0 ? online : 1;
+	}
+	if (nthreads > VEC_GATHER_MAX)
+		nthreads = VEC_GATHER_MAX;
+	if (nthreads > n / VEC_GATHER_MIN)
+		nthreads = n / VEC_GATHER_MIN;
+
+	if (res == VEC_SUCCESS && nthreads > 1)
+		res = __vector_gather(v, p, nthreads);
+	else if (res == VEC_SUCCESS)
+		res = __vector_permute_cycles(v, p, left);
+
+	__vec_dealloc(left);
+	return res;
+}
+
+int vector_lower_bound_batch(struct vector *v, int (*cmp)(const void *, const void *),
+			     const void *keys, size_t keysz, size_t k, size_t *out)
+{
+	ASSERT_PRECONDITION(__vector_is_valid(v) && cmp != NULL && !v->pool, return VEC_EINVAL);
+	ASSERT_PRECONDITION(k == 0 || (keys != NULL && out != NULL), return VEC_EINVAL);
+
+	__vector_settle(v);
+
+	for (size_t i = 0; i < k; i += VEC_BATCH_GROUP) {
+		size_t g = k - i < VEC_BATCH_GROUP ? k - i : VEC_BATCH_GROUP;
+		__vector_lower_bound_group(v->data, v->size, v->objsz, cmp,
+					   (const char *)keys + (i * keysz), keysz, g, out + i);
+	}
+	return VEC_SUCCESS;
+}
+
 struct vector_iter *vector_get_iterator(struct vector *v, size_t begin, size_t end)
 {
 	ASSERT_PRECONDITION(__vector_is_valid(v), return NULL);
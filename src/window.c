@@ -0,0 +1,429 @@
+/*
+ * window -- Sliding window aggregation
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "window.h"
+
+#define ASSERT_PRECONDITION(cond, action) \
+	if (!(cond))                      \
+	action
+
+enum win_consts {
+	/* entries of a ring when it first grows */
+	WIN_MIN_CAPACITY = 16
+};
+
+/* a double ended queue of fixed size entries, in a power of two array */
+struct win_ring {
+	char *data;
+	size_t entsz;
+	size_t capacity;
+
+	/* index of the front entry, and number of entries */
+	size_t head;
+	size_t n;
+};
+
+/* an entry of a monotonic deque, seq numbering the points of a window */
+struct win_mono {
+	uint64_t seq;
+	double v;
+};
+
+struct window {
+	int64_t span;
+
+	/* newest timestamp seen, valid if started */
+	int64_t now;
+	bool started;
+
+	/* points in the window, oldest first */
+	struct win_ring points;
+
+	/* sequence number of the next point, the front point is seq - points.n */
+	uint64_t seq;
+
+	/* points with no smaller (larger) value after them, oldest first */
+	struct win_ring mins;
+	struct win_ring maxs;
+
+	/* sum of the values, compensated for the bits lost by each addition */
+	double sum;
+	double comp;
+};
+
+struct window_agg {
+	size_t objsz;
+	void (*combine)(void *, const void *, const void *, void *);
+	void *arg;
+
+	/*
+	 * Objects oldest first, each entry an object followed by an aggregate.
+	 * The first nfront entries are the front stack, their aggregate being
+	 * of the object and all the front objects after it.
+	 */
+	struct win_ring objs;
+	size_t nfront;
+
+	/* aggregate of the back stack, entries [nfront, n) */
+	char *back;
+	char *tmp;
+};
+
+static inline void *__win_at(struct win_ring *r, size_t i)
+{
+	return r->data + (((r->head + i) & (r->capacity - 1)) * r->entsz);
+}
+
+static int __win_reserve(struct win_ring *r, size_t n)
+{
+	if (n <= r->capacity)
+		return VEC_SUCCESS;
+
+	size_t capacity = r->capacity ? r->capacity : WIN_MIN_CAPACITY;
+	while (capacity < n) {
+		if (capacity > SIZE_MAX / 2 / r->entsz)
+			return VEC_EMAXED;
+		capacity *= 2;
+	}
+
+	char *data = malloc(capacity * r->entsz);
+	if (!data)
+		return VEC_ENOMEM;
+
+	/* unwrap the entries to the start of the new array */
+	size_t first = r->capacity - r->head < r->n ? r->capacity - r->head : r->n;
+	if (r->n) {
+		memcpy(data, r->data + (r->head * r->entsz), first * r->entsz);
+		memcpy(data + (first * r->entsz), r->data, (r->n - first) * r->entsz);
+	}
+
+	free(r->data);
+	r->data	    = data;
+	r->capacity = capacity;
+	r->head	    = 0;
+	return VEC_SUCCESS;
+}
+
+/* room must have been reserved */
+static inline void *__win_push_back(struct win_ring *r)
+{
+	return __win_at(r, r->n++);
+}
+
+static inline void __win_pop_front(struct win_ring *r)
+{
+	r->head = (r->head + 1) & (r->capacity - 1);
+	r->n--;
+}
+
+static inline double __win_abs(double x)
+{
+	return x < 0 ? -x : x;
+}
+
+/* Neumaier's compensated summation, subtractions included */
+static inline void __win_add(struct window *w, double x)
+{
+	double t = w->sum + x;
+	if (__win_abs(w->sum) >= __win_abs(x))
+		w->comp += (w->sum - t) + x;
+	else
+		w->comp += (x - t) + w->sum;
+	w->sum = t;
+}
+
+static void __win_evict(struct window *w)
+{
+	while (w->points.n) {
+		struct window_point *p = __win_at(&w->points, 0);
+		/* now is not before p->t, so the difference fits unsigned */
+		if ((uint64_t)w->now - (uint64_t)p->t < (uint64_t)w->span)
+			break;
+
+		uint64_t seq = w->seq - w->points.n;
+		if (((struct win_mono *)__win_at(&w->mins, 0))->seq == seq)
+			__win_pop_front(&w->mins);
+		if (((struct win_mono *)__win_at(&w->maxs, 0))->seq == seq)
+			__win_pop_front(&w->maxs);
+
+		__win_add(w, -p->v);
+		__win_pop_front(&w->points);
+	}
+
+	/* drop any error left once the window runs empty */
+	if (!w->points.n)
+		w->sum = w->comp = 0;
+}
+
+/* add a point inside the window, room must have been reserved in every ring */
+static void __win_insert(struct window *w, int64_t t, double v)
+{
+	*(struct window_point *)__win_push_back(&w->points) = (struct window_point){ t, v };
+	__win_add(w, v);
+
+	/* older points that can no longer be the minimum or maximum leave */
+	while (w->mins.n && ((struct win_mono *)__win_at(&w->mins, w->mins.n - 1))->v >= v)
+		w->mins.n--;
+	*(struct win_mono *)__win_push_back(&w->mins) = (struct win_mono){ w->seq, v };
+
+	while (w->maxs.n && ((struct win_mono *)__win_at(&w->maxs, w->maxs.n - 1))->v <= v)
+		w->maxs.n--;
+	*(struct win_mono *)__win_push_back(&w->maxs) = (struct win_mono){ w->seq, v };
+
+	w->seq++;
+}
+
+static int __win_reserve_points(struct window *w, size_t k)
+{
+	size_t n = w->points.n + k;
+	int res	 = __win_reserve(&w->points, n);
+	if (res == VEC_SUCCESS)
+		res = __win_reserve(&w->mins, n);
+	if (res == VEC_SUCCESS)
+		res = __win_reserve(&w->maxs, n);
+	return res;
+}
+
+struct window *window_new(int64_t span)
+{
+	ASSERT_PRECONDITION(span > 0, return NULL);
+
+	struct window *w = calloc(1, sizeof *w);
+	if (!w)
+		return NULL;
+
+	w->span		= span;
+	w->points.entsz = sizeof(struct window_point);
+	w->mins.entsz	= sizeof(struct win_mono);
+	w->maxs.entsz	= sizeof(struct win_mono);
+	return w;
+}
+
+void window_free(struct window **wp)
+{
+	ASSERT_PRECONDITION(wp && *wp, return );
+
+	struct window *w = *wp;
+	free(w->points.data);
+	free(w->mins.data);
+	free(w->maxs.data);
+	free(w);
+
+	*wp = NULL;
+}
+
+size_t window_size(struct window *w)
+{
+	ASSERT_PRECONDITION(w != NULL, return 0);
+	return w->points.n;
+}
+
+int window_push(struct window *w, int64_t t, double v)
+{
+	ASSERT_PRECONDITION(w != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(!w->started || t >= w->now, return VEC_EINVAL);
+
+	w->now	   = t;
+	w->started = true;
+	__win_evict(w);
+
+	int res = __win_reserve_points(w, 1);
+	if (res != VEC_SUCCESS)
+		return res;
+
+	__win_insert(w, t, v);
+	return VEC_SUCCESS;
+}
+
+int window_push_span(struct window *w, struct vector *points, size_t begin, size_t end)
+{
+	ASSERT_PRECONDITION(w != NULL && points != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(points) == sizeof(struct window_point), return VEC_EINVAL);
+	ASSERT_PRECONDITION(!vector_is_indirect(points), return VEC_EINVAL);
+	ASSERT_PRECONDITION(begin <= end && end <= vector_size(points), return VEC_ERANGE);
+	if (begin == end)
+		return VEC_SUCCESS;
+
+	const struct window_point *p = (const struct window_point *)vector_data(points);
+	ASSERT_PRECONDITION(!w->started || p[begin].t >= w->now, return VEC_EINVAL);
+	for (size_t i = begin + 1; i < end; i++)
+		ASSERT_PRECONDITION(p[i - 1].t <= p[i].t, return VEC_EINVAL);
+
+	/* points out of the window by the end of the span never enter it */
+	int64_t last = p[end - 1].t;
+	size_t lo = begin, hi = end - 1;
+	while (lo < hi) {
+		size_t mid = lo + ((hi - lo) / 2);
+		if ((uint64_t)last - (uint64_t)p[mid].t >= (uint64_t)w->span)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	w->now	   = last;
+	w->started = true;
+	__win_evict(w);
+
+	int res = __win_reserve_points(w, end - lo);
+	if (res != VEC_SUCCESS)
+		return res;
+
+	/* the skipped points still take their sequence numbers */
+	w->seq += lo - begin;
+	for (size_t i = lo; i < end; i++)
+		__win_insert(w, p[i].t, p[i].v);
+	return VEC_SUCCESS;
+}
+
+int window_advance(struct window *w, int64_t t)
+{
+	ASSERT_PRECONDITION(w != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(!w->started || t >= w->now, return VEC_EINVAL);
+
+	w->now	   = t;
+	w->started = true;
+	__win_evict(w);
+	return VEC_SUCCESS;
+}
+
+int window_stats(struct window *w, struct window_stats *s)
+{
+	ASSERT_PRECONDITION(w != NULL && s != NULL, return VEC_EINVAL);
+
+	s->count = w->points.n;
+	s->sum	 = w->sum + w->comp;
+	s->min	 = w->mins.n ? ((struct win_mono *)__win_at(&w->mins, 0))->v : 0;
+	s->max	 = w->maxs.n ? ((struct win_mono *)__win_at(&w->maxs, 0))->v : 0;
+	return VEC_SUCCESS;
+}
+
+/* move the back stack over to the front, aggregating from the newest object */
+static void __win_agg_flip(struct window_agg *a)
+{
+	size_t n = a->objs.n;
+	for (size_t i = n; i-- > 0;) {
+		char *obj = __win_at(&a->objs, i);
+		if (i == n - 1)
+			memcpy(obj + a->objsz, obj, a->objsz);
+		else
+			a->combine(obj + a->objsz, obj, (char *)__win_at(&a->objs, i + 1) + a->objsz, a->arg);
+	}
+	a->nfront = n;
+}
+
+struct window_agg *window_agg_new(size_t objsz, void (*combine)(void *, const void *, const void *, void *),
+				  void *arg)
+{
+	ASSERT_PRECONDITION(objsz > 0 && combine != NULL, return NULL);
+
+	struct window_agg *a = calloc(1, sizeof *a);
+	if (!a)
+		return NULL;
+
+	a->objsz      = objsz;
+	a->combine    = combine;
+	a->arg	      = arg;
+	a->objs.entsz = 2 * objsz;
+	a->back	      = malloc(objsz);
+	a->tmp	      = malloc(objsz);
+	if (!a->back || !a->tmp) {
+		window_agg_free(&a);
+		return NULL;
+	}
+	return a;
+}
+
+void window_agg_free(struct window_agg **ap)
+{
+	ASSERT_PRECONDITION(ap && *ap, return );
+
+	struct window_agg *a = *ap;
+	free(a->objs.data);
+	free(a->back);
+	free(a->tmp);
+	free(a);
+
+	*ap = NULL;
+}
+
+size_t window_agg_size(struct window_agg *a)
+{
+	ASSERT_PRECONDITION(a != NULL, return 0);
+	return a->objs.n;
+}
+
+/* room must have been reserved */
+static void __win_agg_insert(struct window_agg *a, const void *p)
+{
+	memcpy(__win_push_back(&a->objs), p, a->objsz);
+
+	if (a->objs.n - a->nfront == 1) {
+		memcpy(a->back, p, a->objsz);
+	} else {
+		a->combine(a->tmp, a->back, p, a->arg);
+		memcpy(a->back, a->tmp, a->objsz);
+	}
+}
+
+int window_agg_push(struct window_agg *a, const void *p)
+{
+	ASSERT_PRECONDITION(a != NULL && p != NULL, return VEC_EINVAL);
+
+	int res = __win_reserve(&a->objs, a->objs.n + 1);
+	if (res != VEC_SUCCESS)
+		return res;
+
+	__win_agg_insert(a, p);
+	return VEC_SUCCESS;
+}
+
+int window_agg_push_span(struct window_agg *a, struct vector *v, size_t begin, size_t end)
+{
+	ASSERT_PRECONDITION(a != NULL && v != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(vector_object_size(v) == a->objsz && !vector_is_indirect(v), return VEC_EINVAL);
+	ASSERT_PRECONDITION(begin <= end && end <= vector_size(v), return VEC_ERANGE);
+
+	int res = __win_reserve(&a->objs, a->objs.n + (end - begin));
+	if (res != VEC_SUCCESS)
+		return res;
+
+	const char *p = vector_data(v);
+	for (size_t i = begin; i < end; i++)
+		__win_agg_insert(a, p + (i * a->objsz));
+	return VEC_SUCCESS;
+}
+
+int window_agg_pop(struct window_agg *a)
+{
+	ASSERT_PRECONDITION(a != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(a->objs.n > 0, return VEC_ERANGE);
+
+	if (a->nfront == 0)
+		__win_agg_flip(a);
+
+	__win_pop_front(&a->objs);
+	a->nfront--;
+	return VEC_SUCCESS;
+}
+
+int window_agg_query(struct window_agg *a, void *out)
+{
+	ASSERT_PRECONDITION(a != NULL && out != NULL, return VEC_EINVAL);
+	ASSERT_PRECONDITION(a->objs.n > 0, return VEC_ERANGE);
+
+	const char *front = (const char *)__win_at(&a->objs, 0) + a->objsz;
+	if (a->nfront == 0)
+		memcpy(out, a->back, a->objsz);
+	else if (a->nfront == a->objs.n)
+		memcpy(out, front, a->objsz);
+	else
+		a->combine(out, front, a->back, a->arg);
+	return VEC_SUCCESS;
+}
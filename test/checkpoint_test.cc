@@ -0,0 +1,183 @@
+extern "C" {
+#include "checkpoint.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <vector>
+
+static struct vector *filled(size_t n)
+{
+	struct vector *v = vector_new(n, sizeof(long));
+	for (long i = 0; i < (long)n; i++)
+		vector_push(v, &i);
+	return v;
+}
+
+static void expect_same(struct vector *a, struct vector *b)
+{
+	ASSERT_EQ(vector_size(a), vector_size(b));
+	ASSERT_EQ(vector_object_size(a), vector_object_size(b));
+	EXPECT_EQ(memcmp(vector_data(a), vector_data(b), vector_size(a) * vector_object_size(a)), 0);
+}
+
+TEST(CheckpointTest, FirstCheckpointIsFull)
+{
+	struct vector *v = filled(100000);
+	struct ckpt *c	 = ckpt_new(v);
+	EXPECT_NE(c, nullptr);
+	EXPECT_TRUE(ckpt_next_is_full(c));
+
+	FILE *base = tmpfile();
+	EXPECT_EQ(ckpt_write(c, base), CKPT_SUCCESS);
+	EXPECT_FALSE(ckpt_next_is_full(c));
+	EXPECT_GE(ftell(base), 100000 * sizeof(long));
+
+	rewind(base);
+	struct vector *r = NULL;
+	EXPECT_EQ(ckpt_apply(&r, base), CKPT_SUCCESS);
+	expect_same(v, r);
+
+	fclose(base);
+	vector_free(&r, NULL);
+	ckpt_free(&c);
+	EXPECT_EQ(c, nullptr);
+	vector_free(&v, NULL);
+}
+
+TEST(CheckpointTest, DeltaHoldsOnlyWrittenPages)
+{
+	struct vector *v = filled(1 << 20);
+	struct ckpt *c	 = ckpt_new(v);
+
+	FILE *base = tmpfile();
+	EXPECT_EQ(ckpt_write(c, base), CKPT_SUCCESS);
+
+	long x = -1;
+	vector_insert(v, 12345, &x);
+	vector_insert(v, 500000, &x);
+
+	FILE *delta1 = tmpfile();
+	EXPECT_EQ(ckpt_write(c, delta1), CKPT_SUCCESS);
+
+	/* two written pages, plus the partial pages at both ends */
+	EXPECT_LT(ftell(delta1), 5 * 4096 + 1024);
+
+	vector_insert(v, 999999, &x);
+	vector_pop(v, &x);
+
+	FILE *delta2 = tmpfile();
+	EXPECT_EQ(ckpt_write(c, delta2), CKPT_SUCCESS);
+	EXPECT_LT(ftell(delta2), 5 * 4096 + 1024);
+
+	rewind(base);
+	rewind(delta1);
+	rewind(delta2);
+	struct vector *r = NULL;
+	EXPECT_EQ(ckpt_apply(&r, base), CKPT_SUCCESS);
+	EXPECT_EQ(ckpt_apply(&r, delta1), CKPT_SUCCESS);
+	EXPECT_EQ(ckpt_apply(&r, delta2), CKPT_SUCCESS);
+	expect_same(v, r);
+
+	fclose(base);
+	fclose(delta1);
+	fclose(delta2);
+	vector_free(&r, NULL);
+	ckpt_free(&c);
+	vector_free(&v, NULL);
+}
+
+TEST(CheckpointTest, GrowthMakesFullCheckpoint)
+{
+	struct vector *v = filled(1000);
+	struct ckpt *c	 = ckpt_new(v);
+
+	FILE *base = tmpfile();
+	EXPECT_EQ(ckpt_write(c, base), CKPT_SUCCESS);
+
+	for (long i = 0; i < 10000; i++)
+		vector_push(v, &i);
+	EXPECT_TRUE(ckpt_next_is_full(c));
+
+	FILE *next = tmpfile();
+	EXPECT_EQ(ckpt_write(c, next), CKPT_SUCCESS);
+
+	/* a full checkpoint does not apply on top of another vector */
+	rewind(base);
+	rewind(next);
+	struct vector *r = NULL;
+	EXPECT_EQ(ckpt_apply(&r, base), CKPT_SUCCESS);
+	EXPECT_EQ(ckpt_apply(&r, next), CKPT_EFORMAT);
+	vector_free(&r, NULL);
+
+	rewind(next);
+	EXPECT_EQ(ckpt_apply(&r, next), CKPT_SUCCESS);
+	expect_same(v, r);
+
+	fclose(base);
+	fclose(next);
+	vector_free(&r, NULL);
+	ckpt_free(&c);
+	vector_free(&v, NULL);
+}
+
+/* released arrays stay mapped, so their protection can be looked at */
+static std::vector<void *> deferred;
+
+static void defer_free(void *p)
+{
+	deferred.push_back(p);
+}
+
+TEST(CheckpointTest, ReplacedArrayIsUnprotected)
+{
+	deallocator_fn old = vector_deallocator(defer_free);
+	struct vector *v   = filled(4096);
+	struct ckpt *c	   = ckpt_new(v);
+	EXPECT_EQ(ckpt_new(v), nullptr);
+
+	FILE *base = tmpfile();
+	EXPECT_EQ(ckpt_write(c, base), CKPT_SUCCESS);
+
+	char *before = (char *)vector_data(v);
+	for (long i = 0; i < 10000; i++)
+		vector_push(v, &i);
+	ASSERT_NE((char *)vector_data(v), before);
+
+	/* the kernel fails a read into a protected page rather than faulting */
+	int fds[2];
+	char buf[4096] = { 1 };
+	ASSERT_EQ(pipe(fds), 0);
+	ASSERT_EQ(write(fds[1], buf, sizeof buf), (ssize_t)sizeof buf);
+	EXPECT_EQ(read(fds[0], before + 8192, sizeof buf), (ssize_t)sizeof buf);
+	close(fds[0]);
+	close(fds[1]);
+
+	fclose(base);
+	ckpt_free(&c);
+	vector_free(&v, NULL);
+	vector_deallocator(old);
+	for (void *p : deferred)
+		free(p);
+	deferred.clear();
+}
+
+TEST(CheckpointTest, RejectsOverflowingHeader)
+{
+	/* the layout of a header: magic, version, full, reserved, objsz, size, nranges */
+	struct {
+		uint32_t magic, version, full, reserved;
+		uint64_t objsz, size, nranges;
+	} h = { 0x504b4352, 1, 1, 0, 16, UINT64_C(1) << 61, 1 };
+
+	FILE *f = tmpfile();
+	fwrite(&h, sizeof h, 1, f);
+	rewind(f);
+	struct vector *r = NULL;
+	EXPECT_EQ(ckpt_apply(&r, f), CKPT_EFORMAT);
+	EXPECT_EQ(r, nullptr);
+	fclose(f);
+}
@@ -0,0 +1,170 @@
+extern "C" {
+#include "dictvec.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+struct record {
+	char country[32];
+};
+
+static struct record make(int i)
+{
+	struct record r;
+	memset(&r, 0, sizeof r);
+	snprintf(r.country, sizeof r.country, "country-%d", i);
+	return r;
+}
+
+TEST(DictvecTest, EncodesAndDecodes)
+{
+	struct dictvec *d = dictvec_new(sizeof(struct record));
+	EXPECT_NE(d, nullptr);
+
+	for (int i = 0; i < 10000; i++) {
+		struct record r = make(i % 37);
+		EXPECT_EQ(dictvec_push(d, &r), VEC_SUCCESS);
+	}
+	EXPECT_EQ(dictvec_size(d), 10000);
+	EXPECT_EQ(dictvec_cardinality(d), 37);
+	EXPECT_EQ(dictvec_code_size(d), 1);
+
+	struct record r;
+	EXPECT_EQ(dictvec_get(d, 1234, &r), VEC_SUCCESS);
+	EXPECT_STREQ(r.country, make(1234 % 37).country);
+	EXPECT_EQ(dictvec_get(d, 10000, &r), VEC_ERANGE);
+
+	uint32_t code;
+	r = make(99);
+	EXPECT_EQ(dictvec_lookup(d, &r, &code), VEC_ERANGE);
+	r = make(5);
+	EXPECT_EQ(dictvec_lookup(d, &r, &code), VEC_SUCCESS);
+	EXPECT_EQ(code, 5);
+	dictvec_free(&d);
+	EXPECT_EQ(d, nullptr);
+}
+
+TEST(DictvecTest, WidensCodes)
+{
+	struct dictvec *d = dictvec_new(sizeof(int));
+	for (int i = 0; i < 70000; i++)
+		dictvec_push(d, &i);
+	EXPECT_EQ(dictvec_code_size(d), 4);
+
+	int x;
+	for (int i = 0; i < 70000; i += 999) {
+		EXPECT_EQ(dictvec_get(d, i, &x), VEC_SUCCESS);
+		EXPECT_EQ(x, i);
+	}
+	dictvec_free(&d);
+}
+
+/* allocations left before they start failing */
+static int allocs_left;
+
+static void *limited_alloc(size_t n)
+{
+	return allocs_left-- > 0 ? malloc(n) : NULL;
+}
+
+static bool match_none(void *, void *)
+{
+	return false;
+}
+
+TEST(DictvecTest, FailedPushKeepsValuesOut)
+{
+	struct dictvec *d = dictvec_new(sizeof(int));
+	for (int i = 0; i < 256; i++)
+		dictvec_push(d, &i);
+	EXPECT_EQ(dictvec_code_size(d), 1);
+
+	/* new values, widening the codes and growing every vector on the way, fail each allocation in turn */
+	callocator_fn old_calloc = vector_callocator(NULL);
+	allocator_fn old	 = vector_allocator(limited_alloc);
+	for (int x = 256; x < 2048; x++) {
+		int res = VEC_ENOMEM;
+		for (int k = 0; res == VEC_ENOMEM; k++) {
+			allocs_left = k;
+			res	    = dictvec_push(d, &x);
+			if (res == VEC_ENOMEM) {
+				ASSERT_EQ(dictvec_cardinality(d), (size_t)x) << k;
+				ASSERT_EQ(dictvec_size(d), (size_t)x) << k;
+			}
+		}
+		ASSERT_EQ(res, VEC_SUCCESS);
+	}
+	vector_allocator(old);
+	vector_callocator(old_calloc);
+
+	EXPECT_EQ(dictvec_code_size(d), 2);
+	for (size_t i = 0; i < 2048; i += 97) {
+		int y;
+		EXPECT_EQ(dictvec_get(d, i, &y), VEC_SUCCESS);
+		EXPECT_EQ(y, (int)i);
+	}
+
+	/* selecting nothing into a vector without an array */
+	struct vector *sel = vector_new(0, sizeof(size_t));
+	EXPECT_EQ(dictvec_select(d, match_none, NULL, sel), VEC_SUCCESS);
+	EXPECT_EQ(vector_size(sel), 0);
+	vector_free(&sel, NULL);
+	dictvec_free(&d);
+}
+
+TEST(DictvecTest, SelectsEqualObjects)
+{
+	/* every code width, with a tail not filling a whole block */
+	for (int card : { 10, 1000, 100000 }) {
+		struct dictvec *d = dictvec_new(sizeof(int));
+		for (int i = 0; i < 200003; i++) {
+			int x = i % card;
+			dictvec_push(d, &x);
+		}
+
+		struct vector *sel = vector_new(0, sizeof(size_t));
+		int x		   = 7;
+		EXPECT_EQ(dictvec_select_eq(d, &x, sel), VEC_SUCCESS);
+		EXPECT_EQ(vector_size(sel), (200003 - 7 + card - 1) / card);
+
+		size_t idx;
+		for (size_t i = 0; i < vector_size(sel); i++) {
+			vector_get(sel, i, &idx);
+			EXPECT_EQ(idx, 7 + i * card);
+		}
+
+		vector_free(&sel, NULL);
+		dictvec_free(&d);
+	}
+}
+
+static bool is_even(void *p, void *arg)
+{
+	(*(int *)arg)++;
+	return *(int *)p % 2 == 0;
+}
+
+TEST(DictvecTest, SelectsWithPredicate)
+{
+	struct dictvec *d = dictvec_new(sizeof(int));
+	for (int i = 0; i < 1000; i++) {
+		int x = i % 10;
+		dictvec_push(d, &x);
+	}
+
+	struct vector *sel = vector_new(0, sizeof(size_t));
+	int calls	   = 0;
+	EXPECT_EQ(dictvec_select(d, is_even, &calls, sel), VEC_SUCCESS);
+
+	/* called per distinct object only */
+	EXPECT_EQ(calls, 10);
+	EXPECT_EQ(vector_size(sel), 500);
+
+	size_t idx;
+	vector_get(sel, 1, &idx);
+	EXPECT_EQ(idx, 2);
+	vector_free(&sel, NULL);
+	dictvec_free(&d);
+}
@@ -0,0 +1,122 @@
+extern "C" {
+#include "eliasfano.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+
+static struct vector *make(const std::vector<uint64_t> &x)
+{
+	struct vector *v = vector_new(x.size() ? x.size() : 1, sizeof(uint64_t));
+	for (uint64_t y : x)
+		vector_push(v, &y);
+	return v;
+}
+
+/* sorted values with runs of duplicates and gaps of every size */
+static std::vector<uint64_t> values(size_t n, uint64_t step)
+{
+	std::vector<uint64_t> x;
+	uint64_t y = 3, state = 0x9e3779b97f4a7c15;
+	for (size_t i = 0; i < n; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		y += state % 5 == 0 ? 0 : state % step;
+		x.push_back(y);
+	}
+	return x;
+}
+
+TEST(EliasFanoTest, GetsValuesAndStaysCompact)
+{
+	for (uint64_t step : { 1, 2, 100, 1 << 20 }) {
+		std::vector<uint64_t> x = values(100000, step);
+		struct vector *v	= make(x);
+		struct eliasfano *e	= NULL;
+		ASSERT_EQ(eliasfano_build(&e, v), VEC_SUCCESS);
+		EXPECT_EQ(eliasfano_size(e), x.size());
+
+		/* 2 bits per value over the low ones, and the samples */
+		double bound = 2.5 + std::max(0.0, std::log2((double)x.back() / x.size()));
+		EXPECT_LT((double)eliasfano_bits(e) / x.size(), bound);
+
+		for (size_t i = 0; i < x.size(); i++) {
+			uint64_t y;
+			ASSERT_EQ(eliasfano_get(e, i, &y), VEC_SUCCESS);
+			ASSERT_EQ(y, x[i]);
+		}
+		uint64_t y;
+		EXPECT_EQ(eliasfano_get(e, x.size(), &y), VEC_ERANGE);
+
+		eliasfano_free(&e);
+		EXPECT_EQ(e, nullptr);
+		vector_free(&v, NULL);
+	}
+}
+
+TEST(EliasFanoTest, FindsNextGreaterOrEqual)
+{
+	std::vector<uint64_t> x = values(20000, 1000);
+	x.push_back(UINT64_MAX - 1);
+	struct vector *v    = make(x);
+	struct eliasfano *e = NULL;
+	ASSERT_EQ(eliasfano_build(&e, v), VEC_SUCCESS);
+
+	for (uint64_t q = 0; q < x[x.size() - 2] + 10; q += 97) {
+		size_t expect = std::lower_bound(x.begin(), x.end(), q) - x.begin();
+		size_t idx;
+		uint64_t y;
+		ASSERT_EQ(eliasfano_next_geq(e, q, &idx, &y), VEC_SUCCESS);
+		EXPECT_EQ(idx, expect);
+		EXPECT_EQ(y, x[expect]);
+	}
+
+	size_t idx;
+	EXPECT_EQ(eliasfano_next_geq(e, UINT64_MAX - 1, &idx, NULL), VEC_SUCCESS);
+	EXPECT_EQ(idx, x.size() - 1);
+	EXPECT_EQ(eliasfano_next_geq(e, UINT64_MAX, &idx, NULL), VEC_ERANGE);
+
+	eliasfano_free(&e);
+	vector_free(&v, NULL);
+}
+
+TEST(EliasFanoTest, DecodesRanges)
+{
+	std::vector<uint64_t> x = values(50000, 300);
+	struct vector *v	= make(x);
+	struct eliasfano *e	= NULL;
+	ASSERT_EQ(eliasfano_build(&e, v), VEC_SUCCESS);
+
+	std::vector<uint64_t> out(x.size());
+	EXPECT_EQ(eliasfano_decode(e, 0, x.size(), out.data()), VEC_SUCCESS);
+	EXPECT_EQ(out, x);
+
+	EXPECT_EQ(eliasfano_decode(e, 12345, 777, out.data()), VEC_SUCCESS);
+	for (size_t i = 0; i < 777; i++)
+		EXPECT_EQ(out[i], x[12345 + i]);
+	EXPECT_EQ(eliasfano_decode(e, x.size() - 1, 2, out.data()), VEC_ERANGE);
+
+	eliasfano_free(&e);
+	vector_free(&v, NULL);
+}
+
+TEST(EliasFanoTest, RejectsUnsortedVectors)
+{
+	struct vector *v    = make({ 1, 5, 4 });
+	struct eliasfano *e = NULL;
+	EXPECT_EQ(eliasfano_build(&e, v), VEC_EINVAL);
+	EXPECT_EQ(e, nullptr);
+	vector_free(&v, NULL);
+
+	v = make({});
+	EXPECT_EQ(eliasfano_build(&e, v), VEC_SUCCESS);
+	size_t idx;
+	EXPECT_EQ(eliasfano_next_geq(e, 0, &idx, NULL), VEC_ERANGE);
+	eliasfano_free(&e);
+	vector_free(&v, NULL);
+}
@@ -0,0 +1,136 @@
+extern "C" {
+#include "fmindex.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+static struct vector *make(const std::string &s)
+{
+	struct vector *v = vector_new(s.size() ? s.size() : 1, 1);
+	for (char c : s)
+		vector_push(v, &c);
+	return v;
+}
+
+/* n bytes of an alphabet of k bytes, starting from 'a' */
+static std::string text(size_t n, unsigned k, uint64_t state)
+{
+	std::string s;
+	for (size_t i = 0; i < n; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		s.push_back((char)('a' + (state % k)));
+	}
+	return s;
+}
+
+static std::vector<size_t> occurrences(const std::string &s, const std::string &p)
+{
+	std::vector<size_t> pos;
+	for (size_t i = s.find(p); i != std::string::npos; i = s.find(p, i + 1))
+		pos.push_back(i);
+	return pos;
+}
+
+TEST(FmIndexTest, SuffixArraysMatchSortedSuffixes)
+{
+	std::vector<std::string> texts = { "", "a", "ab", "ba", "aa", "banana", "mississippi",
+					   std::string(2000, 'a') };
+	std::string periodic;
+	for (int i = 0; i < 700; i++)
+		periodic += "abc";
+	texts.push_back(periodic);
+	for (unsigned k : { 1, 2, 4, 26 }) {
+		for (size_t n : { 3, 10, 1000, 5000 })
+			texts.push_back(text(n, k, 0x9e3779b97f4a7c15 + n));
+	}
+
+	for (const std::string &s : texts) {
+		struct vector *v  = make(s);
+		struct vector *sa = vector_new(1, sizeof(size_t));
+		ASSERT_EQ(fmindex_suffix_array(v, sa), VEC_SUCCESS);
+		ASSERT_EQ(vector_size(sa), s.size());
+
+		std::vector<size_t> expect(s.size());
+		for (size_t i = 0; i < s.size(); i++)
+			expect[i] = i;
+		std::sort(expect.begin(), expect.end(),
+			  [&s](size_t a, size_t b) { return s.compare(a, std::string::npos, s, b, std::string::npos) < 0; });
+
+		const size_t *got = (const size_t *)vector_data(sa);
+		EXPECT_TRUE(std::equal(expect.begin(), expect.end(), got)) << s.size();
+
+		vector_free(&sa, NULL);
+		vector_free(&v, NULL);
+	}
+}
+
+TEST(FmIndexTest, CountsAndLocatesSubstrings)
+{
+	/* several chunks of rotations, for the threads to share */
+	std::string s = text(300000, 4, 12345);
+	struct vector *v = make(s);
+
+	for (size_t nthreads : { 1, 4 }) {
+		struct fmindex *f = NULL;
+		ASSERT_EQ(fmindex_build(&f, v, nthreads), VEC_SUCCESS);
+		EXPECT_EQ(fmindex_size(f), s.size());
+
+		/* 2 bits a byte for the transform, and the samples */
+		EXPECT_LT(fmindex_bits(f), 5 * s.size());
+
+		std::vector<std::string> patterns = { "e", "ae", "abcdabcdabcdabcdabcd" };
+		for (size_t i = 0; i < 60; i++)
+			patterns.push_back(s.substr((i * 4999) % (s.size() - 20), 1 + (i % 20)));
+		patterns.push_back(s.substr(s.size() - 7));
+		patterns.push_back(s.substr(0, 9));
+
+		for (const std::string &p : patterns) {
+			std::vector<size_t> expect = occurrences(s, p);
+			size_t count;
+			ASSERT_EQ(fmindex_count(f, p.data(), p.size(), &count), VEC_SUCCESS);
+			EXPECT_EQ(count, expect.size()) << p;
+
+			struct vector *out = vector_new(1, sizeof(size_t));
+			ASSERT_EQ(fmindex_locate(f, p.data(), p.size(), out), VEC_SUCCESS);
+			ASSERT_EQ(vector_size(out), expect.size()) << p;
+			EXPECT_TRUE(std::equal(expect.begin(), expect.end(), (const size_t *)vector_data(out))) << p;
+			vector_free(&out, NULL);
+		}
+
+		size_t count;
+		EXPECT_EQ(fmindex_count(f, "a", 0, &count), VEC_EINVAL);
+
+		fmindex_free(&f);
+		EXPECT_EQ(f, nullptr);
+	}
+	vector_free(&v, NULL);
+}
+
+TEST(FmIndexTest, IndexesDegenerateTexts)
+{
+	for (const std::string &s : { std::string(), std::string(1000, 'a'), std::string("\0\xff\0\xff", 4) }) {
+		struct vector *v  = make(s);
+		struct fmindex *f = NULL;
+		ASSERT_EQ(fmindex_build(&f, v, 0), VEC_SUCCESS);
+
+		for (const std::string &p : { std::string("a"), std::string("aa"), std::string("\xff\0", 2),
+					      std::string("\0", 1), std::string(1001, 'a') }) {
+			std::vector<size_t> expect = occurrences(s, p);
+			struct vector *out	   = vector_new(1, sizeof(size_t));
+			ASSERT_EQ(fmindex_locate(f, p.data(), p.size(), out), VEC_SUCCESS);
+			ASSERT_EQ(vector_size(out), expect.size());
+			EXPECT_TRUE(std::equal(expect.begin(), expect.end(), (const size_t *)vector_data(out)));
+			vector_free(&out, NULL);
+		}
+
+		fmindex_free(&f);
+		vector_free(&v, NULL);
+	}
+}
@@ -0,0 +1,122 @@
+extern "C" {
+#include "itree.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct session {
+	uint32_t user;
+	int64_t begin;
+	int64_t end;
+};
+
+static std::vector<struct session> sessions(size_t n)
+{
+	std::vector<struct session> s;
+	uint64_t state = 0x9e3779b97f4a7c15;
+	for (size_t i = 0; i < n; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		int64_t begin = state % 100000;
+		int64_t len   = (state >> 20) % 8 == 0 ? (state >> 24) % 20000 : (state >> 24) % 100;
+		s.push_back({ (uint32_t)i, begin, begin + len });
+	}
+	return s;
+}
+
+/* indices of the overlapping sessions, by a full scan in start order */
+static std::vector<size_t> scan(const std::vector<struct session> &s, int64_t begin, int64_t end)
+{
+	std::vector<size_t> idx;
+	for (size_t i = 0; i < s.size() && begin < end; i++) {
+		if (s[i].begin < end && begin < s[i].end)
+			idx.push_back(i);
+	}
+	std::stable_sort(idx.begin(), idx.end(), [&](size_t a, size_t b) { return s[a].begin < s[b].begin; });
+	return idx;
+}
+
+static struct vector *make(const std::vector<struct session> &s)
+{
+	struct vector *v = vector_new(s.size() ? s.size() : 1, sizeof(struct session));
+	for (const struct session &x : s)
+		vector_push(v, (void *)&x);
+	return v;
+}
+
+TEST(ItreeTest, MatchesFullScans)
+{
+	for (size_t n : { 0, 1, 2, 3, 17, 64, 1000, 5000 }) {
+		std::vector<struct session> s = sessions(n);
+		struct vector *v	      = make(s);
+		struct itree *t		      = NULL;
+		ASSERT_EQ(itree_build(&t, v, offsetof(struct session, begin), offsetof(struct session, end)),
+			  VEC_SUCCESS);
+		EXPECT_EQ(itree_size(t), n);
+
+		struct vector *out = vector_new(16, sizeof(size_t));
+		for (int64_t begin = -100; begin < 110000; begin += 997) {
+			for (int64_t len : { 0, 1, 50, 3000 }) {
+				vector_resize(out, 0);
+				ASSERT_EQ(itree_overlap(t, begin, begin + len, out), VEC_SUCCESS);
+				std::vector<size_t> expect = scan(s, begin, begin + len);
+				ASSERT_EQ(vector_size(out), expect.size());
+				const size_t *got = (const size_t *)vector_data(out);
+				for (size_t i = 0; i < expect.size(); i++)
+					EXPECT_EQ(s[got[i]].begin, s[expect[i]].begin);
+				std::sort(expect.begin(), expect.end());
+				std::vector<size_t> sorted(got, got + expect.size());
+				std::sort(sorted.begin(), sorted.end());
+				EXPECT_EQ(sorted, expect);
+			}
+		}
+
+		itree_free(&t);
+		EXPECT_EQ(t, nullptr);
+		vector_free(&out, NULL);
+		vector_free(&v, NULL);
+	}
+}
+
+TEST(ItreeTest, BatchesQueriesInTheirOrder)
+{
+	std::vector<struct session> s = sessions(3000);
+	struct vector *v	      = make(s);
+	struct itree *t		      = NULL;
+	ASSERT_EQ(itree_build(&t, v, offsetof(struct session, begin), offsetof(struct session, end)), VEC_SUCCESS);
+
+	std::vector<struct itree_range> q;
+	for (int64_t i = 0; i < 500; i++)
+		q.push_back({ (i * 7919) % 100000, ((i * 7919) % 100000) + (i % 7) * 100 });
+
+	struct jagged *out = jagged_new(sizeof(size_t));
+	EXPECT_EQ(itree_overlap_batch(t, q.data(), q.size(), out), VEC_SUCCESS);
+	ASSERT_EQ(jagged_rows(out), q.size());
+
+	struct vector *one = vector_new(16, sizeof(size_t));
+	for (size_t i = 0; i < q.size(); i++) {
+		vector_resize(one, 0);
+		itree_overlap(t, q[i].start, q[i].end, one);
+
+		struct jagged_span row;
+		jagged_row(out, i, &row);
+		ASSERT_EQ(row.size, vector_size(one));
+		for (size_t j = 0; j < row.size; j++)
+			EXPECT_EQ(((size_t *)row.data)[j], ((size_t *)vector_data(one))[j]);
+	}
+
+	struct jagged *wrong = jagged_new(sizeof(int));
+	EXPECT_EQ(itree_overlap_batch(t, q.data(), q.size(), wrong), VEC_EINVAL);
+
+	jagged_free(&wrong, NULL);
+	jagged_free(&out, NULL);
+	vector_free(&one, NULL);
+	itree_free(&t);
+	vector_free(&v, NULL);
+}
@@ -0,0 +1,98 @@
+extern "C" {
+#include "jagged.h"
+}
+
+#include <gtest/gtest.h>
+
+TEST(JaggedTest, PushToLastRow)
+{
+	struct jagged *j = jagged_new(sizeof(int));
+	EXPECT_NE(j, nullptr);
+
+	int x = 1;
+	EXPECT_EQ(jagged_push(j, &x), VEC_ERANGE);
+
+	for (int r = 0; r < 10; r++) {
+		EXPECT_EQ(jagged_add_row(j), VEC_SUCCESS);
+		for (int i = 0; i < r; i++) {
+			x = r * 100 + i;
+			EXPECT_EQ(jagged_push(j, &x), VEC_SUCCESS);
+		}
+	}
+	EXPECT_EQ(jagged_rows(j), 10);
+	EXPECT_EQ(jagged_size(j), 45);
+	EXPECT_EQ(jagged_object_size(j), sizeof(int));
+
+	struct jagged_span span;
+	EXPECT_EQ(jagged_row(j, 0, &span), VEC_SUCCESS);
+	EXPECT_EQ(span.size, 0);
+	EXPECT_EQ(span.data, nullptr);
+
+	EXPECT_EQ(jagged_row(j, 7, &span), VEC_SUCCESS);
+	EXPECT_EQ(span.size, 7);
+	for (int i = 0; i < 7; i++)
+		EXPECT_EQ(((int *)span.data)[i], 700 + i);
+
+	EXPECT_EQ(jagged_get(j, 9, 8, &x), VEC_SUCCESS);
+	EXPECT_EQ(x, 908);
+	EXPECT_EQ(jagged_get(j, 9, 9, &x), VEC_ERANGE);
+	EXPECT_EQ(jagged_row(j, 10, &span), VEC_ERANGE);
+
+	jagged_free(&j, NULL);
+	EXPECT_EQ(j, nullptr);
+}
+
+TEST(JaggedTest, BuildFromPairs)
+{
+	struct vector *rows = vector_new(0, sizeof(size_t));
+	struct vector *objs = vector_new(0, sizeof(int));
+
+	/* edges of a small graph, in no particular order */
+	size_t from[] = { 3, 0, 3, 1, 0, 3 };
+	int to[]      = { 1, 2, 0, 3, 1, 2 };
+	for (int i = 0; i < 6; i++) {
+		vector_push(rows, &from[i]);
+		vector_push(objs, &to[i]);
+	}
+
+	struct jagged *j = jagged_build(rows, objs, 5);
+	EXPECT_NE(j, nullptr);
+	EXPECT_EQ(jagged_rows(j), 5);
+	EXPECT_EQ(jagged_size(j), 6);
+
+	struct jagged_span span;
+	jagged_row(j, 0, &span);
+	EXPECT_EQ(span.size, 2);
+	EXPECT_EQ(((int *)span.data)[0], 2);
+	EXPECT_EQ(((int *)span.data)[1], 1);
+
+	jagged_row(j, 2, &span);
+	EXPECT_EQ(span.size, 0);
+	jagged_row(j, 4, &span);
+	EXPECT_EQ(span.size, 0);
+
+	/* order within a row is kept */
+	jagged_row(j, 3, &span);
+	EXPECT_EQ(span.size, 3);
+	EXPECT_EQ(((int *)span.data)[0], 1);
+	EXPECT_EQ(((int *)span.data)[1], 0);
+	EXPECT_EQ(((int *)span.data)[2], 2);
+
+	/* rows can still be extended afterwards */
+	int x = 42;
+	EXPECT_EQ(jagged_push(j, &x), VEC_SUCCESS);
+	EXPECT_EQ(jagged_get(j, 4, 0, &x), VEC_SUCCESS);
+	EXPECT_EQ(x, 42);
+
+	jagged_free(&j, NULL);
+	EXPECT_EQ(jagged_build(rows, objs, 3), nullptr);
+
+	/* row indices are read straight from the array */
+	struct vector *slots = vector_new_indirect(1, sizeof(size_t));
+	for (size_t i = 0; i < vector_size(objs); i++)
+		vector_push(slots, vector_at(rows, i));
+	EXPECT_EQ(jagged_build(slots, objs, 5), nullptr);
+	vector_free(&slots, NULL);
+	vector_free(&rows, NULL);
+	vector_free(&objs, NULL);
+}
@@ -0,0 +1,192 @@
+extern "C" {
+#include "mphf.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+struct record {
+	uint32_t value;
+	uint64_t key;
+};
+
+static struct vector *make(size_t n)
+{
+	struct vector *v = vector_new(n, sizeof(struct record));
+	for (size_t i = 0; i < n; i++) {
+		struct record r;
+		memset(&r, 0, sizeof r);
+		r.key	= i * UINT64_C(0x9e3779b97f4a7c15) + 17;
+		r.value = i;
+		vector_push(v, &r);
+	}
+	vector_make_immutable(v);
+	return v;
+}
+
+TEST(MphfTest, MapsKeysToDistinctSlots)
+{
+	size_t n	 = 300000;
+	struct vector *v = make(n);
+	struct mphf *h	 = NULL;
+	EXPECT_EQ(mphf_build(&h, v, offsetof(struct record, key), sizeof(uint64_t), 4), VEC_SUCCESS);
+	EXPECT_EQ(mphf_size(h), n);
+	EXPECT_LT((double)mphf_bits(h) / n, 3.5);
+
+	std::vector<bool> seen(n);
+	const struct record *r = (const struct record *)vector_data(v);
+	for (size_t i = 0; i < n; i++) {
+		size_t slot = mphf_index(h, &r[i].key);
+		ASSERT_LT(slot, n);
+		EXPECT_FALSE(seen[slot]);
+		seen[slot] = true;
+	}
+
+	mphf_free(&h);
+	EXPECT_EQ(h, nullptr);
+	vector_free(&v, NULL);
+}
+
+TEST(MphfTest, FindsObjectsOfArrangedVectors)
+{
+	struct vector *v = make(5000);
+	struct mphf *h	 = NULL;
+	EXPECT_EQ(mphf_build(&h, v, offsetof(struct record, key), sizeof(uint64_t), 0), VEC_SUCCESS);
+
+	struct vector *arranged = NULL;
+	EXPECT_EQ(mphf_arrange(h, v, &arranged), VEC_SUCCESS);
+	EXPECT_FALSE(vector_is_mutable(arranged));
+
+	struct record r;
+	for (size_t i = 0; i < 5000; i++) {
+		uint64_t key = i * UINT64_C(0x9e3779b97f4a7c15) + 17;
+		EXPECT_EQ(mphf_get(h, arranged, &key, &r), VEC_SUCCESS);
+		EXPECT_EQ(r.value, i);
+	}
+
+	uint64_t missing = 12345;
+	EXPECT_EQ(mphf_get(h, arranged, &missing, &r), VEC_ERANGE);
+
+	mphf_free(&h);
+	vector_free(&arranged, NULL);
+	vector_free(&v, NULL);
+}
+
+TEST(MphfTest, BatchedLookupsMatchSingleOnes)
+{
+	size_t n	 = 50000;
+	struct vector *v = make(n);
+	struct mphf *h	 = NULL;
+	EXPECT_EQ(mphf_build(&h, v, offsetof(struct record, key), sizeof(uint64_t), 2), VEC_SUCCESS);
+
+	struct vector *arranged = NULL;
+	EXPECT_EQ(mphf_arrange(h, v, &arranged), VEC_SUCCESS);
+
+	/* keys read in place from the records, then a missing one */
+	const struct record *r = (const struct record *)vector_data(v);
+	std::vector<size_t> slots(n);
+	EXPECT_EQ(mphf_index_batch(h, &r[0].key, sizeof(struct record), n, slots.data()), VEC_SUCCESS);
+	for (size_t i = 0; i < n; i++)
+		EXPECT_EQ(slots[i], mphf_index(h, &r[i].key));
+
+	std::vector<uint64_t> keys;
+	for (size_t i = 0; i < 1000; i++)
+		keys.push_back(r[(i * 7919) % n].key);
+	keys.push_back(12345);
+
+	std::vector<struct record> got(keys.size());
+	bool found[1001];
+	EXPECT_EQ(mphf_get_batch(h, arranged, keys.data(), sizeof(uint64_t), keys.size(), got.data(), found),
+		  VEC_SUCCESS);
+	for (size_t i = 0; i < 1000; i++) {
+		EXPECT_TRUE(found[i]);
+		EXPECT_EQ(got[i].value, (i * 7919) % n);
+	}
+	EXPECT_FALSE(found[1000]);
+	EXPECT_EQ(got[1000].key, 0);
+
+	mphf_free(&h);
+	vector_free(&arranged, NULL);
+	vector_free(&v, NULL);
+}
+
+TEST(MphfTest, RejectsMutableVectorsAndDuplicates)
+{
+	struct vector *v = vector_new(4, sizeof(uint64_t));
+	struct mphf *h	 = NULL;
+	for (uint64_t k : { 1, 2, 3, 2 })
+		vector_push(v, &k);
+	EXPECT_EQ(mphf_build(&h, v, 0, sizeof(uint64_t), 1), VEC_EINVAL);
+
+	vector_make_immutable(v);
+	EXPECT_EQ(mphf_build(&h, v, 0, sizeof(uint64_t), 1), VEC_EINVAL);
+	EXPECT_EQ(mphf_build(&h, v, 4, sizeof(uint64_t), 1), VEC_EINVAL);
+	EXPECT_EQ(h, nullptr);
+	vector_free(&v, NULL);
+}
+
+TEST(MphfTest, WritesAndReads)
+{
+	size_t n	 = 200000;
+	struct vector *v = make(n);
+	struct mphf *h	 = NULL;
+	EXPECT_EQ(mphf_build(&h, v, offsetof(struct record, key), sizeof(uint64_t), 2), VEC_SUCCESS);
+
+	FILE *f = tmpfile();
+	EXPECT_EQ(mphf_write(h, f), CKPT_SUCCESS);
+	rewind(f);
+
+	struct mphf *read = NULL;
+	EXPECT_EQ(mphf_read(&read, f), CKPT_SUCCESS);
+	EXPECT_EQ(mphf_size(read), n);
+
+	const struct record *r = (const struct record *)vector_data(v);
+	for (size_t i = 0; i < n; i += 7)
+		EXPECT_EQ(mphf_index(read, &r[i].key), mphf_index(h, &r[i].key));
+
+	rewind(f);
+	fputc('X', f);
+	rewind(f);
+	struct mphf *bad = NULL;
+	EXPECT_EQ(mphf_read(&bad, f), CKPT_EFORMAT);
+	fclose(f);
+
+	mphf_free(&h);
+	mphf_free(&read);
+	vector_free(&v, NULL);
+}
+
+/* a stored function of one partition, its codes left out */
+static int read_part(uint64_t size, uint64_t offset, uint64_t n, uint64_t nbuckets, uint64_t width)
+{
+	/* the layout of the headers: magic, version, seed, keyoff, keylen, size, nparts, then
+	 * offset, n, tablesz, nbuckets, ndict, width */
+	struct {
+		uint32_t magic, version;
+		uint64_t seed, keyoff, keylen, size, nparts;
+		uint64_t offset, n, tablesz, nbuckets, ndict, width;
+	} h = { 0x48504d52, 1, 0, 0, 8, size, 1, offset, n, n, nbuckets, 1, width };
+	uint64_t codes[2] = { 0, 0 };
+
+	FILE *f = tmpfile();
+	fwrite(&h, sizeof h, 1, f);
+	fwrite(codes, sizeof codes, 1, f);
+	rewind(f);
+	struct mphf *r = NULL;
+	int res	       = mphf_read(&r, f);
+	EXPECT_EQ(r, nullptr);
+	fclose(f);
+	return res;
+}
+
+TEST(MphfTest, RejectsMalformedPartitions)
+{
+	/* more keys than the function, with codes overflowing to a single word */
+	EXPECT_EQ(read_part(1, 0, UINT64_C(1) << 58, UINT64_C(1) << 59, 32), CKPT_EFORMAT);
+
+	/* slots past the size */
+	EXPECT_EQ(read_part(1, 5, 1, 2, 1), CKPT_EFORMAT);
+}
@@ -0,0 +1,179 @@
+extern "C" {
+#include "scan.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+#include <stdint.h>
+
+template <typename T> static struct vector *make(size_t n, T (*f)(size_t))
+{
+	struct vector *v = vector_new(n, sizeof(T));
+	for (size_t i = 0; i < n; i++) {
+		T x = f(i);
+		vector_push(v, &x);
+	}
+	return v;
+}
+
+template <typename T> static void expect_matches(struct vector *v, enum scan_type type, struct scan_pred pred,
+						 bool (*match)(T))
+{
+	struct vector *sel    = vector_new(0, sizeof(size_t));
+	struct vector *bitmap = vector_new(0, sizeof(uint64_t));
+	EXPECT_EQ(scan_select(v, type, &pred, NULL, sel), VEC_SUCCESS);
+	EXPECT_EQ(scan_bitmap(v, type, &pred, bitmap), VEC_SUCCESS);
+
+	const T *x	      = (const T *)vector_data(v);
+	const size_t *idx     = (const size_t *)vector_data(sel);
+	const uint64_t *words = (const uint64_t *)vector_data(bitmap);
+	size_t j	      = 0;
+	for (size_t i = 0; i < vector_size(v); i++) {
+		bool m = match(x[i]);
+		EXPECT_EQ((words[i / 64] >> (i % 64)) & 1, m) << i;
+		if (m) {
+			ASSERT_LT(j, vector_size(sel));
+			EXPECT_EQ(idx[j++], i);
+		}
+	}
+	EXPECT_EQ(j, vector_size(sel));
+
+	vector_free(&sel, NULL);
+	vector_free(&bitmap, NULL);
+}
+
+TEST(ScanTest, SelectsSignedIntegers)
+{
+	struct vector *v = make<int16_t>(1000, [](size_t i) { return (int16_t)((i * 7919) % 2001 - 1000); });
+
+	expect_matches<int16_t>(v, SCAN_I16, { SCAN_LT, { .i = 10 } }, [](int16_t x) { return x < 10; });
+	expect_matches<int16_t>(v, SCAN_I16, { SCAN_GE, { .i = -500 } }, [](int16_t x) { return x >= -500; });
+	expect_matches<int16_t>(v, SCAN_I16, { SCAN_NE, { .i = 0 } }, [](int16_t x) { return x != 0; });
+	expect_matches<int16_t>(v, SCAN_I16, { SCAN_BETWEEN, { .i = -20 }, { .i = 300 } },
+				[](int16_t x) { return x >= -20 && x < 300; });
+
+	/* constants out of the range of the type */
+	expect_matches<int16_t>(v, SCAN_I16, { SCAN_GT, { .i = 1 << 20 } }, [](int16_t x) { return false; });
+	expect_matches<int16_t>(v, SCAN_I16, { SCAN_GT, { .i = -(1 << 20) } }, [](int16_t x) { return true; });
+	vector_free(&v, NULL);
+
+	v = make<int8_t>(333, [](size_t i) { return (int8_t)(i * 37); });
+	expect_matches<int8_t>(v, SCAN_I8, { SCAN_LE, { .i = -3 } }, [](int8_t x) { return x <= -3; });
+	vector_free(&v, NULL);
+
+	v = make<int64_t>(200, [](size_t i) { return (int64_t)(i * 0x9e3779b97f4a7c15); });
+	expect_matches<int64_t>(v, SCAN_I64, { SCAN_GT, { .i = 0 } }, [](int64_t x) { return x > 0; });
+	vector_free(&v, NULL);
+}
+
+TEST(ScanTest, SelectsUnsignedIntegers)
+{
+	struct vector *v = make<uint8_t>(300, [](size_t i) { return (uint8_t)(i * 13); });
+	expect_matches<uint8_t>(v, SCAN_U8, { SCAN_GT, { .u = 200 } }, [](uint8_t x) { return x > 200; });
+	vector_free(&v, NULL);
+
+	v = make<uint16_t>(300, [](size_t i) { return (uint16_t)(i * 977); });
+	expect_matches<uint16_t>(v, SCAN_U16, { SCAN_LT, { .u = 40000 } }, [](uint16_t x) { return x < 40000; });
+	vector_free(&v, NULL);
+
+	v = make<uint32_t>(300, [](size_t i) { return (uint32_t)(i * 2654435761u); });
+	expect_matches<uint32_t>(v, SCAN_U32, { SCAN_BETWEEN, { .u = 1u << 31 }, { .u = 3u << 30 } },
+				 [](uint32_t x) { return x >= 1u << 31 && x < 3u << 30; });
+	vector_free(&v, NULL);
+
+	v = make<uint64_t>(300, [](size_t i) { return (uint64_t)i * 0x9e3779b97f4a7c15u; });
+	expect_matches<uint64_t>(v, SCAN_U64, { SCAN_GE, { .u = UINT64_C(1) << 63 } },
+				 [](uint64_t x) { return x >= UINT64_C(1) << 63; });
+	vector_free(&v, NULL);
+}
+
+TEST(ScanTest, SelectsFloats)
+{
+	struct vector *v = make<float>(500, [](size_t i) { return i % 50 == 0 ? NAN : (float)i / 10; });
+	expect_matches<float>(v, SCAN_F32, { SCAN_LT, { .f = 20.3 } }, [](float x) { return x < 20.3; });
+	expect_matches<float>(v, SCAN_F32, { SCAN_EQ, { .f = 20.3 } }, [](float x) { return x == 20.3; });
+	expect_matches<float>(v, SCAN_F32, { SCAN_EQ, { .f = 2.5 } }, [](float x) { return x == 2.5; });
+	expect_matches<float>(v, SCAN_F32, { SCAN_NE, { .f = 2.5 } }, [](float x) { return x != 2.5; });
+	vector_free(&v, NULL);
+
+	v = make<double>(500, [](size_t i) { return i == 7 ? -INFINITY : (double)i - 250.5; });
+	expect_matches<double>(v, SCAN_F64, { SCAN_BETWEEN, { .f = -10 }, { .f = 10 } },
+			       [](double x) { return x >= -10 && x < 10; });
+	expect_matches<double>(v, SCAN_F64, { SCAN_LT, { .f = -INFINITY } }, [](double x) { return false; });
+	expect_matches<double>(v, SCAN_F64, { SCAN_LE, { .f = -INFINITY } }, [](double x) { return x == -INFINITY; });
+	vector_free(&v, NULL);
+}
+
+TEST(ScanTest, SelectsNothing)
+{
+	struct vector *v = make<int32_t>(100, [](size_t i) { return (int32_t)i; });
+
+	/* no match leaves the selection without an array */
+	struct scan_pred p = { SCAN_GT, { .i = 1000 } };
+	struct vector *sel = vector_new(0, sizeof(size_t));
+	EXPECT_EQ(scan_select(v, SCAN_I32, &p, NULL, sel), VEC_SUCCESS);
+	EXPECT_EQ(vector_size(sel), 0);
+	EXPECT_EQ(vector_data(sel), nullptr);
+
+	vector_free(&sel, NULL);
+	vector_free(&v, NULL);
+}
+
+TEST(ScanTest, ChainsSelections)
+{
+	struct vector *a = make<int32_t>(10000, [](size_t i) { return (int32_t)(i % 100); });
+	struct vector *b = make<double>(10000, [](size_t i) { return (double)i; });
+
+	/* a < 10 and b >= 5000 */
+	struct scan_pred pa = { SCAN_LT, { .i = 10 } };
+	struct scan_pred pb = { SCAN_GE, { .f = 5000 } };
+	struct vector *s1   = vector_new(0, sizeof(size_t));
+	struct vector *s2   = vector_new(0, sizeof(size_t));
+	EXPECT_EQ(scan_select(a, SCAN_I32, &pa, NULL, s1), VEC_SUCCESS);
+	EXPECT_EQ(vector_size(s1), 1000);
+	EXPECT_EQ(scan_select(b, SCAN_F64, &pb, s1, s2), VEC_SUCCESS);
+	EXPECT_EQ(vector_size(s2), 500);
+
+	struct vector *out = vector_new(0, sizeof(double));
+	EXPECT_EQ(scan_gather(b, s2, out), VEC_SUCCESS);
+	EXPECT_EQ(vector_size(out), 500);
+	double x;
+	vector_get(out, 0, &x);
+	EXPECT_EQ(x, 5000);
+	vector_get(out, 499, &x);
+	EXPECT_EQ(x, 9909);
+
+	struct scan_agg agg;
+	EXPECT_EQ(scan_aggregate(a, SCAN_I32, s2, &agg), VEC_SUCCESS);
+	EXPECT_EQ(agg.count, 500);
+	EXPECT_EQ(agg.sum.i, 50 * 45);
+	EXPECT_EQ(agg.min.i, 0);
+	EXPECT_EQ(agg.max.i, 9);
+
+	EXPECT_EQ(scan_aggregate(b, SCAN_F64, NULL, &agg), VEC_SUCCESS);
+	EXPECT_EQ(agg.count, 10000);
+	EXPECT_EQ(agg.sum.f, 9999.0 * 10000 / 2);
+	EXPECT_EQ(agg.max.f, 9999);
+
+	/* bitmaps turn back into the same selection */
+	struct vector *bitmap = vector_new(0, sizeof(uint64_t));
+	struct vector *s3     = vector_new(0, sizeof(size_t));
+	EXPECT_EQ(scan_bitmap(a, SCAN_I32, &pa, bitmap), VEC_SUCCESS);
+	EXPECT_EQ(scan_bitmap_select(bitmap, s3), VEC_SUCCESS);
+	EXPECT_EQ(vector_size(s3), vector_size(s1));
+	EXPECT_EQ(memcmp(vector_data(s3), vector_data(s1), vector_size(s1) * sizeof(size_t)), 0);
+
+	size_t bad = 10000;
+	vector_push(s3, &bad);
+	EXPECT_EQ(scan_gather(b, s3, out), VEC_ERANGE);
+	EXPECT_EQ(scan_select(a, SCAN_I64, &pa, NULL, s1), VEC_EINVAL);
+
+	vector_free(&a, NULL);
+	vector_free(&b, NULL);
+	vector_free(&s1, NULL);
+	vector_free(&s2, NULL);
+	vector_free(&s3, NULL);
+	vector_free(&out, NULL);
+	vector_free(&bitmap, NULL);
+}
@@ -0,0 +1,92 @@
+extern "C" {
+#include "seqvec.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+struct stats {
+	uint64_t version;
+	uint64_t check;
+	char name[13];
+};
+
+TEST(SeqvecTest, PublishesAndReads)
+{
+	struct seqvec *s    = seqvec_new(4, sizeof(struct stats));
+	struct vector *in   = vector_new(4, sizeof(struct stats));
+	struct vector *out  = vector_new(1, sizeof(struct stats));
+	struct stats st	    = { 7, 49, "seven" };
+	ASSERT_NE(s, nullptr);
+
+	EXPECT_EQ(seqvec_read(s, out), VEC_SUCCESS);
+	EXPECT_EQ(vector_size(out), 0);
+	EXPECT_EQ(seqvec_get(s, 0, &st), VEC_ERANGE);
+
+	for (int i = 0; i < 3; i++)
+		vector_push(in, &st);
+	EXPECT_EQ(seqvec_publish(s, in), VEC_SUCCESS);
+	EXPECT_EQ(seqvec_version(s), 1);
+
+	EXPECT_EQ(seqvec_read(s, out), VEC_SUCCESS);
+	ASSERT_EQ(vector_size(out), 3);
+	const struct stats *got = (const struct stats *)vector_data(out);
+	EXPECT_EQ(got[2].check, 49);
+	EXPECT_STREQ(got[2].name, "seven");
+
+	struct stats one;
+	EXPECT_EQ(seqvec_get(s, 1, &one), VEC_SUCCESS);
+	EXPECT_EQ(one.version, 7);
+
+	for (int i = 0; i < 2; i++)
+		vector_push(in, &st);
+	EXPECT_EQ(seqvec_publish(s, in), VEC_ERANGE);
+
+	seqvec_free(&s);
+	EXPECT_EQ(s, nullptr);
+	vector_free(&in, NULL);
+	vector_free(&out, NULL);
+}
+
+TEST(SeqvecTest, ReadersNeverSeeTornSnapshots)
+{
+	struct seqvec *s = seqvec_new(32, sizeof(uint64_t));
+	std::atomic<bool> done(false);
+	std::atomic<size_t> torn(0);
+
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; t++) {
+		readers.emplace_back([&]() {
+			struct vector *out = vector_new(32, sizeof(uint64_t));
+			while (!done) {
+				seqvec_read(s, out);
+				const uint64_t *x = (const uint64_t *)vector_data(out);
+				for (size_t i = 1; i < vector_size(out); i++)
+					torn += x[i] != x[0] + i;
+			}
+			vector_free(&out, NULL);
+		});
+	}
+
+	/* every snapshot is a run of consecutive numbers of a varying length */
+	struct vector *in = vector_new(32, sizeof(uint64_t));
+	for (uint64_t k = 0; k < 20000; k++) {
+		vector_resize(in, 1 + (k % 32));
+		uint64_t *x = (uint64_t *)vector_data(in);
+		for (size_t i = 0; i < vector_size(in); i++)
+			x[i] = (k * 1000) + i;
+		EXPECT_EQ(seqvec_publish(s, in), VEC_SUCCESS);
+	}
+	done = true;
+	for (std::thread &t : readers)
+		t.join();
+
+	EXPECT_EQ(torn, 0);
+	EXPECT_EQ(seqvec_version(s), 20000);
+	seqvec_free(&s);
+	vector_free(&in, NULL);
+}
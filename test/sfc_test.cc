@@ -0,0 +1,97 @@
+extern "C" {
+#include "sfc.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct point {
+	uint32_t c[3];
+	int id;
+};
+
+static void point_coords(void *p, void *arg, uint32_t *c)
+{
+	struct point *pt = (struct point *)p;
+	c[0]		 = pt->c[0];
+	c[1]		 = pt->c[1];
+	c[2]		 = pt->c[2];
+}
+
+static unsigned distance(const struct point *a, const struct point *b)
+{
+	unsigned d = 0;
+	for (int i = 0; i < 3; i++)
+		d += a->c[i] > b->c[i] ? a->c[i] - b->c[i] : b->c[i] - a->c[i];
+	return d;
+}
+
+/* every point of a side^dims grid, in a scrambled order */
+static struct vector *grid(unsigned side, unsigned dims)
+{
+	unsigned n	 = dims == 2 ? side * side : side * side * side;
+	struct vector *v = vector_new(n, sizeof(struct point));
+	for (unsigned i = 0; i < n; i++) {
+		unsigned j	= (i * 7919) % n;
+		struct point pt = { { j % side, (j / side) % side, dims == 3 ? j / (side * side) : 0 }, (int)j };
+		vector_push(v, &pt);
+	}
+	return v;
+}
+
+TEST(SfcTest, MortonKeys)
+{
+	EXPECT_EQ(sfc_morton2(1, 0), 1);
+	EXPECT_EQ(sfc_morton2(0, 1), 2);
+	EXPECT_EQ(sfc_morton2(3, 3), 15);
+	EXPECT_EQ(sfc_morton2(UINT32_MAX, UINT32_MAX), UINT64_MAX);
+	EXPECT_EQ(sfc_morton3(1, 1, 1), 7);
+	EXPECT_EQ(sfc_morton3(0, 0, 2), 32);
+	EXPECT_EQ(sfc_morton3(0x1fffff, 0x1fffff, 0x1fffff), (UINT64_C(1) << 63) - 1);
+}
+
+TEST(SfcTest, HilbertOrderVisitsNeighbours)
+{
+	for (unsigned dims = 2; dims <= 3; dims++) {
+		struct vector *v    = grid(16, dims);
+		struct vector *perm = vector_new(0, sizeof(size_t));
+		EXPECT_EQ(sfc_reorder(v, SFC_HILBERT, dims, point_coords, NULL, perm), VEC_SUCCESS);
+
+		const struct point *p = (const struct point *)vector_data(v);
+		struct point origin   = { { 0, 0, 0 }, 0 };
+		EXPECT_EQ(distance(&p[0], &origin), 0);
+		for (size_t i = 1; i < vector_size(v); i++)
+			EXPECT_EQ(distance(&p[i - 1], &p[i]), 1) << dims << "D, at " << i;
+
+		/* the permutation tells where each point came from */
+		const size_t *idx = (const size_t *)vector_data(perm);
+		for (size_t i = 0; i < vector_size(v); i++)
+			EXPECT_EQ(p[i].id, (int)((idx[i] * 7919) % vector_size(v)));
+
+		vector_free(&v, NULL);
+		vector_free(&perm, NULL);
+	}
+}
+
+TEST(SfcTest, MortonOrderSortsKeys)
+{
+	struct vector *v = grid(32, 2);
+	EXPECT_EQ(sfc_reorder(v, SFC_MORTON, 2, point_coords, NULL, NULL), VEC_SUCCESS);
+
+	const struct point *p = (const struct point *)vector_data(v);
+	for (size_t i = 1; i < vector_size(v); i++)
+		EXPECT_EQ(sfc_morton2(p[i].c[0], p[i].c[1]), i);
+
+	EXPECT_EQ(sfc_reorder(v, SFC_MORTON, 4, point_coords, NULL, NULL), VEC_EINVAL);
+	vector_free(&v, NULL);
+}
+
+TEST(SfcTest, Quantize)
+{
+	EXPECT_EQ(sfc_quantize(-5, 0, 1, 2), 0);
+	EXPECT_EQ(sfc_quantize(1, 0, 1, 2), UINT32_MAX);
+	EXPECT_EQ(sfc_quantize(7, -1, 3, 3), (1u << 21) - 1);
+	EXPECT_EQ(sfc_quantize(0.5, 0, 1, 3), (1u << 20) - 1);
+}
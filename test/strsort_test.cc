@@ -0,0 +1,104 @@
+extern "C" {
+#include "strsort.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static std::vector<std::string> make_strings(size_t n, unsigned seed)
+{
+	static const char *prefixes[] = { "", "http://example.com/", "http://example.com/a/b/c/d/", "\xff\xfe", "zz" };
+	std::vector<std::string> out;
+	srand(seed);
+	for (size_t i = 0; i < n; i++) {
+		std::string s = prefixes[rand() % 5];
+		size_t len    = rand() % 24;
+		for (size_t k = 0; k < len; k++)
+			s += (char)(1 + rand() % 255);
+		out.push_back(s);
+	}
+	out.push_back("");
+	out.push_back(out[n / 2]);
+	return out;
+}
+
+static void expect_sorted_ptrs(size_t n, size_t nthreads)
+{
+	std::vector<std::string> strings = make_strings(n, n);
+	struct vector *v		 = vector_new(strings.size(), sizeof(char *));
+	for (auto &s : strings) {
+		const char *p = s.c_str();
+		vector_push(v, &p);
+	}
+
+	EXPECT_EQ(strsort_ptrs(v, nthreads), VEC_SUCCESS);
+
+	/* sort a copy, the pointers refer to the original strings */
+	std::vector<std::string> sorted = strings;
+	std::sort(sorted.begin(), sorted.end());
+	char **p = (char **)vector_data(v);
+	for (size_t i = 0; i < sorted.size(); i++)
+		ASSERT_STREQ(p[i], sorted[i].c_str()) << i;
+	vector_free(&v, NULL);
+}
+
+TEST(StrsortTest, SortsPointers)
+{
+	expect_sorted_ptrs(1000, 1);
+}
+
+TEST(StrsortTest, SortsPointersInParallel)
+{
+	expect_sorted_ptrs(100000, 4);
+}
+
+TEST(StrsortTest, SortsJaggedRows)
+{
+	std::vector<std::string> strings = make_strings(50000, 7);
+
+	/* embedded zeros and rows differing only by trailing zeros */
+	strings.push_back(std::string("ab\0", 3));
+	strings.push_back(std::string("ab", 2));
+	strings.push_back(std::string("ab\0\0\0\0\0\0\0\0x", 11));
+	strings.push_back(std::string("ab\0\0\0\0\0\0", 8));
+
+	struct jagged *j = jagged_new(1);
+	for (auto &s : strings) {
+		jagged_add_row(j);
+		for (char c : s)
+			jagged_push(j, &c);
+	}
+
+	struct vector *perm = vector_new(0, sizeof(size_t));
+	EXPECT_EQ(strsort_jagged(j, perm, 0), VEC_SUCCESS);
+	EXPECT_EQ(vector_size(perm), strings.size());
+
+	std::vector<std::string> sorted = strings;
+	std::sort(sorted.begin(), sorted.end());
+	const size_t *idx = (const size_t *)vector_data(perm);
+	for (size_t i = 0; i < sorted.size(); i++)
+		ASSERT_EQ(strings[idx[i]], sorted[i]) << i;
+
+	vector_free(&perm, NULL);
+	jagged_free(&j, NULL);
+}
+
+TEST(StrsortTest, RejectsOtherVectors)
+{
+	struct vector *v = vector_new(1, sizeof(int));
+	EXPECT_EQ(strsort_ptrs(v, 1), VEC_EINVAL);
+	vector_free(&v, NULL);
+
+	const char *s[] = { "b", "a" };
+	v		= vector_new(2, sizeof(char *));
+	vector_push(v, &s[0]);
+	vector_push(v, &s[1]);
+	vector_make_immutable(v);
+	EXPECT_EQ(strsort_ptrs(v, 1), VEC_EIMMUT);
+	vector_free(&v, NULL);
+}
@@ -0,0 +1,153 @@
+extern "C" {
+#include "tseries.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+TEST(TseriesTest, RoundTripsArbitraryPoints)
+{
+	struct tseries *ts = tseries_new();
+	EXPECT_NE(ts, nullptr);
+
+	std::mt19937_64 rng(42);
+	std::vector<int64_t> t;
+	std::vector<double> v;
+	int64_t now = -1000;
+	for (int i = 0; i < 5000; i++) {
+		/* mix of regular, jittered and huge steps */
+		now += i % 7 == 0 ? (int64_t)(rng() % 100000000) : 10 + (int64_t)(rng() % 3);
+		t.push_back(now);
+		/* repeat a value now and then */
+		v.push_back(i % 5 == 4 ? v.back() : std::uniform_real_distribution<double>(-1e6, 1e6)(rng));
+		EXPECT_EQ(tseries_append(ts, t.back(), v.back()), VEC_SUCCESS);
+	}
+	EXPECT_EQ(tseries_size(ts), 5000);
+	EXPECT_EQ(tseries_blocks(ts), 5);
+
+	struct tseries_iter *it = tseries_get_iterator(ts, INT64_MIN, INT64_MAX);
+	int64_t pt;
+	double pv;
+	for (int i = 0; i < 5000; i++) {
+		ASSERT_TRUE(tseries_has_next(it));
+		EXPECT_EQ(tseries_get_next(it, &pt, &pv), VEC_SUCCESS);
+		EXPECT_EQ(pt, t[i]);
+		EXPECT_EQ(pv, v[i]);
+	}
+	EXPECT_FALSE(tseries_has_next(it));
+	EXPECT_EQ(tseries_get_next(it, &pt, &pv), VEC_EITEHX);
+	tseries_free_iterator(it);
+
+	/* out of order points are refused */
+	EXPECT_EQ(tseries_append(ts, now - 1, 0.0), VEC_EINVAL);
+	tseries_free(&ts);
+	EXPECT_EQ(ts, nullptr);
+}
+
+TEST(TseriesTest, CompressesRegularSeries)
+{
+	struct tseries *ts = tseries_new();
+	for (int i = 0; i < 100000; i++)
+		tseries_append(ts, 1600000000 + (int64_t)i * 15, 20.0 + (i / 60) % 10);
+
+	/* 16 bytes per point uncompressed */
+	EXPECT_LT(tseries_bytes(ts) * 10, 100000 * 16);
+
+	int64_t t[TSERIES_BLOCK_POINTS];
+	double v[TSERIES_BLOCK_POINTS];
+	size_t n;
+	EXPECT_EQ(tseries_decode_block(ts, 3, t, v, &n), VEC_SUCCESS);
+	EXPECT_EQ(n, TSERIES_BLOCK_POINTS);
+	EXPECT_EQ(t[0], 1600000000 + 3 * TSERIES_BLOCK_POINTS * 15);
+	EXPECT_EQ(v[n - 1], 20.0 + ((4 * TSERIES_BLOCK_POINTS - 1) / 60) % 10);
+	EXPECT_EQ(tseries_decode_block(ts, tseries_blocks(ts), t, v, &n), VEC_ERANGE);
+	tseries_free(&ts);
+}
+
+TEST(TseriesTest, IteratesTimeRange)
+{
+	struct tseries *ts = tseries_new();
+	for (int i = 0; i < 10000; i++)
+		tseries_append(ts, i * 10, i);
+
+	struct tseries_iter *it = tseries_get_iterator(ts, 55555, 60000);
+	int64_t t;
+	double v;
+	EXPECT_EQ(tseries_get_next(it, &t, &v), VEC_SUCCESS);
+	EXPECT_EQ(t, 55560);
+	EXPECT_EQ(v, 5556);
+
+	size_t n = 1;
+	while (tseries_has_next(it)) {
+		tseries_get_next(it, &t, &v);
+		n++;
+	}
+	EXPECT_EQ(t, 59990);
+	EXPECT_EQ(n, 444);
+	tseries_free_iterator(it);
+
+	it = tseries_get_iterator(ts, 200000, 300000);
+	EXPECT_FALSE(tseries_has_next(it));
+	tseries_free_iterator(it);
+	tseries_free(&ts);
+}
+
+static void *failing_alloc(size_t)
+{
+	return NULL;
+}
+
+static void *failing_calloc(size_t, size_t)
+{
+	return NULL;
+}
+
+TEST(TseriesTest, FailedAppendLeavesSeriesIntact)
+{
+	struct tseries *ts = tseries_new();
+	std::vector<int64_t> t;
+	std::vector<double> v;
+	for (int i = 0; i < TSERIES_BLOCK_POINTS; i++) {
+		t.push_back(i * 10);
+		v.push_back(i % 3);
+		ASSERT_EQ(tseries_append(ts, t.back(), v.back()), VEC_SUCCESS);
+	}
+
+	/* append until the words or the blocks run out of room */
+	allocator_fn old_alloc	 = vector_allocator(failing_alloc);
+	callocator_fn old_calloc = vector_callocator(failing_calloc);
+	int res			 = VEC_SUCCESS;
+	for (int64_t i = TSERIES_BLOCK_POINTS; res == VEC_SUCCESS; i++) {
+		res = tseries_append(ts, i * 10 + (i % 7), 1e9 / (double)(i + 1));
+		if (res == VEC_SUCCESS) {
+			t.push_back(i * 10 + (i % 7));
+			v.push_back(1e9 / (double)(i + 1));
+		}
+	}
+	vector_allocator(old_alloc);
+	vector_callocator(old_calloc);
+	EXPECT_EQ(res, VEC_ENOMEM);
+	EXPECT_EQ(tseries_size(ts), t.size());
+	EXPECT_EQ(tseries_blocks(ts), (t.size() + TSERIES_BLOCK_POINTS - 1) / TSERIES_BLOCK_POINTS);
+
+	/* and the series carries on from where it was */
+	for (int i = 0; i < 100; i++) {
+		t.push_back(t.back() + 5);
+		v.push_back(-i);
+		ASSERT_EQ(tseries_append(ts, t.back(), v.back()), VEC_SUCCESS);
+	}
+
+	struct tseries_iter *it = tseries_get_iterator(ts, INT64_MIN, INT64_MAX);
+	for (size_t i = 0; i < t.size(); i++) {
+		int64_t pt;
+		double pv;
+		ASSERT_EQ(tseries_get_next(it, &pt, &pv), VEC_SUCCESS);
+		ASSERT_EQ(pt, t[i]);
+		ASSERT_EQ(pv, v[i]);
+	}
+	EXPECT_FALSE(tseries_has_next(it));
+	tseries_free_iterator(it);
+	tseries_free(&ts);
+}
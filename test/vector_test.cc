@@ -4,6 +4,15 @@ extern "C" {
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
 TEST(VectorTest, VectorCreated)
 {
 	struct vector *v = vector_new(10, sizeof(int));
@@ -27,3 +36,873 @@ TEST(VectorTest, ShouldReturnSize)
 	EXPECT_EQ(size, 0);
 	vector_free(&v, NULL);
 }
+
+TEST(VectorTest, NewVectorIsZeroed)
+{
+	struct vector *v = vector_new(1 << 20, sizeof(long));
+	EXPECT_NE(v, nullptr);
+	long x = -1;
+	EXPECT_EQ(vector_get(v, (1 << 20) - 1, &x), VEC_SUCCESS);
+	EXPECT_EQ(x, 0);
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, PushGrowsFromEmpty)
+{
+	struct vector *v = vector_new(0, sizeof(int));
+	EXPECT_NE(v, nullptr);
+	for (int i = 0; i < 1000; i++)
+		EXPECT_EQ(vector_push(v, &i), VEC_SUCCESS);
+	EXPECT_EQ(vector_size(v), 1000);
+	EXPECT_GE(vector_capacity(v), 1000);
+
+	int x;
+	for (int i = 0; i < 1000; i++) {
+		EXPECT_EQ(vector_get(v, i, &x), VEC_SUCCESS);
+		EXPECT_EQ(x, i);
+	}
+
+	/* the grown tail is zero filled */
+	EXPECT_EQ(vector_get(v, vector_capacity(v) - 1, &x), VEC_SUCCESS);
+	EXPECT_EQ(x, 0);
+	vector_free(&v, NULL);
+}
+
+static size_t calloc_calls;
+
+static void *counting_calloc(size_t n, size_t sz)
+{
+	calloc_calls++;
+	return calloc(n, sz);
+}
+
+TEST(VectorTest, UsesZeroingAllocator)
+{
+	callocator_fn old = vector_callocator(counting_calloc);
+	calloc_calls	  = 0;
+
+	struct vector *v = vector_new(4, sizeof(int));
+	EXPECT_EQ(calloc_calls, 1);
+	for (int i = 0; i < 5; i++)
+		vector_push(v, &i);
+	EXPECT_EQ(calloc_calls, 2);
+
+	vector_free(&v, NULL);
+	vector_callocator(old);
+}
+
+static std::atomic<size_t> dtor_calls;
+
+static void counting_dtor(void *)
+{
+	dtor_calls++;
+}
+
+/* threads the destructor ran on, each counted on its first call */
+static std::atomic<size_t> dtor_threads;
+static thread_local bool dtor_seen;
+
+static void thread_counting_dtor(void *)
+{
+	dtor_calls++;
+	if (!dtor_seen) {
+		dtor_seen = true;
+		dtor_threads++;
+	}
+}
+
+TEST(VectorTest, FreeAsyncReleasesOnReclaimer)
+{
+	dtor_calls	 = 0;
+	struct vector *v = vector_new(0, sizeof(int));
+	for (int i = 0; i < 100; i++)
+		vector_push(v, &i);
+
+	vector_free_async(&v, counting_dtor);
+	EXPECT_EQ(v, nullptr);
+
+	vector_free_async_wait();
+	EXPECT_EQ(dtor_calls, 100);
+}
+
+TEST(VectorTest, FreeAsyncParallelDestructors)
+{
+	size_t old	 = vector_reclaimer_threads(4);
+	dtor_calls	 = 0;
+	struct vector *v = vector_new(1 << 18, sizeof(int));
+	for (int i = 0; i < 1 << 18; i++)
+		vector_push(v, &i);
+
+	dtor_threads = 0;
+	vector_free_async(&v, thread_counting_dtor);
+	vector_free_async_wait();
+	EXPECT_EQ(dtor_calls, 1 << 18);
+
+	/* the reclaimer takes a slice and threads it starts take the others */
+	EXPECT_GT(dtor_threads, 1);
+	EXPECT_EQ(vector_reclaimer_threads(old), 4);
+}
+
+TEST(VectorTest, IncrementalGrowthKeepsObjects)
+{
+	struct vector *v = vector_new(0, sizeof(int));
+	EXPECT_EQ(vector_incremental_growth(v, 4 * sizeof(int)), VEC_SUCCESS);
+
+	int x;
+	for (int i = 0; i < 10000; i++) {
+		EXPECT_EQ(vector_push(v, &i), VEC_SUCCESS);
+
+		/* objects are readable whichever array they are in */
+		EXPECT_EQ(vector_get(v, i / 2, &x), VEC_SUCCESS);
+		EXPECT_EQ(x, i / 2);
+	}
+
+	for (int i = 0; i < 10000; i++) {
+		EXPECT_EQ(vector_get(v, i, &x), VEC_SUCCESS);
+		EXPECT_EQ(x, i);
+	}
+
+	EXPECT_EQ(vector_make_immutable(v), VEC_SUCCESS);
+	EXPECT_EQ(vector_capacity(v), 10000);
+	EXPECT_EQ(vector_get(v, 9999, &x), VEC_SUCCESS);
+	EXPECT_EQ(x, 9999);
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, IncrementalGrowthOverwrites)
+{
+	struct vector *v = vector_new(0, sizeof(int));
+	vector_incremental_growth(v, 1);
+
+	for (int i = 0; i < 1025; i++)
+		vector_push(v, &i);
+
+	/* overwrite objects still sitting in the old array */
+	for (int i = 0; i < 1025; i += 3) {
+		int y = -i;
+		EXPECT_EQ(vector_insert(v, i, &y), VEC_SUCCESS);
+	}
+
+	EXPECT_EQ(vector_incremental_growth(v, 0), VEC_SUCCESS);
+	int x;
+	for (int i = 0; i < 1025; i++) {
+		vector_get(v, i, &x);
+		EXPECT_EQ(x, i % 3 ? i : -i);
+	}
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, PregrowthKeepsObjects)
+{
+	struct vector *v = vector_new(0, sizeof(int));
+	EXPECT_EQ(vector_pregrowth(v, 50), VEC_SUCCESS);
+
+	for (int i = 0; i < 100000; i++) {
+		EXPECT_EQ(vector_push(v, &i), VEC_SUCCESS);
+
+		/* rewrite an early object while the next array may be copied */
+		if (i % 1000 == 999) {
+			int y = -i;
+			vector_insert(v, i / 1000, &y);
+		}
+	}
+
+	int x;
+	for (int i = 0; i < 100000; i++) {
+		vector_get(v, i, &x);
+		if (i < 100)
+			EXPECT_EQ(x, -(i * 1000 + 999));
+		else
+			EXPECT_EQ(x, i);
+	}
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, PregrowthKeepsPoppedObjectsZeroed)
+{
+	for (bool indirect : { false, true }) {
+		struct vector *v = indirect ? vector_new_indirect(8, sizeof(uint64_t)) : vector_new(8, sizeof(uint64_t));
+		EXPECT_EQ(vector_pregrowth(v, 50), VEC_SUCCESS);
+		for (uint64_t i = 1; i <= 4; i++)
+			EXPECT_EQ(vector_push(v, &i), VEC_SUCCESS);
+
+		/* the grower copies the 4 objects, then the last one is popped below the snapshot */
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		uint64_t x;
+		EXPECT_EQ(vector_pop(v, &x), VEC_SUCCESS);
+		EXPECT_EQ(x, 4);
+		EXPECT_EQ(vector_resize(v, 12), VEC_SUCCESS);
+
+		EXPECT_EQ(vector_get(v, 3, &x), VEC_SUCCESS);
+		EXPECT_EQ(x, 0) << indirect;
+		x = 13;
+		EXPECT_EQ(vector_push(v, &x), VEC_SUCCESS);
+		EXPECT_NE(vector_at(v, 3), vector_at(v, 12)) << indirect;
+		EXPECT_EQ(vector_get(v, 3, &x), VEC_SUCCESS);
+		EXPECT_EQ(x, 0) << indirect;
+		vector_free(&v, NULL);
+	}
+}
+
+TEST(VectorTest, PregrowthRejectsBadMark)
+{
+	struct vector *v = vector_new(0, sizeof(int));
+	EXPECT_EQ(vector_pregrowth(v, 101), VEC_EINVAL);
+	EXPECT_EQ(vector_pregrowth(NULL, 50), VEC_EINVAL);
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, TaggedVectorLearnsSize)
+{
+	struct vector *v = vector_new_tagged("learns-size", 0, sizeof(int));
+	EXPECT_EQ(vector_capacity(v), 0);
+	for (int i = 0; i < 1000; i++)
+		vector_push(v, &i);
+	vector_free(&v, NULL);
+
+	v = vector_new_tagged("learns-size", 0, sizeof(int));
+	EXPECT_EQ(vector_capacity(v), 1024);
+	vector_free(&v, NULL);
+
+	/* an explicit larger size still wins */
+	v = vector_new_tagged("learns-size", 5000, sizeof(int));
+	EXPECT_EQ(vector_capacity(v), 5000);
+	vector_free(&v, NULL);
+
+	v = vector_new_tagged("other-site", 0, sizeof(int));
+	EXPECT_EQ(vector_capacity(v), 0);
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, TaggedVectorUsesPercentile)
+{
+	unsigned old = vector_tag_percentile(50);
+	for (int n = 1; n <= 4; n++) {
+		struct vector *v = vector_new_tagged("percentile", n * 100, sizeof(int));
+		for (int i = 0; i < n * 100; i++)
+			vector_push(v, &i);
+		vector_free(&v, NULL);
+	}
+
+	/* half of the sizes (100, 200) fit in 256 */
+	struct vector *v = vector_new_tagged("percentile", 0, sizeof(int));
+	EXPECT_EQ(vector_capacity(v), 256);
+	vector_free(&v, NULL);
+	vector_tag_percentile(old);
+}
+
+struct big {
+	char body[4096];
+};
+
+TEST(VectorTest, IndirectVectorKeepsObjects)
+{
+	struct vector *v = vector_new_indirect(0, sizeof(struct big));
+	EXPECT_TRUE(vector_is_indirect(v));
+	EXPECT_EQ(vector_object_size(v), sizeof(struct big));
+
+	static struct big b;
+	for (int i = 0; i < 100; i++) {
+		memset(b.body, i, sizeof b.body);
+		EXPECT_EQ(vector_push(v, &b), VEC_SUCCESS);
+	}
+
+	/* the array only holds pointers to the objects */
+	char **handles = (char **)vector_data(v);
+	EXPECT_EQ(handles[42][0], 42);
+
+	for (int i = 0; i < 100; i++) {
+		EXPECT_EQ(vector_get(v, i, &b), VEC_SUCCESS);
+		EXPECT_EQ(b.body[4095], i);
+	}
+
+	struct big *p = (struct big *)vector_at(v, 7);
+	p->body[0]    = -1;
+	EXPECT_EQ(vector_get(v, 7, &b), VEC_SUCCESS);
+	EXPECT_EQ(b.body[0], -1);
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, IndirectVectorErasedObjectsReadZero)
+{
+	struct vector *v = vector_new_indirect(4, 100);
+	char obj[100], out[100];
+	memset(obj, 7, sizeof obj);
+
+	vector_push(v, obj);
+	vector_push(v, obj);
+	EXPECT_EQ(vector_erase(v, 0), VEC_SUCCESS);
+	EXPECT_EQ(vector_get(v, 0, out), VEC_SUCCESS);
+	EXPECT_EQ(out[50], 0);
+
+	/* never written objects read as zeros too */
+	EXPECT_EQ(vector_get(v, 3, out), VEC_SUCCESS);
+	EXPECT_EQ(out[99], 0);
+
+	/* released bodies are reused zeroed */
+	char *body = (char *)vector_at(v, 2);
+	EXPECT_NE(body, nullptr);
+	EXPECT_EQ(body[0], 0);
+
+	dtor_calls = 0;
+	vector_free(&v, counting_dtor);
+	EXPECT_EQ(dtor_calls, 1);
+}
+
+static uint64_t low_bits_key(void *p, void *arg)
+{
+	return *(uint64_t *)p & *(uint64_t *)arg;
+}
+
+TEST(VectorTest, RadixSortIsStableAndReturnsPermutation)
+{
+	struct vector *v    = vector_new(1000, sizeof(uint64_t));
+	struct vector *perm = vector_new(0, sizeof(size_t));
+	for (uint64_t i = 0; i < 1000; i++) {
+		uint64_t x = (i * 7919) % 1000 | (i << 32);
+		vector_push(v, &x);
+	}
+
+	/* only the low 32 bits are compared, the high ones record the order of insertion */
+	uint64_t mask = 0xffffffff;
+	EXPECT_EQ(vector_radix_sort(v, low_bits_key, &mask, perm), VEC_SUCCESS);
+	EXPECT_EQ(vector_size(perm), 1000);
+
+	const uint64_t *x = (const uint64_t *)vector_data(v);
+	const size_t *idx = (const size_t *)vector_data(perm);
+	for (size_t i = 0; i < 1000; i++) {
+		EXPECT_EQ(x[i] & mask, i);
+		EXPECT_EQ(x[i] >> 32, idx[i]);
+	}
+
+	/* equal keys keep their order, evens then odds in increasing order */
+	mask = 1;
+	EXPECT_EQ(vector_radix_sort(v, low_bits_key, &mask, NULL), VEC_SUCCESS);
+	x = (const uint64_t *)vector_data(v);
+	for (size_t i = 0; i < 1000; i++)
+		EXPECT_EQ(x[i] & 0xffffffff, i < 500 ? 2 * i : (2 * (i - 500)) + 1);
+
+	vector_make_immutable(v);
+	EXPECT_EQ(vector_radix_sort(v, low_bits_key, &mask, NULL), VEC_EIMMUT);
+	vector_free(&v, NULL);
+	vector_free(&perm, NULL);
+}
+
+/* allocations left before they start failing */
+static int allocs_left;
+
+static void *limited_alloc(size_t n)
+{
+	return allocs_left-- > 0 ? malloc(n) : NULL;
+}
+
+TEST(VectorTest, FailedRadixSortLeavesVector)
+{
+	struct vector *v = vector_new(100, sizeof(uint64_t));
+	for (uint64_t i = 0; i < 100; i++) {
+		uint64_t x = 99 - i;
+		vector_push(v, &x);
+	}
+
+	/* fail each allocation in turn, the permutation's included */
+	uint64_t mask		 = ~UINT64_C(0);
+	callocator_fn old_calloc = vector_callocator(NULL);
+	allocator_fn old	 = vector_allocator(limited_alloc);
+	for (int k = 0; k < 4; k++) {
+		allocs_left	    = 1;
+		struct vector *perm = vector_new(0, sizeof(size_t));
+		allocs_left	    = k;
+		EXPECT_EQ(vector_radix_sort(v, low_bits_key, &mask, perm), VEC_ENOMEM) << k;
+		EXPECT_EQ(vector_size(perm), 0) << k;
+		for (size_t i = 0; i < 100; i++) {
+			uint64_t x;
+			vector_get(v, i, &x);
+			EXPECT_EQ(x, 99 - i) << k;
+		}
+		vector_free(&perm, NULL);
+	}
+	vector_allocator(old);
+	vector_callocator(old_calloc);
+
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, InsertBatchMatchesSingleInsertions)
+{
+	for (bool indirect : { false, true }) {
+		struct vector *v = indirect ? vector_new_indirect(4, sizeof(int)) : vector_new(4, sizeof(int));
+		for (int i = 0; i < 500; i++)
+			vector_push(v, &i);
+
+		/* repeated positions, both ends, given out of order */
+		std::vector<size_t> positions;
+		std::vector<int> elems;
+		for (int j = 0; j < 300; j++) {
+			positions.push_back((j * 7919) % 501);
+			elems.push_back(-j - 1);
+		}
+		std::vector<std::pair<size_t, int>> sorted;
+		for (size_t j = 0; j < positions.size(); j++)
+			sorted.push_back({ positions[j], elems[j] });
+		std::stable_sort(sorted.begin(), sorted.end(),
+				 [](const std::pair<size_t, int> &a, const std::pair<size_t, int> &b) {
+					 return a.first < b.first;
+				 });
+		std::vector<int> expect;
+		for (int i = 0, j = 0; i <= 500; i++) {
+			for (; j < (int)sorted.size() && sorted[j].first == (size_t)i; j++)
+				expect.push_back(sorted[j].second);
+			if (i < 500)
+				expect.push_back(i);
+		}
+
+		EXPECT_EQ(vector_insert_batch(v, positions.data(), elems.data(), positions.size()), VEC_SUCCESS);
+		ASSERT_EQ(vector_size(v), expect.size());
+		for (size_t i = 0; i < expect.size(); i++) {
+			int x;
+			vector_get(v, i, &x);
+			EXPECT_EQ(x, expect[i]);
+		}
+
+		size_t bad = vector_size(v) + 1;
+		EXPECT_EQ(vector_insert_batch(v, &bad, elems.data(), 1), VEC_ERANGE);
+		EXPECT_EQ(vector_size(v), expect.size());
+		vector_free(&v, NULL);
+	}
+}
+
+static int cmp_int(const void *key, const void *obj)
+{
+	int a = *(const int *)key, b = *(const int *)obj;
+	return (a > b) - (a < b);
+}
+
+TEST(VectorTest, LowerBoundBatchMatchesStd)
+{
+	for (int n : { 0, 1, 2, 37, 1000 }) {
+		struct vector *v = vector_new(1, sizeof(int));
+		std::vector<int> sorted;
+		for (int i = 0; i < n; i++) {
+			int x = 2 * (i / 3);
+			vector_push(v, &x);
+			sorted.push_back(x);
+		}
+
+		std::vector<int> keys;
+		for (int key = -2; key <= (2 * n / 3) + 2; key++)
+			keys.push_back(key);
+		std::vector<size_t> out(keys.size());
+		EXPECT_EQ(vector_lower_bound_batch(v, cmp_int, keys.data(), sizeof(int), keys.size(), out.data()),
+			  VEC_SUCCESS);
+		for (size_t i = 0; i < keys.size(); i++)
+			EXPECT_EQ(out[i], (size_t)(std::lower_bound(sorted.begin(), sorted.end(), keys[i]) - sorted.begin()));
+
+		vector_free(&v, NULL);
+	}
+}
+
+/* pages of [p, p + n) in memory */
+static size_t resident_pages(const void *p, size_t n)
+{
+	size_t pagesz = sysconf(_SC_PAGESIZE);
+	uintptr_t lo  = ((uintptr_t)p + pagesz - 1) / pagesz * pagesz;
+	uintptr_t hi  = ((uintptr_t)p + n) / pagesz * pagesz;
+	std::vector<unsigned char> in((hi - lo) / pagesz);
+	mincore((void *)lo, hi - lo, in.data());
+	return std::count_if(in.begin(), in.end(), [](unsigned char c) { return (c & 1) != 0; });
+}
+
+struct record {
+	int key;
+	int pos;
+	int pad;
+};
+
+static int cmp_record(const void *a, const void *b)
+{
+	const struct record *x = (const struct record *)a, *y = (const struct record *)b;
+	return (x->key > y->key) - (x->key < y->key);
+}
+
+TEST(VectorTest, ArgsortIsStableForAnyComparator)
+{
+	uint64_t state = 88172645463325252ull;
+	std::vector<int32_t> ints;
+	std::vector<struct record> recs;
+	for (int i = 0; i < 5000; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		ints.push_back((int32_t)(state % 400) - 200);
+		recs.push_back({ (int)(state % 97), i, 0 });
+	}
+
+	struct vector *v    = vector_new(1, sizeof(int32_t));
+	struct vector *r    = vector_new(1, sizeof(struct record));
+	struct vector *perm = vector_new(1, sizeof(size_t));
+	for (size_t i = 0; i < ints.size(); i++) {
+		vector_push(v, &ints[i]);
+		vector_push(r, &recs[i]);
+	}
+
+	std::vector<size_t> expect(ints.size());
+	for (size_t i = 0; i < expect.size(); i++)
+		expect[i] = i;
+	std::stable_sort(expect.begin(), expect.end(), [&ints](size_t a, size_t b) { return ints[a] < ints[b]; });
+
+	/* the radix path, and the merge sort through a comparator it does not know */
+	ASSERT_EQ(vector_argsort(v, vector_cmp_i32, perm), VEC_SUCCESS);
+	ASSERT_EQ(vector_size(perm), ints.size());
+	EXPECT_TRUE(std::equal(expect.begin(), expect.end(), (const size_t *)vector_data(perm)));
+	EXPECT_TRUE(std::equal(ints.begin(), ints.end(), (const int32_t *)vector_data(v)));
+
+	for (size_t i = 0; i < expect.size(); i++)
+		expect[i] = i;
+	std::stable_sort(expect.begin(), expect.end(), [&recs](size_t a, size_t b) { return recs[a].key < recs[b].key; });
+	ASSERT_EQ(vector_argsort(r, cmp_record, perm), VEC_SUCCESS);
+	EXPECT_TRUE(std::equal(expect.begin(), expect.end(), (const size_t *)vector_data(perm)));
+
+	EXPECT_EQ(vector_argsort(v, vector_cmp_i64, perm), VEC_EINVAL);
+	vector_free(&v, NULL);
+	vector_free(&r, NULL);
+	vector_free(&perm, NULL);
+}
+
+TEST(VectorTest, ArgsortOrdersFloatsTotally)
+{
+	double xs[] = { 1.5, -0.0, NAN, -INFINITY, 0.0, -2.25, INFINITY, 1e-300, -NAN, -1e300 };
+	size_t n    = sizeof xs / sizeof *xs;
+
+	/* written objects of an indirect vector, and ones never written reading zero */
+	struct vector *v    = vector_new_indirect(1, sizeof(double));
+	struct vector *perm = vector_new(1, sizeof(size_t));
+	vector_resize(v, n + 2);
+	for (size_t i = 0; i < n; i++)
+		vector_insert(v, i, &xs[i]);
+
+	ASSERT_EQ(vector_argsort(v, vector_cmp_double, perm), VEC_SUCCESS);
+	size_t expect[] = { 8, 3, 9, 5, 1, 4, 10, 11, 7, 0, 6, 2 };
+	const size_t *idx = (const size_t *)vector_data(perm);
+	for (size_t i = 0; i < n + 2; i++)
+		EXPECT_EQ(idx[i], expect[i]) << i;
+
+	vector_free(&v, NULL);
+	vector_free(&perm, NULL);
+}
+
+static size_t compared;
+
+static int cmp_record_counted(const void *a, const void *b)
+{
+	compared++;
+	return cmp_record(a, b);
+}
+
+TEST(VectorTest, StableSortMatchesStd)
+{
+	uint64_t state = 2463534242ull;
+	for (size_t n : { 0, 1, 2, 63, 64, 65, 1000, 100000 }) {
+		for (int shape = 0; shape < 6; shape++) {
+			std::vector<struct record> recs;
+			for (size_t i = 0; i < n; i++) {
+				state ^= state << 13;
+				state ^= state >> 7;
+				state ^= state << 17;
+				int key = shape == 0   ? (int)(state % 50)				  /* duplicates */
+					  : shape == 1 ? (int)(n - i) / 2				  /* descending pairs */
+					  : shape == 2 ? (int)(i % 300)				  /* sawtooth */
+					  : shape == 3 ? (int)i + (int)(state % 8) - 4		  /* slight disorder */
+					  : shape == 4 ? (i % 1000 == 7 ? (int)(state % n) : (int)i) /* a few out of place */
+						       : 7;					  /* all equal */
+				recs.push_back({ key, (int)i, 0 });
+			}
+
+			struct vector *v = vector_new(1, sizeof(struct record));
+			for (struct record &r : recs)
+				vector_push(v, &r);
+			ASSERT_EQ(vector_stable_sort(v, cmp_record), VEC_SUCCESS);
+
+			std::stable_sort(recs.begin(), recs.end(),
+					 [](const struct record &a, const struct record &b) { return a.key < b.key; });
+			const struct record *got = (const struct record *)vector_data(v);
+			for (size_t i = 0; i < n; i++) {
+				ASSERT_EQ(got[i].key, recs[i].key) << n << " " << shape << " " << i;
+				ASSERT_EQ(got[i].pos, recs[i].pos) << n << " " << shape << " " << i;
+			}
+			vector_free(&v, NULL);
+		}
+	}
+}
+
+TEST(VectorTest, StableSortAdaptsToOrder)
+{
+	size_t n	 = 100000;
+	struct vector *v = vector_new(1, sizeof(struct record));
+	for (size_t i = 0; i < n; i++) {
+		struct record r = { (int)i, (int)i, 0 };
+		vector_push(v, &r);
+	}
+
+	/* sorted already: one comparison per object */
+	compared = 0;
+	ASSERT_EQ(vector_stable_sort(v, cmp_record_counted), VEC_SUCCESS);
+	EXPECT_EQ(compared, n - 1);
+
+	/* strictly descending: reversed in place */
+	for (size_t i = 0; i < n; i++) {
+		struct record r = { (int)(n - i), (int)i, 0 };
+		vector_insert(v, i, &r);
+	}
+	compared = 0;
+	ASSERT_EQ(vector_stable_sort(v, cmp_record_counted), VEC_SUCCESS);
+	EXPECT_EQ(compared, n - 1);
+
+	/* four sorted runs whose keys interleave in blocks of 1000, merged by galloping */
+	for (size_t i = 0; i < n; i++) {
+		size_t run = i / (n / 4), j = i % (n / 4);
+		struct record r = { (int)(((((j / 1000) * 4) + run) * 1000) + (j % 1000)), (int)i, 0 };
+		vector_insert(v, i, &r);
+	}
+	compared = 0;
+	ASSERT_EQ(vector_stable_sort(v, cmp_record_counted), VEC_SUCCESS);
+	EXPECT_LT(compared, 2 * n);
+	const struct record *got = (const struct record *)vector_data(v);
+	for (size_t i = 1; i < n; i++)
+		ASSERT_LE(got[i - 1].key, got[i].key);
+
+	vector_make_immutable(v);
+	EXPECT_EQ(vector_stable_sort(v, cmp_record), VEC_EIMMUT);
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, StableSortMovesIndirectObjects)
+{
+	/* objects never written read as zero and sort with the written zeros */
+	struct vector *v = vector_new_indirect(1, sizeof(struct record));
+	vector_resize(v, 3000);
+	for (size_t i = 0; i < 3000; i += 2) {
+		struct record r = { (int)(i % 7) - 3, (int)i, 0 };
+		vector_insert(v, i, &r);
+	}
+	ASSERT_EQ(vector_stable_sort(v, cmp_record), VEC_SUCCESS);
+
+	int key = -3, pos = -1;
+	for (size_t i = 0; i < 3000; i++) {
+		struct record r;
+		vector_get(v, i, &r);
+		ASSERT_LE(key, r.key);
+		if (r.key != key) {
+			key = r.key;
+			pos = -1;
+		}
+		if (r.pos || r.key) {
+			ASSERT_LT(pos, r.pos);
+			pos = r.pos;
+		}
+	}
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, PermuteReordersSeveralVectors)
+{
+	/* enough objects for the gather to be split */
+	size_t n	    = 300000;
+	struct vector *keys = vector_new(1, sizeof(uint64_t));
+	struct vector *vals = vector_new_indirect(1, sizeof(size_t));
+	struct vector *perm = vector_new(1, sizeof(size_t));
+	for (size_t i = 0; i < n; i++) {
+		uint64_t k = (i * 2654435761u) % 1000003;
+		vector_push(keys, &k);
+		vector_push(vals, &i);
+	}
+
+	for (size_t nthreads : { 1, 4 }) {
+		ASSERT_EQ(vector_argsort(keys, vector_cmp_u64, perm), VEC_SUCCESS);
+		std::vector<size_t> order((const size_t *)vector_data(perm), (const size_t *)vector_data(perm) + n);
+		std::vector<size_t> before(n);
+		for (size_t i = 0; i < n; i++)
+			vector_get(vals, i, &before[i]);
+
+		ASSERT_EQ(vector_permute(keys, perm, nthreads), VEC_SUCCESS);
+		ASSERT_EQ(vector_permute(vals, perm, nthreads), VEC_SUCCESS);
+
+		const uint64_t *k = (const uint64_t *)vector_data(keys);
+		EXPECT_TRUE(std::is_sorted(k, k + n));
+		for (size_t i = 0; i < n; i++) {
+			size_t val;
+			vector_get(vals, i, &val);
+			ASSERT_EQ(val, before[order[i]]);
+		}
+
+		/* scramble again for the other mode */
+		for (size_t i = 0; i < n; i++) {
+			uint64_t x = (i * 40503u) % 65521;
+			vector_insert(keys, i, &x);
+		}
+	}
+
+	/* not a permutation, nothing moves */
+	size_t *p = (size_t *)vector_data(perm);
+	p[0]	  = p[1];
+	uint64_t first;
+	vector_get(keys, 0, &first);
+	EXPECT_EQ(vector_permute(keys, perm, 1), VEC_EINVAL);
+	EXPECT_EQ(vector_permute(keys, perm, 4), VEC_EINVAL);
+	uint64_t again;
+	vector_get(keys, 0, &again);
+	EXPECT_EQ(first, again);
+
+	EXPECT_EQ(vector_resize(perm, n - 1), VEC_SUCCESS);
+	EXPECT_EQ(vector_permute(keys, perm, 1), VEC_EINVAL);
+
+	vector_free(&keys, NULL);
+	vector_free(&vals, NULL);
+	vector_free(&perm, NULL);
+}
+
+TEST(VectorTest, ColdBlocksReadBackAfterCompression)
+{
+	const size_t n	 = 1 << 20;
+	struct vector *v = vector_new(n, sizeof(uint64_t));
+	for (uint64_t i = 0; i < n; i++) {
+		uint64_t x = (i / 7) * 3;
+		vector_push(v, &x);
+	}
+	char *data = (char *)vector_at(v, 0);
+
+	EXPECT_EQ(vector_compress_cold(v), VEC_EINVAL);
+	ASSERT_EQ(vector_cold_compression(v, 4), VEC_SUCCESS);
+
+	/* blocks laid out by the first sweep count as touched */
+	struct vector_cold_stats st;
+	ASSERT_EQ(vector_compress_cold(v), VEC_SUCCESS);
+	ASSERT_EQ(vector_cold_stats(v, &st), VEC_SUCCESS);
+	EXPECT_EQ(st.released, 0u);
+
+	ASSERT_EQ(vector_compress_cold(v), VEC_SUCCESS);
+	ASSERT_EQ(vector_cold_stats(v, &st), VEC_SUCCESS);
+	size_t bytes = n * sizeof(uint64_t);
+	EXPECT_GE(st.released, bytes / st.block_size - 1);
+	EXPECT_LT(st.zbytes, bytes / 4);
+	EXPECT_LT(resident_pages(data + st.block_size, bytes - 2 * st.block_size), 2u);
+
+	for (uint64_t i = 0; i < n; i += 3) {
+		uint64_t x;
+		ASSERT_EQ(vector_get(v, i, &x), VEC_SUCCESS);
+		ASSERT_EQ(x, (i / 7) * 3);
+	}
+	ASSERT_EQ(vector_cold_stats(v, &st), VEC_SUCCESS);
+	EXPECT_EQ(st.cached, 4u);
+
+	/* the blocks just read stay, the cached ones are released again */
+	ASSERT_EQ(vector_compress_cold(v), VEC_SUCCESS);
+	ASSERT_EQ(vector_compress_cold(v), VEC_SUCCESS);
+	ASSERT_EQ(vector_cold_stats(v, &st), VEC_SUCCESS);
+	EXPECT_EQ(st.cached, 0u);
+	EXPECT_GE(st.released, bytes / st.block_size - 1);
+
+	ASSERT_EQ(vector_cold_compression(v, 0), VEC_SUCCESS);
+	EXPECT_EQ(vector_cold_stats(v, &st), VEC_EINVAL);
+	for (uint64_t i = 0; i < n; i++)
+		ASSERT_EQ(((uint64_t *)vector_data(v))[i], (i / 7) * 3);
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, ColdBlocksDropCopiesOnWrite)
+{
+	const size_t n	 = 1 << 18;
+	struct vector *v = vector_new(n, sizeof(uint64_t));
+	std::vector<uint64_t> expect;
+	uint64_t state = 0x9e3779b97f4a7c15;
+	for (size_t i = 0; i < n; i++) {
+		/* the first half compresses, the second does not */
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		uint64_t x = i < n / 2 ? i % 100 : state;
+		vector_push(v, &x);
+		expect.push_back(x);
+	}
+
+	ASSERT_EQ(vector_cold_compression(v, 2), VEC_SUCCESS);
+	ASSERT_EQ(vector_compress_cold(v), VEC_SUCCESS);
+	ASSERT_EQ(vector_compress_cold(v), VEC_SUCCESS);
+	struct vector_cold_stats st;
+	ASSERT_EQ(vector_cold_stats(v, &st), VEC_SUCCESS);
+	size_t half = n * sizeof(uint64_t) / 2 / st.block_size;
+	EXPECT_GE(st.released, half - 1);
+	EXPECT_LE(st.released, half);
+
+	/* writes through every path, some straddling blocks */
+	for (size_t i = 100; i < n; i += 4099) {
+		uint64_t x = i;
+		*(uint64_t *)vector_at(v, i) = x;
+		expect[i]		     = x;
+		ASSERT_EQ(vector_insert(v, i + 1, &x), VEC_SUCCESS);
+		expect[i + 1] = x;
+		ASSERT_EQ(vector_erase(v, i + 2), VEC_SUCCESS);
+		expect[i + 2] = 0;
+	}
+	for (size_t i = 0; i < n; i++) {
+		uint64_t x;
+		ASSERT_EQ(vector_get(v, i, &x), VEC_SUCCESS);
+		ASSERT_EQ(x, expect[i]);
+	}
+
+	/* pushing past the capacity moves the array, after decompressing it */
+	ASSERT_EQ(vector_compress_cold(v), VEC_SUCCESS);
+	ASSERT_EQ(vector_compress_cold(v), VEC_SUCCESS);
+	uint64_t x = 42;
+	ASSERT_EQ(vector_push(v, &x), VEC_SUCCESS);
+	expect.push_back(x);
+	ASSERT_EQ(vector_cold_stats(v, &st), VEC_SUCCESS);
+	EXPECT_EQ(st.released, 0u);
+	EXPECT_EQ(st.zbytes, 0u);
+	for (size_t i = 0; i < expect.size(); i++)
+		ASSERT_EQ(((uint64_t *)vector_data(v))[i], expect[i]);
+
+	vector_free(&v, NULL);
+}
+
+TEST(VectorTest, ColdBlocksKeepObjectsStraddlingThem)
+{
+	/* 12 byte objects, so some straddle the boundary of two blocks */
+	const size_t n = 1 << 16;
+	for (size_t cache_blocks = 1; cache_blocks <= 2; cache_blocks++) {
+		struct vector *v = vector_new(n, 3 * sizeof(uint32_t));
+		for (size_t i = 0; i < n; i++) {
+			uint32_t x[3] = { (uint32_t)(i / 50), (uint32_t)(i / 50), (uint32_t)(i / 50) };
+			vector_push(v, x);
+		}
+		uintptr_t data = (uintptr_t)vector_at(v, 0);
+
+		ASSERT_EQ(vector_cold_compression(v, cache_blocks), VEC_SUCCESS);
+		ASSERT_EQ(vector_compress_cold(v), VEC_SUCCESS);
+		ASSERT_EQ(vector_compress_cold(v), VEC_SUCCESS);
+		struct vector_cold_stats st;
+		ASSERT_EQ(vector_cold_stats(v, &st), VEC_SUCCESS);
+
+		/* the first boundary between blocks k - 1 and k that an object straddles */
+		size_t pagesz = sysconf(_SC_PAGESIZE);
+		size_t first  = (pagesz - (data % pagesz)) % pagesz;
+		size_t k      = 1;
+		while ((first + (k * st.block_size)) % 12 == 0)
+			k++;
+		size_t idx = (first + (k * st.block_size)) / 12;
+
+		/* reading blocks k - 1 and k + 2 first fills the cache before block k is loaded */
+		uint32_t x[3];
+		ASSERT_EQ(vector_get(v, (first + ((k - 1) * st.block_size)) / 12 + 1, x), VEC_SUCCESS);
+		ASSERT_EQ(vector_get(v, (first + ((k + 2) * st.block_size)) / 12 + 1, x), VEC_SUCCESS);
+		ASSERT_EQ(vector_get(v, idx, x), VEC_SUCCESS);
+		for (int j = 0; j < 3; j++)
+			EXPECT_EQ(x[j], idx / 50) << cache_blocks;
+
+		for (size_t i = 0; i < n; i++) {
+			ASSERT_EQ(vector_get(v, i, x), VEC_SUCCESS);
+			ASSERT_EQ(x[0], i / 50) << cache_blocks;
+			ASSERT_EQ(x[2], i / 50) << cache_blocks;
+		}
+		vector_free(&v, NULL);
+	}
+}
@@ -0,0 +1,137 @@
+extern "C" {
+#include "window.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/* aggregates of the points in (now - span, now], by rescanning them */
+static struct window_stats rescan(const std::vector<struct window_point> &p, size_t n, int64_t span)
+{
+	struct window_stats s = { 0, 0, 0, 0 };
+	int64_t now	      = p[n - 1].t;
+	for (size_t i = 0; i < n; i++) {
+		if (now - p[i].t >= span)
+			continue;
+		s.min = s.count ? std::min(s.min, p[i].v) : p[i].v;
+		s.max = s.count ? std::max(s.max, p[i].v) : p[i].v;
+		s.sum += p[i].v;
+		s.count++;
+	}
+	return s;
+}
+
+static std::vector<struct window_point> points(size_t n)
+{
+	std::vector<struct window_point> p;
+	int64_t t = 0;
+	for (size_t i = 0; i < n; i++) {
+		t += (i * 7) % 5;
+		p.push_back({ t, (double)((i * 7919) % 1000) - 500 });
+	}
+	return p;
+}
+
+TEST(WindowTest, MatchesRescanning)
+{
+	std::vector<struct window_point> p = points(5000);
+	struct window *w		   = window_new(50);
+	ASSERT_NE(w, nullptr);
+
+	for (size_t i = 0; i < p.size(); i++) {
+		ASSERT_EQ(window_push(w, p[i].t, p[i].v), VEC_SUCCESS);
+
+		struct window_stats got, expect = rescan(p, i + 1, 50);
+		EXPECT_EQ(window_stats(w, &got), VEC_SUCCESS);
+		ASSERT_EQ(got.count, expect.count);
+		EXPECT_EQ(window_size(w), expect.count);
+		EXPECT_DOUBLE_EQ(got.sum, expect.sum);
+		EXPECT_EQ(got.min, expect.min);
+		EXPECT_EQ(got.max, expect.max);
+	}
+
+	EXPECT_EQ(window_push(w, 0, 1), VEC_EINVAL);
+	EXPECT_EQ(window_advance(w, p.back().t + 50), VEC_SUCCESS);
+	EXPECT_EQ(window_size(w), 0);
+
+	window_free(&w);
+	EXPECT_EQ(w, nullptr);
+}
+
+TEST(WindowTest, PushesSpans)
+{
+	std::vector<struct window_point> p = points(3000);
+	struct vector *v		   = vector_new(p.size(), sizeof(struct window_point));
+	for (struct window_point &x : p)
+		vector_push(v, &x);
+
+	struct window *w = window_new(200);
+	size_t spans[]	 = { 0, 1, 400, 401, 2500, 3000 };
+	for (size_t k = 1; k < sizeof spans / sizeof *spans; k++) {
+		ASSERT_EQ(window_push_span(w, v, spans[k - 1], spans[k]), VEC_SUCCESS);
+
+		struct window_stats got, expect = rescan(p, spans[k], 200);
+		window_stats(w, &got);
+		EXPECT_EQ(got.count, expect.count);
+		EXPECT_DOUBLE_EQ(got.sum, expect.sum);
+		EXPECT_EQ(got.min, expect.min);
+		EXPECT_EQ(got.max, expect.max);
+	}
+
+	EXPECT_EQ(window_push_span(w, v, 0, 10), VEC_EINVAL);
+	EXPECT_EQ(window_push_span(w, v, 10, 3001), VEC_ERANGE);
+	window_free(&w);
+	vector_free(&v, NULL);
+}
+
+/* concatenation, associative but neither commutative nor invertible */
+static void concat(void *out, const void *a, const void *b, void *arg)
+{
+	const char *x = (const char *)a, *y = (const char *)b;
+	size_t n = strnlen(x, 16), m = strnlen(y, 16 - n);
+	memset(out, 0, 16);
+	memcpy(out, x, n);
+	memcpy((char *)out + n, y, m);
+}
+
+TEST(WindowTest, AggregatesWithTwoStacks)
+{
+	struct window_agg *a = window_agg_new(16, concat, NULL);
+	struct vector *v     = vector_new(26, 16);
+	char obj[16];
+	for (char c = 'a'; c <= 'z'; c++) {
+		memset(obj, 0, sizeof obj);
+		obj[0] = c;
+		vector_push(v, obj);
+	}
+
+	EXPECT_EQ(window_agg_query(a, obj), VEC_ERANGE);
+	EXPECT_EQ(window_agg_pop(a), VEC_ERANGE);
+
+	/* a window of the last 5 letters, pushed one by one then in spans */
+	std::string expect;
+	for (size_t i = 0; i < 26; i++) {
+		if (i < 13)
+			EXPECT_EQ(window_agg_push(a, vector_at(v, i)), VEC_SUCCESS);
+		else
+			EXPECT_EQ(window_agg_push_span(a, v, i, i + 1), VEC_SUCCESS);
+		expect += (char)('a' + i);
+		if (expect.size() > 5) {
+			EXPECT_EQ(window_agg_pop(a), VEC_SUCCESS);
+			expect.erase(0, 1);
+		}
+
+		EXPECT_EQ(window_agg_size(a), expect.size());
+		EXPECT_EQ(window_agg_query(a, obj), VEC_SUCCESS);
+		EXPECT_EQ(std::string(obj, strnlen(obj, 16)), expect);
+	}
+
+	window_agg_free(&a);
+	EXPECT_EQ(a, nullptr);
+	vector_free(&v, NULL);
+}